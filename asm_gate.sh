@@ -0,0 +1,224 @@
+#!/bin/sh
+
+# Copyright (c) 2016 Walter William Karas
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Checks the code generated for the functions in the assembler probes
+# (cmp_base.cpp, bf_asm.cpp, var_asm.cpp, desc_asm.cpp, pack_asm.cpp,
+# mptr_asm.cpp, image_asm.cpp and wide_asm.cpp).
+# Each probe is compiled at -O2 and -O3 with each compiler, and
+# disassembled with objdump.  For each function, the instructions, the
+# instructions that access memory, and the branches (jumps and calls) are
+# counted.  The check fails if:
+#
+# - A function in cmp_base.cpp that uses the library (r1, w1) has a higher
+#   count than the function that uses a native bit field (r2, w2).
+# - A function in mptr_asm.cpp that takes a pointer to member as a
+#   template argument (r11c, w11c, ...) has a higher count than the
+#   function that uses BITF_S (r11s, w11s, ...).
+# - A function in wide_asm.cpp with Bit_offset_t std::size_t (r1w, w1w,
+#   ...) has a higher count than the same function with the default
+#   offsets (r1, w1, ...).
+# - A count is higher than the budget for the function in asm_budget.txt .
+#
+# Usage:  asm_gate.sh [--record] [COMPILER ...]
+#
+# The default compilers are g++ and clang++ (if they are installed).
+# Budgets are per compiler name and major version, so a compiler with no
+# budgets is only checked against native bit fields.  With --record, the
+# budgets for the compilers are replaced with the current counts.  The
+# exit status is 0 if all checks pass, 1 otherwise.
+
+dir=$(cd "$(dirname "$0")" && pwd)
+budget=$dir/asm_budget.txt
+
+record=no
+if [ "$1" = --record ]
+then
+  record=yes
+  shift
+fi
+
+if [ $# -eq 0 ]
+then
+  for c in g++ clang++
+  do
+    command -v $c > /dev/null && set -- "$@" $c
+  done
+fi
+
+tmp=$(mktemp -d) || exit 1
+trap 'rm -rf "$tmp"' EXIT
+
+touch "$budget"
+
+# Counts for one object file:  KEY OPT PROBE FUNCTION INSNS MEM BRANCHES
+count() {
+  objdump -d -C --no-show-raw-insn "$1" | awk -v key="$2" -v opt="$3" \
+    -v probe="$4" '
+    function flush() {
+      if (fn == "")
+        return
+      # A function that is only a jump to another probe function has
+      # the same code (it was folded by the compiler), so its counts are
+      # the counts of the other function.
+      if ((insns == 1) && (jmp != ""))
+        alias[fn] = jmp
+      else
+        cnt[fn] = insns " " mem " " br
+      order[++n] = fn
+      fn = ""
+    }
+    /^[0-9a-f]+ <.*>:$/ {
+      flush()
+      name = $0
+      sub(/^[0-9a-f]+ </, "", name)
+      sub(/>:$/, "", name)
+      # Only the probe functions, not library functions that were not
+      # inlined (whose cost shows up as calls).
+      sub(/\(.*/, "", name)
+      if ((name ~ /::/) || (name ~ /</))
+        next
+      fn = name
+      insns = mem = br = 0
+      jmp = ""
+      next
+    }
+    fn != "" && /^ +[0-9a-f]+:\t/ {
+      split($0, f, "\t")
+      if ((f[2] ~ /^jmp /) && (f[2] ~ /<[^+]*>$/)) {
+        jmp = f[2]
+        sub(/^[^<]*</, "", jmp)
+        sub(/\(.*/, "", jmp)
+      }
+      # Drop the symbol of a jump or call target.
+      sub(/ *<.*>$/, "", f[2])
+      op = f[2]
+      sub(/ .*/, "", op)
+      if ((op == "") || (op ~ /^(nop|xchg %ax,%ax)/) || (op ~ /^data16/))
+        next
+      ++insns
+      if ((op !~ /^lea/) && (f[2] ~ /\(/))
+        ++mem
+      if (op ~ /^(j|call)/)
+        ++br
+    }
+    END {
+      flush()
+      for (i = 1; i <= n; ++i) {
+        g = order[i]
+        if (g in alias)
+          c = (alias[g] in cnt) ? cnt[alias[g]] : "1 0 1"
+        else
+          c = cnt[g]
+        print key, opt, probe, g, c
+      }
+    }'
+}
+
+fail=0
+
+for cc in "$@"
+do
+  key=$(basename "$cc")-$($cc -dumpversion | cut -d. -f1)
+
+  for opt in -O2 -O3
+  do
+    for probe in cmp_base bf_asm var_asm desc_asm pack_asm mptr_asm image_asm \
+      wide_asm
+    do
+      if ! $cc $opt -c -o "$tmp/$probe.o" "$dir/$probe.cpp"
+      then
+        echo "FAIL $key $opt: $probe.cpp did not compile"
+        fail=1
+        continue
+      fi
+
+      count "$tmp/$probe.o" "$key" "$opt" "$probe" >> "$tmp/counts"
+    done
+  done
+done
+
+[ -s "$tmp/counts" ] || { echo "FAIL no counts"; exit 1; }
+
+# Checks that, in probe PROBE, each function whose name ends in SUFFIX has
+# no higher counts than the function with that ending replaced by
+# OTHER_SUFFIX, which is described as WHAT.
+no_worse() {
+  awk -v probe="$1" -v suffix="$2" -v other="$3" -v what="$4" '
+    $3 == probe { c[$1 " " $2 " " $4] = $0 }
+    END {
+      st = 0
+      for (k in c) {
+        split(c[k], l)
+        if (substr(l[4], length(l[4]) - length(suffix) + 1) != suffix)
+          continue
+        n = l[1] " " l[2] " " \
+            substr(l[4], 1, length(l[4]) - length(suffix)) other
+        if (!(n in c))
+          continue
+        split(c[n], b)
+        if ((l[5] > b[5]) || (l[6] > b[6]) || (l[7] > b[7])) {
+          print "FAIL " l[1] " " l[2] " " l[4] " (" l[5] " insns, " l[6] \
+                " mem, " l[7] " branches) worse than " what " " b[4] " (" \
+                b[5] " insns, " b[6] " mem, " b[7] " branches)"
+          st = 1
+        }
+      }
+      exit st
+    }' "$tmp/counts"
+}
+
+no_worse cmp_base 1 2 native || fail=1
+no_worse mptr_asm c s BITF_S || fail=1
+no_worse wide_asm w "" "short offsets" || fail=1
+
+if [ $record = yes ]
+then
+  # Keep the budgets of other compilers.
+  cut -d' ' -f1 "$tmp/counts" | sort -u > "$tmp/keys"
+  {
+    grep '^#' "$budget"
+    grep -v '^#' "$budget" | grep -v -F -f "$tmp/keys"
+    cat "$tmp/counts"
+  } > "$tmp/budget"
+  cp "$tmp/budget" "$budget"
+  echo "recorded budgets for $(tr '\n' ' ' < "$tmp/keys")"
+else
+  awk '
+    NR == FNR {
+      if ($1 !~ /^#/)
+        b[$1 " " $2 " " $3 " " $4] = $0
+      next
+    }
+    {
+      k = $1 " " $2 " " $3 " " $4
+      if (!(k in b))
+        next
+      split(b[k], l)
+      if (($5 > l[5]) || ($6 > l[6]) || ($7 > l[7])) {
+        print "FAIL " k ": " $5 " insns, " $6 " mem, " $7 \
+              " branches; budget " l[5] ", " l[6] ", " l[7]
+        st = 1
+      }
+    }
+    END { exit st }' "$budget" "$tmp/counts" || fail=1
+fi
+
+[ $fail = 0 ] && echo "asm gate passed"
+
+exit $fail
@@ -0,0 +1,582 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Timing of bit field operations, over a large array of records.
+// Requires C++11.  Build with optimization, for example:
+//
+// g++ -std=c++11 -O2 -o bench bench.cpp
+//
+// Each record is four storage locations.  For each Storage_t, Value_t,
+// field (one that does not straddle storage locations and one that does)
+// and order of bits in storage (LS or MS bit first), each operation is
+// timed using BITF, BITF_S (Static_bf), Bitfield::f() (pointer to member
+// of the format), Bitfield::fn() (offset and width not known at compile
+// time) and Bitfield::Descriptor (made once from the same offset and
+// width).  The fn and Descriptor cases are also timed with traits that
+// have Bit_offset_t std::size_t (fn_wide, desc_wide), to compare with the
+// default offsets (unsigned short).
+// For fields that do not straddle and are LS bit first, native C++ bit
+// fields with the same layout (like Base_fmt in cmp_base.cpp) are timed
+// as the baseline.
+//
+// The output is CSV, a line per case:  name,ns_per_op .  Options:
+//
+// --filter TEXT      Only run cases whose name contains TEXT.
+// --quick            Less time per case (less accurate).
+// --compare FILE     Compare with the output of an earlier run saved in
+//                    FILE.  The lines are then:
+//                    name,ns_per_op,baseline_ns_per_op,ratio[,SLOWER]
+//                    and the exit status is 1 if any case is slower than
+//                    the baseline by more than the tolerance.
+// --tolerance PCT    Tolerance for --compare (default 10 percent).
+
+#include "bitfield.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const unsigned Record_storage = 4;
+
+const std::size_t Num_records = std::size_t(1) << 16;
+
+// Runtime copies of the field offset and width, so that the compiler
+// cannot use their values in the Bitfield::fn() cases.
+volatile unsigned rt_first_bit, rt_field_width;
+
+volatile uint64_t sink;
+
+struct Options
+  {
+    std::string filter;
+
+    bool quick = false;
+
+    std::map<std::string, double> baseline;
+
+    bool compare = false;
+
+    double tolerance = 10.0;
+
+    bool any_slower = false;
+  };
+
+Options opt;
+
+template <typename V_t, typename S_t, bool Ls_first>
+struct Bench_traits : public Bitfield_traits_default<V_t, S_t>
+  {
+    static const bool Storage_ls_bit_first = Ls_first;
+  };
+
+// With offsets that can be more than 65535 bits.
+template <typename V_t, typename S_t, bool Ls_first>
+struct Bench_wide_traits : public Bench_traits<V_t, S_t, Ls_first>
+  {
+    typedef std::size_t Bit_offset_t;
+  };
+
+template <unsigned First_bit, unsigned Field_width>
+struct Fmt : public Bitfield_format
+  {
+    F<First_bit> pad;
+    F<Field_width> field;
+  };
+
+void report(const std::string &name, double ns)
+  {
+    if (!opt.compare)
+      {
+        std::printf("%s,%.3f\n", name.c_str(), ns);
+        return;
+      }
+
+    std::map<std::string, double>::const_iterator b = opt.baseline.find(name);
+
+    if (b == opt.baseline.end())
+      {
+        std::printf("%s,%.3f,,\n", name.c_str(), ns);
+        return;
+      }
+
+    const double ratio = ns / b->second;
+
+    const bool slower = ratio > (1.0 + (opt.tolerance / 100.0));
+
+    if (slower)
+      opt.any_slower = true;
+
+    std::printf(
+      "%s,%.3f,%.3f,%.3f%s\n", name.c_str(), ns, b->second, ratio,
+      slower ? ",SLOWER" : "");
+  }
+
+// Times pass (a function of the array and the number of records that
+// does the operation once for each record), reporting the best time per
+// record of several trials.
+template <typename S_t, class Pass>
+void run(const std::string &name, std::vector<S_t> &a, Pass pass)
+  {
+    if (name.find(opt.filter) == std::string::npos)
+      return;
+
+    typedef std::chrono::steady_clock Clock;
+
+    const std::chrono::nanoseconds Min_trial(opt.quick ? 2000000 : 20000000);
+
+    const unsigned Trials = opt.quick ? 2 : 5;
+
+    double best = 0;
+
+    for (unsigned t = 0; t < Trials; ++t)
+      {
+        unsigned long passes = 0;
+
+        const Clock::time_point start = Clock::now();
+
+        Clock::duration elapsed;
+
+        do
+          {
+            sink = sink + pass(&a[0], Num_records);
+            ++passes;
+            elapsed = Clock::now() - start;
+          }
+        while (elapsed < Min_trial);
+
+        const double ns =
+          double(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+              elapsed).count()) /
+          (double(passes) * Num_records);
+
+        if ((t == 0) || (ns < best))
+          best = ns;
+      }
+
+    report(name, best);
+  }
+
+// Makes bit field objects for each record, in different ways.
+
+template <class Bf, unsigned First_bit, unsigned Field_width>
+struct Bitf_acc
+  {
+    typedef Bitfield_w_fmt<Bf, Fmt<First_bit, Field_width> > Bwf;
+
+    typename Bf::Bf operator () (typename Bf::Storage_t *p) const
+      { return(BITF(Bwf, p, field)); }
+  };
+
+// (What BITF_S expands to, which cannot be used with a dependent type.)
+template <class Bf, unsigned First_bit, unsigned Field_width>
+struct Bitf_s_acc
+  {
+    typedef typename Bf::template Static_bf<First_bit, Field_width> Sbf;
+
+    Sbf operator () (typename Bf::Storage_t *p) const { return(Sbf(p)); }
+  };
+
+template <class Bf, unsigned First_bit, unsigned Field_width>
+struct F_acc
+  {
+    typename Bf::Bf operator () (typename Bf::Storage_t *p) const
+      { return(Bf::f(p, &Fmt<First_bit, Field_width>::field)); }
+  };
+
+template <class Bf>
+struct Fn_acc
+  {
+    unsigned first_bit, field_width;
+
+    typename Bf::Bf operator () (typename Bf::Storage_t *p) const
+      { return(Bf::fn(p, first_bit, field_width)); }
+  };
+
+// Bitfield::Descriptor , made from the run-time offset and width.
+template <class Bf>
+struct Desc_acc
+  {
+    typedef typename Bf::Value_t Value_t;
+    typedef typename Bf::Storage_t Storage_t;
+
+    typename Bf::Descriptor d;
+
+    // Bound to a record, with the member functions of Bf used by
+    // time_ops().
+    class Ref
+      {
+      public:
+
+        Ref(const typename Bf::Descriptor &d_, Storage_t *p_)
+          : d(d_), p(p_)
+          { }
+
+        Value_t read() const { return(d.read(p)); }
+
+        Value_t read_sign_extend() const { return(d.read_sign_extend(p)); }
+
+        bool write(Value_t v) const { return(d.write(p, v)); }
+
+        bool write_nvc(Value_t v) const { return(d.write_nvc(p, v)); }
+
+        bool b_or(Value_t v) const { return(d.b_or(p, v)); }
+
+        bool b_xor(Value_t v) const { return(d.b_xor(p, v)); }
+
+        bool b_comp() const { return(d.b_comp(p)); }
+
+      private:
+
+        const typename Bf::Descriptor &d;
+
+        Storage_t *p;
+      };
+
+    Ref operator () (Storage_t *p) const { return(Ref(d, p)); }
+  };
+
+template <typename V_t, typename S_t, class Acc>
+void time_ops(const std::string &prefix, std::vector<S_t> &a, Acc acc)
+  {
+    run(prefix + "/read", a,
+        [acc](S_t *p, std::size_t n)
+          {
+            V_t s = 0;
+            for (std::size_t i = 0; i < n; ++i)
+              s += acc(p + (i * Record_storage)).read();
+            return(uint64_t(s));
+          });
+
+    run(prefix + "/read_sign_extend", a,
+        [acc](S_t *p, std::size_t n)
+          {
+            V_t s = 0;
+            for (std::size_t i = 0; i < n; ++i)
+              s += acc(p + (i * Record_storage)).read_sign_extend();
+            return(uint64_t(s));
+          });
+
+    run(prefix + "/write", a,
+        [acc](S_t *p, std::size_t n)
+          {
+            for (std::size_t i = 0; i < n; ++i)
+              acc(p + (i * Record_storage)).write(V_t(i & 0x1f));
+            return(uint64_t(0));
+          });
+
+    run(prefix + "/write_nvc", a,
+        [acc](S_t *p, std::size_t n)
+          {
+            for (std::size_t i = 0; i < n; ++i)
+              acc(p + (i * Record_storage)).write_nvc(V_t(i & 0x1f));
+            return(uint64_t(0));
+          });
+
+    run(prefix + "/or", a,
+        [acc](S_t *p, std::size_t n)
+          {
+            for (std::size_t i = 0; i < n; ++i)
+              acc(p + (i * Record_storage)).b_or(V_t(i & 0x1f));
+            return(uint64_t(0));
+          });
+
+    run(prefix + "/xor", a,
+        [acc](S_t *p, std::size_t n)
+          {
+            for (std::size_t i = 0; i < n; ++i)
+              acc(p + (i * Record_storage)).b_xor(V_t(i & 0x1f));
+            return(uint64_t(0));
+          });
+
+    run(prefix + "/comp", a,
+        [acc](S_t *p, std::size_t n)
+          {
+            for (std::size_t i = 0; i < n; ++i)
+              acc(p + (i * Record_storage)).b_comp();
+            return(uint64_t(0));
+          });
+  }
+
+// Native bit fields with the same layout as Fmt<First_bit, Field_width>
+// (with GCC on x86, where bit fields are allocated LS bit first).
+
+template <typename S_t> struct Signed;
+template <> struct Signed<uint8_t> { typedef int8_t T; };
+template <> struct Signed<uint16_t> { typedef int16_t T; };
+template <> struct Signed<uint32_t> { typedef int32_t T; };
+template <> struct Signed<uint64_t> { typedef int64_t T; };
+
+template <typename S_t, unsigned First_bit, unsigned Field_width>
+struct Native
+  {
+    S_t pad : First_bit;
+    S_t field : Field_width;
+    S_t rest[Record_storage - 1];
+  };
+
+template <typename S_t, unsigned First_bit, unsigned Field_width>
+struct Native_signed
+  {
+    S_t pad : First_bit;
+    typename Signed<S_t>::T field : Field_width;
+    S_t rest[Record_storage - 1];
+  };
+
+template <typename V_t, typename S_t, unsigned First_bit, unsigned Field_width>
+void time_native(const std::string &prefix, std::vector<S_t> &a)
+  {
+    typedef Native<S_t, First_bit, Field_width> N;
+    typedef Native_signed<S_t, First_bit, Field_width> Ns;
+
+    static_assert(sizeof(N) == (Record_storage * sizeof(S_t)), "layout");
+
+    run(prefix + "/read", a,
+        [](S_t *p, std::size_t n)
+          {
+            N *r = reinterpret_cast<N *>(p);
+            V_t s = 0;
+            for (std::size_t i = 0; i < n; ++i)
+              s += r[i].field;
+            return(uint64_t(s));
+          });
+
+    run(prefix + "/read_sign_extend", a,
+        [](S_t *p, std::size_t n)
+          {
+            Ns *r = reinterpret_cast<Ns *>(p);
+            V_t s = 0;
+            for (std::size_t i = 0; i < n; ++i)
+              s += V_t(r[i].field);
+            return(uint64_t(s));
+          });
+
+    run(prefix + "/write", a,
+        [](S_t *p, std::size_t n)
+          {
+            N *r = reinterpret_cast<N *>(p);
+            for (std::size_t i = 0; i < n; ++i)
+              r[i].field = S_t(i & 0x1f);
+            return(uint64_t(0));
+          });
+
+    run(prefix + "/or", a,
+        [](S_t *p, std::size_t n)
+          {
+            N *r = reinterpret_cast<N *>(p);
+            for (std::size_t i = 0; i < n; ++i)
+              r[i].field |= S_t(i & 0x1f);
+            return(uint64_t(0));
+          });
+
+    run(prefix + "/xor", a,
+        [](S_t *p, std::size_t n)
+          {
+            N *r = reinterpret_cast<N *>(p);
+            for (std::size_t i = 0; i < n; ++i)
+              r[i].field ^= S_t(i & 0x1f);
+            return(uint64_t(0));
+          });
+
+    run(prefix + "/comp", a,
+        [](S_t *p, std::size_t n)
+          {
+            N *r = reinterpret_cast<N *>(p);
+            for (std::size_t i = 0; i < n; ++i)
+              r[i].field = ~r[i].field;
+            return(uint64_t(0));
+          });
+  }
+
+template <typename T>
+const char * type_name()
+  {
+    switch (sizeof(T))
+      {
+      case 1: return("8");
+      case 2: return("16");
+      case 4: return("32");
+      default: return("64");
+      }
+  }
+
+template <
+  typename V_t, typename S_t, bool Ls_first, unsigned First_bit,
+  unsigned Field_width>
+void time_field(const char *kind)
+  {
+    typedef Bitfield<Bench_traits<V_t, S_t, Ls_first> > Bf;
+
+    typedef Bitfield<Bench_wide_traits<V_t, S_t, Ls_first> > Bf_wide;
+
+    std::vector<S_t> a(Num_records * Record_storage);
+
+    for (std::size_t i = 0; i < a.size(); ++i)
+      a[i] = S_t(i * 0x9e3779b97f4a7c15ULL);
+
+    std::ostringstream p;
+
+    p << 'S' << type_name<S_t>() << "/V" << type_name<V_t>() << '/'
+      << (Ls_first ? "ls" : "ms") << '/' << kind << "/off" << First_bit
+      << "/w" << Field_width << '/';
+
+    time_ops<V_t>(
+      p.str() + "bitf", a, Bitf_acc<Bf, First_bit, Field_width>());
+
+    time_ops<V_t>(
+      p.str() + "bitf_s", a, Bitf_s_acc<Bf, First_bit, Field_width>());
+
+    time_ops<V_t>(p.str() + "f", a, F_acc<Bf, First_bit, Field_width>());
+
+    rt_first_bit = First_bit;
+    rt_field_width = Field_width;
+
+    Fn_acc<Bf> fn_acc;
+
+    fn_acc.first_bit = rt_first_bit;
+    fn_acc.field_width = rt_field_width;
+
+    time_ops<V_t>(p.str() + "fn", a, fn_acc);
+
+    Desc_acc<Bf> desc_acc;
+
+    desc_acc.d = typename Bf::Descriptor(rt_first_bit, rt_field_width);
+
+    time_ops<V_t>(p.str() + "desc", a, desc_acc);
+
+    Fn_acc<Bf_wide> fn_wide_acc;
+
+    fn_wide_acc.first_bit = rt_first_bit;
+    fn_wide_acc.field_width = rt_field_width;
+
+    time_ops<V_t>(p.str() + "fn_wide", a, fn_wide_acc);
+
+    Desc_acc<Bf_wide> desc_wide_acc;
+
+    desc_wide_acc.d =
+      typename Bf_wide::Descriptor(rt_first_bit, rt_field_width);
+
+    time_ops<V_t>(p.str() + "desc_wide", a, desc_wide_acc);
+  }
+
+template <typename V_t, typename S_t, unsigned First_bit, unsigned Field_width>
+void time_native_field()
+  {
+    std::vector<S_t> a(Num_records * Record_storage);
+
+    std::ostringstream p;
+
+    p << 'S' << type_name<S_t>() << "/V" << type_name<V_t>()
+      << "/ls/nostraddle/off" << First_bit << "/w" << Field_width
+      << "/native";
+
+    time_native<V_t, S_t, First_bit, Field_width>(p.str(), a);
+  }
+
+// Non-straddling and straddling fields for storage type S_t .
+template <
+  typename V_t, typename S_t, unsigned Ns_first, unsigned Ns_width,
+  unsigned S_first, unsigned S_width>
+void time_storage()
+  {
+    time_native_field<V_t, S_t, Ns_first, Ns_width>();
+
+    time_field<V_t, S_t, true, Ns_first, Ns_width>("nostraddle");
+    time_field<V_t, S_t, false, Ns_first, Ns_width>("nostraddle");
+    time_field<V_t, S_t, true, S_first, S_width>("straddle");
+    time_field<V_t, S_t, false, S_first, S_width>("straddle");
+  }
+
+bool load_baseline(const char *file)
+  {
+    std::ifstream in(file);
+
+    if (!in)
+      return(false);
+
+    std::string line;
+
+    while (std::getline(in, line))
+      {
+        std::string::size_type c = line.find(',');
+
+        if (c == std::string::npos)
+          continue;
+
+        opt.baseline[line.substr(0, c)] =
+          std::strtod(line.c_str() + c + 1, 0);
+      }
+
+    return(true);
+  }
+
+} // end anonymous namespace
+
+int main(int argc, char **argv)
+  {
+    for (int i = 1; i < argc; ++i)
+      {
+        if (!std::strcmp(argv[i], "--quick"))
+          opt.quick = true;
+        else if (!std::strcmp(argv[i], "--filter") && ((i + 1) < argc))
+          opt.filter = argv[++i];
+        else if (!std::strcmp(argv[i], "--compare") && ((i + 1) < argc))
+          {
+            if (!load_baseline(argv[++i]))
+              {
+                std::fprintf(stderr, "cannot read %s\n", argv[i]);
+                return(2);
+              }
+
+            opt.compare = true;
+          }
+        else if (!std::strcmp(argv[i], "--tolerance") && ((i + 1) < argc))
+          opt.tolerance = std::strtod(argv[++i], 0);
+        else
+          {
+            std::fprintf(
+              stderr,
+              "usage: %s [--filter TEXT] [--quick] [--compare FILE] "
+              "[--tolerance PCT]\n", argv[0]);
+            return(2);
+          }
+      }
+
+    time_storage<uint32_t, uint8_t, 1, 5, 5, 7>();
+    time_storage<uint32_t, uint16_t, 3, 9, 13, 7>();
+    time_storage<uint32_t, uint32_t, 5, 17, 29, 7>();
+    time_storage<uint64_t, uint32_t, 5, 17, 21, 40>();
+    time_storage<uint64_t, uint64_t, 7, 40, 60, 20>();
+
+    // Value wider than two storage locations.
+    time_field<uint64_t, uint8_t, true, 5, 20>("straddle");
+    time_field<uint64_t, uint8_t, false, 5, 20>("straddle");
+
+    return(opt.any_slower ? 1 : 0);
+  }
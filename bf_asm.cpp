@@ -90,3 +90,57 @@ Bf22::Value_t r22t(Bf22::Storage_t *p)
   { return(Bf22::f(p, &Fmt::data).read()); }
 void w22t(Bf22::Storage_t *p, Bf22::Value_t v)
   { Bf22::f(p, &Fmt::data) = v; }
+
+// Compile-time offset and width, should match base language bit fields
+// even when Bwf::Bf does not fully fold.
+
+Bf11::Value_t r11s(Bf11::Storage_t *p)
+  { return(BITF_S(Bwf11, p, data).read()); }
+void w11s(Bf11::Storage_t *p, Bf11::Value_t v)
+  { BITF_S(Bwf11, p, data).write(v); }
+
+Bf12::Value_t r12s(Bf12::Storage_t *p)
+  { return(BITF_S(Bwf12, p, data)); }
+void w12s(Bf12::Storage_t *p, Bf12::Value_t v)
+  { BITF_S(Bwf12, p, data) = v; }
+
+Bf21::Value_t r21s(Bf21::Storage_t *p)
+  { return(BITF_S(Bwf21, p, data).read()); }
+void w21s(Bf21::Storage_t *p, Bf21::Value_t v)
+  { BITF_S(Bwf21, p, data).write(v); }
+
+Bf22::Value_t r22s(Bf22::Storage_t *p)
+  { return(BITF_S(Bwf22, p, data)); }
+void w22s(Bf22::Storage_t *p, Bf22::Value_t v)
+  { BITF_S(Bwf22, p, data) = v; }
+
+// Plain memory storage, wide loads and stores for the straddling field.
+
+typedef Bitfield<Bitfield_traits_plain_memory<uint64_t, uint8_t> > Bf11p;
+typedef Bitfield_w_fmt<Bf11p, Fmt> Bwf11p;
+
+Bf11p::Value_t r11p(Bf11p::Storage_t *p)
+  { return(BITF(Bwf11p, p, data).read()); }
+void w11p(Bf11p::Storage_t *p, Bf11p::Value_t v)
+  { BITF(Bwf11p, p, data).write(v); }
+
+Bf11p::Value_t r11ps(Bf11p::Storage_t *p)
+  { return(BITF_S(Bwf11p, p, data).read()); }
+void w11ps(Bf11p::Storage_t *p, Bf11p::Value_t v)
+  { BITF_S(Bwf11p, p, data).write(v); }
+
+// Big-endian storage, should be a load and a byte swap.
+
+struct Bft_be : public Bitfield_traits_default<uint32_t>
+  {
+    typedef Bitfield_byte_swap_access<
+        Bitfield_plain_memory_access<uint32_t>, Bitfield_big_endian>
+      Storage_access_t;
+  };
+
+typedef Bitfield<Bft_be> Bf31be;
+
+Bf31be::Value_t r31be(Bf31be::Storage_t *p)
+  { return(Bf31be::fn(p, 8, 12)); }
+void w31be(Bf31be::Storage_t *p, Bf31be::Value_t v)
+  { Bf31be::fn(p, 8, 12) = v; }
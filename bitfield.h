@@ -26,6 +26,8 @@ SOFTWARE.
 
 #include <cstddef> // For definition of offsetof.
 
+#include <cstring> // For definition of memcpy.
+
 // noexcept Use -- Since all the functions here are inlined, I'm assuming
 // it's not important to conditionally make any of them noexcept based on:
 // https://waltsgeekblog.quora.com/G++-inline-and-noexcept
@@ -138,8 +140,9 @@ struct Ms_read
         field_width -= Storage_bits - first_bit;
 
         Value_t v =
-          ms_read_s<Storage_access_t, Storage_t>(
-            base, first_bit, Storage_bits - first_bit) << field_width;
+          Value_t(
+            ms_read_s<Storage_access_t, Storage_t>(
+              base, first_bit, Storage_bits - first_bit)) << field_width;
 
         base += 1;
 
@@ -156,6 +159,43 @@ struct Ms_read<Bitfield_traits, Max_value_to_storage_bits_ratio + 1>
       { return(0); }
   };
 
+// Marks a modifier that changes each storage location only with one of
+// the Storage_ops b_and(), b_or() or b_xor() functions, or (for a whole
+// storage location) only with write() .
+struct Single_op_modifier { };
+
+// The modify templates below pass the change to each storage location
+// through Storage_ops<Storage_access_t>::modify() , and the built-in
+// modifiers use its b_and(), b_or() and b_xor() functions.  This is an
+// extension point:  specialize it for a storage access class whose
+// locations must be changed some other way (for example, atomically).
+template <class Storage_access_t>
+struct Storage_ops
+  {
+    template <class Modifier>
+    static void modify(
+      Storage_access_t s, Modifier &m, unsigned storage_shift,
+      unsigned value_shift, unsigned storage_width)
+      { m(s, storage_shift, value_shift, storage_width); }
+
+    // For the modifiers of Bitfield::Static_bf .
+    template <class Modifier, class Piece>
+    static void modify(Storage_access_t s, Modifier &m, Piece p)
+      { m(s, p); }
+
+    template <typename Storage_t>
+    static void b_and(Storage_access_t s, Storage_t x)
+      { s.write(static_cast<Storage_t>(x & s.read())); }
+
+    template <typename Storage_t>
+    static void b_or(Storage_access_t s, Storage_t x)
+      { s.write(static_cast<Storage_t>(x | s.read())); }
+
+    template <typename Storage_t>
+    static void b_xor(Storage_access_t s, Storage_t x)
+      { s.write(static_cast<Storage_t>(x ^ s.read())); }
+  };
+
 template <class Bitfield_traits, class Modifier, unsigned Depth>
 struct Ls_modify
   {
@@ -170,12 +210,14 @@ struct Ls_modify
       unsigned first_value_bit, unsigned field_width, Modifier m)
       {
         if ((first_storage_bit + field_width) <= Storage_bits)
-          m(base, first_storage_bit, first_value_bit, field_width);
+          Storage_ops<Storage_access_t>::modify(
+            base, m, first_storage_bit, first_value_bit, field_width);
         else
           {
             unsigned storage_width = Storage_bits - first_storage_bit;
 
-            m(base, first_storage_bit, first_value_bit, storage_width);
+            Storage_ops<Storage_access_t>::modify(
+              base, m, first_storage_bit, first_value_bit, storage_width);
 
             base += 1;
 
@@ -211,14 +253,15 @@ struct Ms_modify
       Modifier m)
       {
         if ((first_storage_bit + field_width) <= Storage_bits)
-          m(
-            base, Storage_bits - field_width - first_storage_bit, 0,
+          Storage_ops<Storage_access_t>::modify(
+            base, m, Storage_bits - field_width - first_storage_bit, 0,
             field_width);
         else
           {
             unsigned storage_width = Storage_bits - first_storage_bit;
 
-            m(base, 0, field_width - storage_width, storage_width);
+            Storage_ops<Storage_access_t>::modify(
+              base, m, 0, field_width - storage_width, storage_width);
 
             base += 1;
 
@@ -239,262 +282,1852 @@ struct Ms_modify<Bitfield_traits, Modifier, Max_value_to_storage_bits_ratio + 1>
       { }
   };
 
-template<typename Value_t>
-struct Err_act_default
+// Compile-time counterpart of mask().
+template<typename U, unsigned Bit_width,
+         bool Full = (Bit_width == Num_bits<U>::Value)>
+struct Static_mask
   {
-    static void field_too_wide(unsigned /* field_width */) { }
-    static void value_too_big(Value_t /* v */, unsigned /* field_width */) { }
+    static const U Value = static_cast<U>((U(1) << Bit_width) - 1);
   };
 
-} // namespace Bitfield_impl
+template<typename U, unsigned Bit_width>
+struct Static_mask<U, Bit_width, true>
+  {
+    static const U Value = static_cast<U>(~U(0));
+  };
 
-template <typename V_t = unsigned, typename S_t = V_t>
-class Bitfield_traits_default
+// Describes, with compile-time constants, the part of a bit field that
+// is in one storage location.  An instance is passed to the modifiers of
+// Bitfield::Static_bf in place of the shift and width parameters passed
+// to the modifiers of Bitfield::Bf .
+template <typename Storage_t, unsigned Storage_shift_, unsigned Value_shift_,
+          unsigned Storage_width_>
+struct Static_piece
   {
-  public:
+    static const unsigned Storage_shift = Storage_shift_;
 
-    typedef V_t Value_t;
+    static const unsigned Value_shift = Value_shift_;
 
-    typedef S_t Storage_t;
+    static const unsigned Storage_width = Storage_width_;
 
-    class Storage_access_t
-      {
-      public:
+    // Bits of the storage location that are in the bit field.
+    static const Storage_t Mask =
+      static_cast<Storage_t>(
+        Static_mask<Storage_t, Storage_width_>::Value << Storage_shift_);
 
-        typedef S_t Storage_t;
+    // True if the bit field covers the whole storage location.
+    static const bool Whole = Storage_width_ == Num_bits<Storage_t>::Value;
+  };
 
-        Storage_access_t(Storage_t *p) : ptr(p) { }
+// The Static_ templates below are the counterparts of Ls_read, Ms_read,
+// Ls_modify and Ms_modify for bit fields whose offset (in the first
+// storage location) and width are template parameters.  Whether the bit
+// field straddles a storage location boundary is resolved by
+// specialization.
+
+template <class Bitfield_traits, unsigned First_bit, unsigned Field_width,
+          bool Straddle =
+            ((First_bit + Field_width) >
+             Num_bits<typename Bitfield_traits::Storage_t>::Value)>
+struct Ls_static_read
+  {
+    typedef typename Bitfield_traits::Value_t Value_t;
 
-        void operator += (unsigned offset) { ptr += offset; }
+    typedef typename Bitfield_traits::Storage_t Storage_t;
 
-        Storage_t read() { return(*ptr); }
+    typedef typename Bitfield_traits::Storage_access_t Storage_access_t;
 
-        void write(Storage_t t) { *ptr = t; }
+    static Value_t x(Storage_access_t base)
+      {
+        return(
+          (base.read() >> First_bit) &
+          Static_mask<Storage_t, Field_width>::Value);
+      }
+  };
 
-      private:
+template <class Bitfield_traits, unsigned First_bit, unsigned Field_width>
+struct Ls_static_read<Bitfield_traits, First_bit, Field_width, true>
+  {
+    typedef typename Bitfield_traits::Value_t Value_t;
 
-        Storage_t *ptr;
+    typedef typename Bitfield_traits::Storage_t Storage_t;
 
-      };
+    typedef typename Bitfield_traits::Storage_access_t Storage_access_t;
 
-    static const bool Storage_ls_bit_first = true;
+    static const unsigned Low_width = Num_bits<Storage_t>::Value - First_bit;
 
-    static const bool Fmt_offset_from_start = true;
+    static Value_t x(Storage_access_t base)
+      {
+        Value_t v =
+          Ls_static_read<Bitfield_traits, First_bit, Low_width>::x(base);
 
-    static const bool Fmt_align_at_zero_offset = true;
+        base += 1;
 
-  }; // class Bitfields_traits_default
+        return(
+          v |
+          (Ls_static_read<Bitfield_traits, 0, Field_width - Low_width>::x(
+             base) << Low_width));
+      }
+  };
 
-#define BITF_DEF_F \
-template <unsigned BITF_WIDTH> struct F { char x[BITF_WIDTH]; };
+template <class Bitfield_traits, unsigned First_bit, unsigned Field_width,
+          bool Straddle =
+            ((First_bit + Field_width) >
+             Num_bits<typename Bitfield_traits::Storage_t>::Value)>
+struct Ms_static_read
+  {
+    typedef typename Bitfield_traits::Value_t Value_t;
 
-struct Bitfield_format { BITF_DEF_F };
+    typedef typename Bitfield_traits::Storage_t Storage_t;
 
-template <
-  class Traits = Bitfield_traits_default<unsigned>,
-  class Err_act = Bitfield_impl::Err_act_default<typename Traits::Value_t> >
-class Bitfield
+    typedef typename Bitfield_traits::Storage_access_t Storage_access_t;
+
+    static Value_t x(Storage_access_t base)
+      {
+        return(
+          (base.read() >>
+           (Num_bits<Storage_t>::Value - First_bit - Field_width)) &
+          Static_mask<Storage_t, Field_width>::Value);
+      }
+  };
+
+template <class Bitfield_traits, unsigned First_bit, unsigned Field_width>
+struct Ms_static_read<Bitfield_traits, First_bit, Field_width, true>
   {
-  public:
+    typedef typename Bitfield_traits::Value_t Value_t;
 
-    typedef typename Traits::Value_t Value_t;
+    typedef typename Bitfield_traits::Storage_t Storage_t;
 
-    typedef typename Traits::Storage_t Storage_t;
+    typedef typename Bitfield_traits::Storage_access_t Storage_access_t;
 
-    typedef typename Traits::Storage_access_t Storage_access_t;
+    static const unsigned High_width = Num_bits<Storage_t>::Value - First_bit;
 
-    static const bool Storage_ls_bit_first = Traits::Storage_ls_bit_first;
+    static Value_t x(Storage_access_t base)
+      {
+        Value_t v =
+          Ms_static_read<Bitfield_traits, First_bit, High_width>::x(base) <<
+          (Field_width - High_width);
 
-    static const bool Fmt_offset_from_start = Traits::Fmt_offset_from_start;
+        base += 1;
 
-    static const bool Fmt_align_at_zero_offset =
-      Traits::Fmt_align_at_zero_offset;
+        return(
+          v |
+          Ms_static_read<Bitfield_traits, 0, Field_width - High_width>::x(
+            base));
+      }
+  };
 
-    static const unsigned Storage_bits =
-      Bitfield_impl::Num_bits<Storage_t>::Value;
+template <class Bitfield_traits, class Modifier, unsigned First_bit,
+          unsigned Field_width, unsigned Value_shift = 0,
+          bool Straddle =
+            ((First_bit + Field_width) >
+             Num_bits<typename Bitfield_traits::Storage_t>::Value)>
+struct Ls_static_modify
+  {
+    typedef typename Bitfield_traits::Storage_t Storage_t;
 
-    template<class Format>
-    struct Define
+    typedef typename Bitfield_traits::Storage_access_t Storage_access_t;
+
+    static void x(Storage_access_t base, Modifier &m)
       {
-        static const unsigned Storage_bits =
-          Bitfield_impl::Num_bits<Storage_t>::Value;
+        Storage_ops<Storage_access_t>::modify(
+          base, m,
+          Static_piece<Storage_t, First_bit, Value_shift, Field_width>());
+      }
+  };
 
-        static const unsigned Dimension =
-          (sizeof(Format) + Storage_bits - 1) / Storage_bits;
+template <class Bitfield_traits, class Modifier, unsigned First_bit,
+          unsigned Field_width, unsigned Value_shift>
+struct Ls_static_modify<
+  Bitfield_traits, Modifier, First_bit, Field_width, Value_shift, true>
+  {
+    typedef typename Bitfield_traits::Storage_t Storage_t;
 
-        typedef Storage_t T[Dimension];
-      };
+    typedef typename Bitfield_traits::Storage_access_t Storage_access_t;
 
-    static Value_t mask(unsigned field_width)
+    static const unsigned Storage_width =
+      Num_bits<Storage_t>::Value - First_bit;
+
+    static void x(Storage_access_t base, Modifier &m)
       {
-        return(Bitfield_impl::mask<Value_t>(field_width));
+        Storage_ops<Storage_access_t>::modify(
+          base, m,
+          Static_piece<Storage_t, First_bit, Value_shift, Storage_width>());
+
+        base += 1;
+
+        Ls_static_modify<
+          Bitfield_traits, Modifier, 0, Field_width - Storage_width,
+          Value_shift + Storage_width>::x(base, m);
       }
+  };
 
-    class Modifier_base
-      {
-      public:
+template <class Bitfield_traits, class Modifier, unsigned First_bit,
+          unsigned Field_width,
+          bool Straddle =
+            ((First_bit + Field_width) >
+             Num_bits<typename Bitfield_traits::Storage_t>::Value)>
+struct Ms_static_modify
+  {
+    typedef typename Bitfield_traits::Storage_t Storage_t;
 
-        static Value_t value() { return(0); }
+    typedef typename Bitfield_traits::Storage_access_t Storage_access_t;
 
-      protected:
+    static void x(Storage_access_t base, Modifier &m)
+      {
+        Storage_ops<Storage_access_t>::modify(
+          base, m,
+          Static_piece<
+            Storage_t, Num_bits<Storage_t>::Value - Field_width - First_bit,
+            0, Field_width>());
+      }
+  };
 
-        static Storage_t clear(
-          Storage_access_t s, unsigned shift, unsigned width)
-          {
-            if (width == Storage_bits)
-              return(0);
+template <class Bitfield_traits, class Modifier, unsigned First_bit,
+          unsigned Field_width>
+struct Ms_static_modify<
+  Bitfield_traits, Modifier, First_bit, Field_width, true>
+  {
+    typedef typename Bitfield_traits::Storage_t Storage_t;
 
-            return(
-              s.read() &
-              ~(Bitfield_impl::mask<Storage_t>(width) << shift));
-          }
-      };
+    typedef typename Bitfield_traits::Storage_access_t Storage_access_t;
 
-    class Value_modifier_base : public Modifier_base
+    static const unsigned Storage_width =
+      Num_bits<Storage_t>::Value - First_bit;
+
+    static void x(Storage_access_t base, Modifier &m)
       {
-      public:
+        Storage_ops<Storage_access_t>::modify(
+          base, m,
+          Static_piece<
+            Storage_t, 0, Field_width - Storage_width, Storage_width>());
 
-        Value_t value() const { return(val); }
+        base += 1;
 
-        Value_modifier_base(Value_t v) : val(v) { }
+        Ms_static_modify<
+          Bitfield_traits, Modifier, 0, Field_width - Storage_width>::x(
+            base, m);
+      }
+  };
 
-      private:
+template<typename T> struct Remove_cv { typedef T Type; };
+template<typename T> struct Remove_cv<const T> { typedef T Type; };
+template<typename T> struct Remove_cv<volatile T> { typedef T Type; };
+template<typename T> struct Remove_cv<const volatile T> { typedef T Type; };
 
-        const Value_t val;
-      };
+// A storage access type may optionally have member functions to transfer
+// a run of consecutive storage locations in one burst:
+//
+// void read_block(unsigned offset, unsigned count, Storage_t *dst);
+// void write_block(unsigned offset, unsigned count, const Storage_t *src);
+//
+// offset is relative to the storage location the access object refers to.
 
-    class Bf
-      {
-      private:
+template <class Storage_access_t>
+struct Has_read_block
+  {
+    typedef typename Remove_cv<typename Storage_access_t::Storage_t>::Type S;
 
-        const Storage_access_t base;
+    template <class A, void (A::*)(unsigned, unsigned, S *)>
+    struct Sig { };
 
-        const unsigned short first_bit, field_width;
+    template <class A>
+    static char test(Sig<A, &A::read_block> *);
 
-      public:
+    template <class A>
+    static long test(...);
 
-        Bf(
-          Storage_access_t base_, unsigned short first_bit_,
-          unsigned short field_width_)
-          : base(base_), first_bit(first_bit_), field_width(field_width_)
-          { }
+    static const bool Value = sizeof(test<Storage_access_t>(0)) == 1;
+  };
 
-        unsigned short offset() { return(first_bit); }
+template <class Storage_access_t>
+struct Has_write_block
+  {
+    typedef typename Remove_cv<typename Storage_access_t::Storage_t>::Type S;
 
-        unsigned short width() { return(field_width); }
+    template <class A, void (A::*)(unsigned, unsigned, const S *)>
+    struct Sig { };
 
-        bool is_width_invalid()
+    template <class A>
+    static char test(Sig<A, &A::write_block> *);
+
+    template <class A>
+    static long test(...);
+
+    static const bool Value = sizeof(test<Storage_access_t>(0)) == 1;
+  };
+
+template <
+  class Storage_access_t,
+  bool Read_block = Has_read_block<Storage_access_t>::Value>
+struct Block_read
+  {
+    typedef typename Remove_cv<typename Storage_access_t::Storage_t>::Type S;
+
+    static void x(Storage_access_t sa, unsigned offset, unsigned count, S *dst)
+      {
+        sa += offset;
+
+        for (unsigned i = 0; i < count; ++i)
           {
-            return((field_width == 0) ||
-                   (field_width > Bitfield_impl::Num_bits<Value_t>::Value));
+            Storage_access_t sa_(sa);
+
+            sa_ += i;
+
+            dst[i] = sa_.read();
           }
+      }
+  };
 
-        Value_t read()
-          {
-            if (!check_width())
-              return(~(Value_t(0)));
+template <class Storage_access_t>
+struct Block_read<Storage_access_t, true>
+  {
+    typedef typename Remove_cv<typename Storage_access_t::Storage_t>::Type S;
 
-            Storage_access_t access(base);
-            access += (first_bit / Storage_bits);
+    static void x(Storage_access_t sa, unsigned offset, unsigned count, S *dst)
+      { sa.read_block(offset, count, dst); }
+  };
 
-            if (Traits::Storage_ls_bit_first)
-              return(
-                Bitfield_impl::Ls_read<Traits, 0>::x(
-                  access, first_bit % Storage_bits, field_width));
+template <
+  class Storage_access_t,
+  bool Write_block = Has_write_block<Storage_access_t>::Value>
+struct Block_write
+  {
+    typedef typename Remove_cv<typename Storage_access_t::Storage_t>::Type S;
 
-            return(
-              Bitfield_impl::Ms_read<Traits, 0>::x(
-                access, first_bit % Storage_bits, field_width));
+    static void x(
+      Storage_access_t sa, unsigned offset, unsigned count, const S *src)
+      {
+        sa += offset;
+
+        for (unsigned i = 0; i < count; ++i)
+          {
+            Storage_access_t sa_(sa);
+
+            sa_ += i;
+
+            sa_.write(src[i]);
           }
+      }
+  };
 
-        operator Value_t () { return(read()); }
+template <class Storage_access_t>
+struct Block_write<Storage_access_t, true>
+  {
+    typedef typename Remove_cv<typename Storage_access_t::Storage_t>::Type S;
 
-        Value_t read_sign_extend()
-          {
-            Value_t v = read();
+    static void x(
+      Storage_access_t sa, unsigned offset, unsigned count, const S *src)
+      { sa.write_block(offset, count, src); }
+  };
 
-            if (field_width)
-              {
-                Value_t m = ~mask(field_width - 1);
+// Transfers count consecutive storage locations, starting at offset, with
+// read_block() or write_block() if the storage access type has it, one
+// storage location at a time otherwise.
+template <class Storage_access_t>
+struct Block_transfer
+  {
+    typedef typename Remove_cv<typename Storage_access_t::Storage_t>::Type S;
 
-                if (m & v)
-                  v |= m;
-              }
+    static const bool Has_read_block =
+      Bitfield_impl::Has_read_block<Storage_access_t>::Value;
 
-            return(v);
-          }
+    static const bool Has_write_block =
+      Bitfield_impl::Has_write_block<Storage_access_t>::Value;
 
-        template <class Modifier>
-        bool modify_nvc(Modifier m)
-          {
-            if (!check_width())
-              return(false);
+    static void read(
+      Storage_access_t sa, unsigned offset, unsigned count, S *dst)
+      {
+        if (count != 0)
+          Block_read<Storage_access_t>::x(sa, offset, count, dst);
+      }
 
-            Storage_access_t access(base);
-            access += (first_bit / Storage_bits);
+    static void write(
+      Storage_access_t sa, unsigned offset, unsigned count, const S *src)
+      {
+        if (count != 0)
+          Block_write<Storage_access_t>::x(sa, offset, count, src);
+      }
+  };
 
-            if (Traits::Storage_ls_bit_first)
-              Bitfield_impl::Ls_modify<Traits, Modifier, 0>::x(
-                access, first_bit % Storage_bits, 0, field_width, m);
-            else
-              Bitfield_impl::Ms_modify<Traits, Modifier, 0>::x(
-                access, first_bit % Storage_bits, field_width, m);
+// Buffers the storage locations with offsets less than Num_storage, so
+// that each is read at most once, no matter how many bit fields are read
+// from it.  Storage locations at or past Num_storage are read directly.
+template <class Storage_access_t, typename Storage_t, unsigned Num_storage>
+class Read_once_buf
+  {
+  public:
 
-            return(true);
+    Read_once_buf(Storage_access_t sa_) : sa(sa_)
+      {
+        for (unsigned i = 0; i < Num_storage; ++i)
+          loaded[i] = false;
+      }
+
+    Storage_t read(unsigned offset)
+      {
+        if (offset >= Num_storage)
+          {
+            Storage_access_t sa_(sa);
+
+            sa_ += offset;
+
+            return(sa_.read());
           }
 
-        template <class Modifier>
-        bool modify(Modifier m)
+        if (!loaded[offset])
           {
-            if (!check_fit(m.value()))
-              return(false);
+            Storage_access_t sa_(sa);
 
-            return(modify_nvc(m));
+            sa_ += offset;
+
+            buffer[offset] = sa_.read();
+            loaded[offset] = true;
           }
 
-        bool write(Value_t val) { return(modify(Mod_write(val))); }
+        return(buffer[offset]);
+      }
+
+  private:
+
+    const Storage_access_t sa;
+
+    typename Remove_cv<Storage_t>::Type buffer[Num_storage];
+
+    bool loaded[Num_storage];
+  };
+
+// Read-only storage access type for Read_once_buf.
+template <class Storage_access_t, typename S_t, unsigned Num_storage>
+class Read_once_t
+  {
+  public:
+
+    typedef S_t Storage_t;
+
+    Read_once_t(Read_once_buf<Storage_access_t, S_t, Num_storage> &rob_)
+      : rob(rob_), cum_offset(0)
+      { }
+
+    void operator += (unsigned offset) { cum_offset += offset; }
+
+    Storage_t read() { return(rob.read(cum_offset)); }
+
+  private:
+
+    Read_once_buf<Storage_access_t, S_t, Num_storage> &rob;
+
+    unsigned cum_offset;
+  };
+
+// Accumulates changes to storage locations 0 through Num_storage - 1 as,
+// for each location, the bits to change and their new values.  Storage
+// locations past Num_storage - 1 are changed immediately.
+template <class Storage_access_t, typename Storage_t, unsigned Num_storage>
+class Write_combine_buf
+  {
+  public:
+
+    Write_combine_buf(Storage_access_t sa_) : sa(sa_) { discard(); }
+
+    // Set the bits of the storage location at the given offset that are
+    // one in change_mask to the corresponding bits of new_bits.
+    void update(unsigned offset, Storage_t change_mask, Storage_t new_bits)
+      {
+        new_bits &= change_mask;
+
+        if (offset >= Num_storage)
+          {
+            Storage_access_t sa_(sa);
+
+            sa_ += offset;
+
+            apply(sa_, change_mask, new_bits);
+          }
+        else
+          {
+            mask[offset] |= change_mask;
+            bits[offset] = static_cast<Storage_t>(
+              (bits[offset] & ~change_mask) | new_bits);
+          }
+      }
+
+    // Runs of consecutive storage locations whose bits are all changed
+    // are written with write_block() , if the storage access type has it.
+    void commit()
+      {
+        for (unsigned i = 0; i < Num_storage; ++i)
+          if (Block_transfer<Storage_access_t>::Has_write_block &&
+              all_changed(i) && ((i + 1) < Num_storage) &&
+              all_changed(i + 1))
+            {
+              unsigned n = 2;
+
+              while (((i + n) < Num_storage) && all_changed(i + n))
+                ++n;
+
+              typename Remove_cv<Storage_t>::Type b[Num_storage];
+
+              // Do this first in case of exception.
+              for (unsigned j = 0; j < n; ++j)
+                {
+                  b[j] = bits[i + j];
+                  mask[i + j] = 0;
+                  bits[i + j] = 0;
+                }
+
+              Block_transfer<Storage_access_t>::write(sa, i, n, b);
+
+              i += n - 1;
+            }
+          else if (mask[i])
+            {
+              Storage_t m = mask[i], b = bits[i];
+
+              // Do this first in case of exception.
+              mask[i] = 0;
+              bits[i] = 0;
+
+              Storage_access_t sa_(sa);
+
+              sa_ += i;
+
+              apply(sa_, m, b);
+            }
+      }
+
+    void discard()
+      {
+        for (unsigned i = 0; i < Num_storage; ++i)
+          {
+            mask[i] = 0;
+            bits[i] = 0;
+          }
+      }
+
+  private:
+
+    const Storage_access_t sa;
+
+    typename Remove_cv<Storage_t>::Type mask[Num_storage], bits[Num_storage];
+
+    bool all_changed(unsigned offset) const
+      { return(mask[offset] == static_cast<Storage_t>(~Storage_t(0))); }
+
+    static void apply(Storage_access_t s, Storage_t m, Storage_t b)
+      {
+        if (m == static_cast<Storage_t>(~Storage_t(0)))
+          s.write(b);
+        else
+          s.write(static_cast<Storage_t>((s.read() & ~m) | b));
+      }
+  };
+
+// Storage access type for Write_combine_buf.  It is passed to modifiers,
+// which call update() rather than read() and write() .
+template <class Storage_access_t, typename S_t, unsigned Num_storage>
+class Write_combine_t
+  {
+  public:
+
+    typedef S_t Storage_t;
+
+    Write_combine_t(Write_combine_buf<Storage_access_t, S_t, Num_storage> &wcb_)
+      : wcb(wcb_), cum_offset(0)
+      { }
+
+    void operator += (unsigned offset) { cum_offset += offset; }
+
+    void update(Storage_t change_mask, Storage_t new_bits)
+      { wcb.update(cum_offset, change_mask, new_bits); }
+
+  private:
+
+    Write_combine_buf<Storage_access_t, S_t, Num_storage> &wcb;
+
+    unsigned cum_offset;
+  };
+
+// The type of the offsets of bit fields (Type), and of the first_bit
+// parameter of Bitfield::fn() (Param).  If Traits has a nested type
+// Bit_offset_t, both are that type.  Otherwise (as before traits could
+// specify it) offsets are unsigned short and the parameter unsigned.
+template <class Traits>
+struct Has_bit_offset_t
+  {
+    template <class T>
+    static char test(typename T::Bit_offset_t *);
+
+    template <class T>
+    static long test(...);
+
+    static const bool Value = sizeof(test<Traits>(0)) == 1;
+  };
+
+template <class Traits, bool Specified = Has_bit_offset_t<Traits>::Value>
+struct Bit_offset
+  {
+    typedef unsigned short Type;
+
+    typedef unsigned Param;
+  };
+
+template <class Traits>
+struct Bit_offset<Traits, true>
+  {
+    typedef typename Traits::Bit_offset_t Type;
+
+    typedef typename Traits::Bit_offset_t Param;
+  };
+
+template<typename Value_t>
+struct Err_act_default
+  {
+    static void field_too_wide(unsigned /* field_width */) { }
+    static void value_too_big(Value_t /* v */, unsigned /* field_width */) { }
+  };
+
+} // namespace Bitfield_impl
+
+template <typename V_t = unsigned, typename S_t = V_t>
+class Bitfield_traits_default
+  {
+  public:
+
+    typedef V_t Value_t;
+
+    typedef S_t Storage_t;
+
+    class Storage_access_t
+      {
+      public:
+
+        typedef S_t Storage_t;
+
+        Storage_access_t(Storage_t *p) : ptr(p) { }
+
+        void operator += (std::size_t offset) { ptr += offset; }
+
+        Storage_t read() { return(*ptr); }
+
+        void write(Storage_t t) { *ptr = t; }
+
+      private:
+
+        Storage_t *ptr;
+
+      };
+
+    static const bool Storage_ls_bit_first = true;
+
+    static const bool Fmt_offset_from_start = true;
+
+    static const bool Fmt_align_at_zero_offset = true;
+
+  }; // class Bitfields_traits_default
+
+// Access to storage locations that are ordinary, contiguous host memory.
+// Use (through Bitfield_traits_plain_memory) to allow reads and built-in
+// modifications of bit fields that straddle storage locations to be done
+// with (at most) two 8-byte loads and stores rather than one per storage
+// location.  This is done when Value_t is no more than 64 bits, and either
+// Storage_t is one byte, or the order of bits in storage
+// (Storage_ls_bit_first) matches the host byte order.
+template <typename S_t>
+class Bitfield_plain_memory_access
+  {
+  public:
+
+    typedef S_t Storage_t;
+
+    Bitfield_plain_memory_access(Storage_t *p) : ptr(p) { }
+
+    void operator += (std::size_t offset) { ptr += offset; }
+
+    Storage_t read() { return(*ptr); }
+
+    void write(Storage_t t) { *ptr = t; }
+
+    Storage_t * pointer() const { return(ptr); }
+
+  private:
+
+    Storage_t *ptr;
+
+  };
+
+template <typename V_t = unsigned, typename S_t = V_t>
+class Bitfield_traits_plain_memory : public Bitfield_traits_default<V_t, S_t>
+  {
+  public:
+
+    typedef Bitfield_plain_memory_access<S_t> Storage_access_t;
+
+  }; // class Bitfield_traits_plain_memory
+
+namespace Bitfield_impl
+{
+
+// Operations of the built-in modifiers on 64-bit words, for the wide
+// path.  m is the mask of the bits in the bit field, x is the bits of the
+// value (already shifted and masked).  Bits of the value beyond the
+// field width are ignored.
+
+struct Wide_zero
+  {
+    static void x(unsigned long long &w, unsigned long long m,
+                  unsigned long long)
+      { w &= ~m; }
+  };
+
+struct Wide_write
+  {
+    static void x(unsigned long long &w, unsigned long long m,
+                  unsigned long long v)
+      { w = (w & ~m) | v; }
+  };
+
+struct Wide_and
+  {
+    static void x(unsigned long long &w, unsigned long long m,
+                  unsigned long long v)
+      { w &= v | ~m; }
+  };
+
+struct Wide_or
+  {
+    static void x(unsigned long long &w, unsigned long long,
+                  unsigned long long v)
+      { w |= v; }
+  };
+
+struct Wide_xor
+  {
+    static void x(unsigned long long &w, unsigned long long,
+                  unsigned long long v)
+      { w ^= v; }
+  };
+
+struct Wide_comp
+  {
+    static void x(unsigned long long &w, unsigned long long m,
+                  unsigned long long)
+      { w ^= m; }
+  };
+
+// Value is true if Modifier has a nested type Wide_op (one of the
+// Wide_ structs above).
+template <class Modifier>
+struct Has_wide_op
+  {
+    template <class M>
+    static char test(typename M::Wide_op *);
+
+    template <class M>
+    static long test(...);
+
+    static const bool Value = sizeof(test<Modifier>(0)) == 1;
+  };
+
+#if defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && \
+    defined(__ORDER_LITTLE_ENDIAN__)
+
+const bool Host_order_known =
+  (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__) ||
+  (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__);
+
+const bool Host_big_endian = __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__;
+
+#else
+
+const bool Host_order_known = false;
+
+const bool Host_big_endian = false;
+
+#endif
+
+inline unsigned long long bswap64(unsigned long long w)
+  {
+    #if defined(__GNUC__)
+
+    return(__builtin_bswap64(w));
+
+    #else
+
+    unsigned long long r = 0;
+
+    for (unsigned i = 0; i < 8; ++i, w >>= 8)
+      r = (r << 8) | (w & 0xff);
+
+    return(r);
+
+    #endif
+  }
+
+// Copies n bytes, 1 <= n <= 9, with a few fixed-size copies (possibly
+// overlapping) rather than a variable-size one.
+inline void copy_1_to_9(unsigned char *d, const unsigned char *s, unsigned n)
+  {
+    if (n > 8)
+      {
+        std::memcpy(d, s, 8);
+        d[8] = s[8];
+      }
+    else if (n >= 4)
+      {
+        std::memcpy(d, s, 4);
+        std::memcpy(d + n - 4, s + n - 4, 4);
+      }
+    else
+      {
+        d[0] = s[0];
+        d[n / 2] = s[n / 2];
+        d[n - 1] = s[n - 1];
+      }
+  }
+
+// The storage is treated as a stream of bits, in the n bytes starting at
+// the byte containing the first bit of the field.  It is loaded into two
+// 64-bit words, w[0] holding bits 0-63 of the stream and w[1] bits 64-71.
+// For a little-endian view (LS bit first), stream bit k is bit (k % 64)
+// of w[k / 64].  For a big-endian view, it is bit (63 - (k % 64)).
+template <bool Big_endian>
+struct Wide_view
+  {
+    static void load(
+      const unsigned char *p, unsigned n, unsigned long long *w)
+      {
+        unsigned char b[16] = { 0 };
+
+        copy_1_to_9(b, p, n);
+
+        std::memcpy(w, b, 16);
+
+        if (Big_endian != Host_big_endian)
+          {
+            w[0] = bswap64(w[0]);
+            w[1] = bswap64(w[1]);
+          }
+      }
+
+    static void store(
+      unsigned char *p, unsigned n, const unsigned long long *w)
+      {
+        unsigned long long t[2] = { w[0], w[1] };
+
+        if (Big_endian != Host_big_endian)
+          {
+            t[0] = bswap64(t[0]);
+            t[1] = bswap64(t[1]);
+          }
+
+        unsigned char b[16];
+
+        std::memcpy(b, t, 16);
+
+        copy_1_to_9(p, b, n);
+      }
+
+    // Field of width bits at offset shift (< 8) in the stream.
+
+    static unsigned long long get(
+      const unsigned long long *w, unsigned shift, unsigned width)
+      {
+        unsigned long long v;
+
+        if (Big_endian)
+          {
+            v = shift ? ((w[0] << shift) | (w[1] >> (64 - shift))) : w[0];
+
+            return(v >> (64 - width));
+          }
+
+        v = shift ? ((w[0] >> shift) | (w[1] << (64 - shift))) : w[0];
+
+        return(v & mask<unsigned long long>(width));
+      }
+
+    // Puts a value (or mask) of width bits at offset shift in the
+    // stream, in x[0] and x[1].
+    static void put(
+      unsigned long long v, unsigned shift, unsigned width,
+      unsigned long long *x)
+      {
+        v &= mask<unsigned long long>(width);
+
+        if (Big_endian)
+          {
+            v <<= 64 - width;
+
+            x[0] = v >> shift;
+            x[1] = shift ? (v << (64 - shift)) : 0;
+          }
+        else
+          {
+            x[0] = v << shift;
+            x[1] = shift ? (v >> (64 - shift)) : 0;
+          }
+      }
+  };
+
+// Wide path for reading and built-in modifications of bit fields that
+// straddle storage locations.  read() and modify() return false if the
+// wide path is not used.
+template <class Traits, class Access = typename Traits::Storage_access_t>
+struct Wide
+  {
+    static const bool Enabled = false;
+
+    typedef typename Bit_offset<Traits>::Param Ofs;
+
+    template <typename Value_t>
+    static bool read(Access, Ofs, unsigned, Value_t &) { return(false); }
+
+    template <class Op, typename Value_t>
+    static bool modify(Access, Ofs, unsigned, Value_t) { return(false); }
+  };
+
+template <class Traits, typename S_t>
+struct Wide<Traits, Bitfield_plain_memory_access<S_t> >
+  {
+    static const unsigned Storage_bits = Num_bits<S_t>::Value;
+
+    static const bool Enabled =
+      Host_order_known &&
+      (Num_bits<typename Traits::Value_t>::Value <= 64) &&
+      ((Storage_bits == CHAR_BIT) ||
+       (Traits::Storage_ls_bit_first != Host_big_endian)) &&
+      (CHAR_BIT == 8);
+
+    typedef Wide_view<!Traits::Storage_ls_bit_first> View;
+
+    typedef Bitfield_plain_memory_access<S_t> Access;
+
+    typedef typename Bit_offset<Traits>::Param Ofs;
+
+    static bool use(Ofs first_bit, unsigned field_width)
+      {
+        return(
+          Enabled &&
+          (((first_bit % Storage_bits) + field_width) > Storage_bits));
+      }
+
+    static unsigned char * byte(Access base, Ofs first_bit)
+      {
+        return(
+          reinterpret_cast<unsigned char *>(base.pointer()) + (first_bit / 8));
+      }
+
+    template <typename Value_t>
+    static bool read(
+      Access base, Ofs first_bit, unsigned field_width, Value_t &v)
+      {
+        if (!use(first_bit, field_width))
+          return(false);
+
+        unsigned shift = static_cast<unsigned>(first_bit % 8);
+
+        unsigned long long w[2];
+
+        View::load(byte(base, first_bit), (shift + field_width + 7) / 8, w);
+
+        v = static_cast<Value_t>(View::get(w, shift, field_width));
+
+        return(true);
+      }
+
+    template <class Op, typename Value_t>
+    static bool modify(
+      Access base, Ofs first_bit, unsigned field_width, Value_t v)
+      {
+        if (!use(first_bit, field_width))
+          return(false);
+
+        unsigned shift = static_cast<unsigned>(first_bit % 8);
+        unsigned n = (shift + field_width + 7) / 8;
+        unsigned char *p = byte(base, first_bit);
+
+        unsigned long long w[2], m[2], x[2];
+
+        View::load(p, n, w);
+
+        View::put(~(unsigned long long)(0), shift, field_width, m);
+        View::put(v, shift, field_width, x);
+
+        Op::x(w[0], m[0], x[0]);
+        Op::x(w[1], m[1], x[1]);
+
+        View::store(p, n, w);
+
+        return(true);
+      }
+  };
+
+// Calls Wide<Traits>::modify() if Modifier is a built-in one.
+template <class Traits, class Modifier,
+          bool Built_in = Has_wide_op<Modifier>::Value>
+struct Wide_modify
+  {
+    static bool x(
+      typename Traits::Storage_access_t,
+      typename Bit_offset<Traits>::Param, unsigned, Modifier &)
+      { return(false); }
+  };
+
+template <class Traits, class Modifier>
+struct Wide_modify<Traits, Modifier, true>
+  {
+    static bool x(
+      typename Traits::Storage_access_t base,
+      typename Bit_offset<Traits>::Param first_bit, unsigned field_width,
+      Modifier &m)
+      {
+        return(
+          Wide<Traits>::template modify<typename Modifier::Wide_op>(
+            base, first_bit, field_width, m.value()));
+      }
+  };
+
+} // namespace Bitfield_impl
+
+// Byte orders of storage locations, for Bitfield_byte_swap_access.
+enum Bitfield_byte_order
+  {
+    Bitfield_host_order,
+    Bitfield_little_endian,
+    Bitfield_big_endian
+  };
+
+namespace Bitfield_impl
+{
+
+inline bool host_big_endian()
+  {
+    if (Host_order_known)
+      return(Host_big_endian);
+
+    const unsigned short u = 0x1234;
+
+    return(*reinterpret_cast<const unsigned char *>(&u) == 0x12);
+  }
+
+// Reverses the order of the bytes of a value of type U .
+template <typename U, unsigned Size = sizeof(U)>
+struct Byte_swap
+  {
+    static U x(U v)
+      {
+        U r = 0;
+
+        for (unsigned i = 0; i < Size; ++i, v >>= CHAR_BIT)
+          r = static_cast<U>((r << CHAR_BIT) | (v & U(UCHAR_MAX)));
+
+        return(r);
+      }
+  };
+
+template <typename U>
+struct Byte_swap<U, 1>
+  {
+    static U x(U v) { return(v); }
+  };
+
+#if defined(__GNUC__)
+
+template <typename U>
+struct Byte_swap<U, 2>
+  {
+    static U x(U v) { return(static_cast<U>(__builtin_bswap16(v))); }
+  };
+
+template <typename U>
+struct Byte_swap<U, 4>
+  {
+    static U x(U v) { return(static_cast<U>(__builtin_bswap32(v))); }
+  };
+
+template <typename U>
+struct Byte_swap<U, 8>
+  {
+    static U x(U v) { return(static_cast<U>(__builtin_bswap64(v))); }
+  };
+
+#endif
+
+} // namespace Bitfield_impl
+
+// Wraps a storage access class, Access, whose storage locations are in
+// byte order Order.  Values read and written through this class are in
+// host byte order.  Access must have a Storage_t member type.
+template <class Access, Bitfield_byte_order Order>
+class Bitfield_byte_swap_access
+  {
+  public:
+
+    typedef typename Access::Storage_t Storage_t;
+
+    Bitfield_byte_swap_access() { }
+
+    Bitfield_byte_swap_access(const Access &a) : access(a) { }
+
+    // For example, a pointer to Storage_t for
+    // Bitfield_plain_memory_access .
+    template <typename Access_init>
+    Bitfield_byte_swap_access(Access_init i) : access(i) { }
+
+    void operator += (std::size_t offset) { access += offset; }
+
+    Storage_t read() { return(swap(access.read())); }
+
+    void write(Storage_t t) { access.write(swap(t)); }
+
+  private:
+
+    static Storage_t swap(Storage_t v)
+      {
+        if ((Order == Bitfield_host_order) ||
+            ((Order == Bitfield_big_endian) ==
+             Bitfield_impl::host_big_endian()))
+          return(v);
+
+        return(Bitfield_impl::Byte_swap<Storage_t>::x(v));
+      }
+
+    Access access;
+
+  }; // end class Bitfield_byte_swap_access
+
+#define BITF_DEF_F \
+template <unsigned BITF_WIDTH> struct F { char x[BITF_WIDTH]; };
+
+struct Bitfield_format { BITF_DEF_F };
+
+// Functions that are constant expressions with C++14 (which allows loops
+// in constexpr functions) or later.
+#if __cplusplus >= 201402L
+#define BITF_CONSTEXPR14 constexpr
+#else
+#define BITF_CONSTEXPR14
+#endif
+
+#if __cplusplus >= 201402L
+
+namespace Bitfield_impl
+{
+
+// The offset of a member (or base) of a format, as a constant expression
+// (so without reinterpret_cast or offsetof).  The address of the member
+// of the format in Fmt_image is compared with the address of each element
+// of the char array that shares its storage.  Compilers do not reliably
+// unroll the loop when the offset is not needed at compile time, so
+// if the compiler can tell, the address difference is used instead.
+
+#if defined(__has_builtin)
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define BITF_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+#elif defined(__GNUC__) && (__GNUC__ >= 9)
+#define BITF_IS_CONSTANT_EVALUATED() __builtin_is_constant_evaluated()
+#endif
+
+template <class Fmt>
+union Fmt_image
+  {
+    char c[sizeof(Fmt)];
+
+    Fmt f;
+
+    constexpr Fmt_image() : c() { }
+  };
+
+template <class Fmt>
+constexpr Fmt_image<Fmt> fmt_image;
+
+template <class Fmt>
+constexpr unsigned fmt_offset_of(const void *p)
+  {
+    #ifdef BITF_IS_CONSTANT_EVALUATED
+
+    if (!BITF_IS_CONSTANT_EVALUATED())
+      return(
+        unsigned(static_cast<const char *>(p) - fmt_image<Fmt>.c));
+
+    #endif
+
+    unsigned i = 0;
+
+    while ((i < sizeof(Fmt)) && (p != &fmt_image<Fmt>.c[i]))
+      ++i;
+
+    return(i);
+  }
+
+} // namespace Bitfield_impl
+
+#endif
+
+template <
+  class Traits = Bitfield_traits_default<unsigned>,
+  class Err_act = Bitfield_impl::Err_act_default<typename Traits::Value_t> >
+class Bitfield
+  {
+  public:
+
+    typedef typename Traits::Value_t Value_t;
+
+    typedef typename Traits::Storage_t Storage_t;
+
+    typedef typename Traits::Storage_access_t Storage_access_t;
+
+    typedef Err_act Err_act_t;
+
+    // The type of bit field offsets.  Traits::Bit_offset_t if Traits has
+    // it (for example std::size_t, for records or arrays of more than
+    // 65535 bits), unsigned short otherwise.  Storage_access_t::operator
+    // += must take an offset as large as Bit_offset_t / Storage_bits .
+    typedef typename Bitfield_impl::Bit_offset<Traits>::Type Bit_offset_t;
+
+    static const bool Storage_ls_bit_first = Traits::Storage_ls_bit_first;
+
+    static const bool Fmt_offset_from_start = Traits::Fmt_offset_from_start;
+
+    static const bool Fmt_align_at_zero_offset =
+      Traits::Fmt_align_at_zero_offset;
+
+    static const unsigned Storage_bits =
+      Bitfield_impl::Num_bits<Storage_t>::Value;
+
+    template<class Format>
+    struct Define
+      {
+        static const unsigned Storage_bits =
+          Bitfield_impl::Num_bits<Storage_t>::Value;
+
+        static const unsigned Dimension =
+          (sizeof(Format) + Storage_bits - 1) / Storage_bits;
+
+        typedef Storage_t T[Dimension];
+      };
+
+    static Value_t mask(unsigned field_width)
+      {
+        return(Bitfield_impl::mask<Value_t>(field_width));
+      }
+
+    class Modifier_base
+      {
+      public:
+
+        static Value_t value() { return(0); }
+
+      protected:
+
+        static Storage_t clear(
+          Storage_access_t s, unsigned shift, unsigned width)
+          {
+            if (width == Storage_bits)
+              return(0);
+
+            return(
+              s.read() &
+              ~(Bitfield_impl::mask<Storage_t>(width) << shift));
+          }
+      };
+
+    class Value_modifier_base : public Modifier_base
+      {
+      public:
+
+        Value_t value() const { return(val); }
+
+        Value_modifier_base(Value_t v) : val(v) { }
+
+      private:
+
+        const Value_t val;
+      };
+
+    class Bf
+      {
+      private:
+
+        const Storage_access_t base;
+
+        const Bit_offset_t first_bit;
+
+        const unsigned short field_width;
+
+      public:
+
+        Bf(
+          Storage_access_t base_, Bit_offset_t first_bit_,
+          unsigned short field_width_)
+          : base(base_), first_bit(first_bit_), field_width(field_width_)
+          { }
+
+        Bit_offset_t offset() { return(first_bit); }
+
+        unsigned short width() { return(field_width); }
+
+        bool is_width_invalid()
+          {
+            return((field_width == 0) ||
+                   (field_width > Bitfield_impl::Num_bits<Value_t>::Value));
+          }
+
+        Value_t read()
+          {
+            if (!check_width())
+              return(~(Value_t(0)));
+
+            Value_t v;
+
+            if (Bitfield_impl::Wide<Traits>::read(
+                  base, first_bit, field_width, v))
+              return(v);
+
+            Storage_access_t access(base);
+            access += (first_bit / Storage_bits);
+
+            const unsigned Ofs =
+              static_cast<unsigned>(first_bit % Storage_bits);
+
+            if (Traits::Storage_ls_bit_first)
+              return(
+                Bitfield_impl::Ls_read<Traits, 0>::x(
+                  access, Ofs, field_width));
+
+            return(
+              Bitfield_impl::Ms_read<Traits, 0>::x(
+                access, Ofs, field_width));
+          }
+
+        operator Value_t () { return(read()); }
+
+        Value_t read_sign_extend()
+          {
+            Value_t v = read();
+
+            if (field_width)
+              {
+                Value_t m = ~mask(field_width - 1);
+
+                if (m & v)
+                  v |= m;
+              }
+
+            return(v);
+          }
+
+        template <class Modifier>
+        bool modify_nvc(Modifier m)
+          {
+            if (!check_width())
+              return(false);
+
+            if (Bitfield_impl::Wide_modify<Traits, Modifier>::x(
+                  base, first_bit, field_width, m))
+              return(true);
+
+            Storage_access_t access(base);
+            access += (first_bit / Storage_bits);
+
+            const unsigned Ofs =
+              static_cast<unsigned>(first_bit % Storage_bits);
+
+            if (Traits::Storage_ls_bit_first)
+              Bitfield_impl::Ls_modify<Traits, Modifier, 0>::x(
+                access, Ofs, 0, field_width, m);
+            else
+              Bitfield_impl::Ms_modify<Traits, Modifier, 0>::x(
+                access, Ofs, field_width, m);
+
+            return(true);
+          }
+
+        template <class Modifier>
+        bool modify(Modifier m)
+          {
+            if (!check_fit(m.value()))
+              return(false);
+
+            return(modify_nvc(m));
+          }
+
+        bool write(Value_t val) { return(modify(Mod_write(val))); }
+
+        Value_t operator = (Value_t val) { write(val); return(val); }
+
+        bool write_nvc(Value_t val) { return(modify_nvc(Mod_write(val))); }
+
+        bool zero() { return(modify_nvc(Mod_zero())); }
+
+        bool b_and(Value_t val) { return(modify(Mod_and(val))); }
+
+        Bf & operator &= (Value_t val) { modify(Mod_and(val)); return(*this); }
+
+        bool b_and_nvc(Value_t val) { return(modify_nvc(Mod_and(val))); }
+
+        bool b_or(Value_t val) { return(modify(Mod_or(val))); }
+
+        Bf & operator |= (Value_t val) { modify(Mod_or(val)); return(*this); }
+
+        bool b_or_nvc(Value_t val) { return(modify_nvc(Mod_or(val))); }
+
+        bool b_xor(Value_t val) { return(modify(Mod_xor(val))); }
+
+        Bf & operator ^= (Value_t val) { modify(Mod_xor(val)); return(*this); }
+
+        bool b_xor_nvc(Value_t val) { return(modify_nvc(Mod_xor(val))); }
+
+        bool b_comp() { return(modify_nvc(Mod_comp())); }
+
+      private:
+
+        bool is_value_too_big(Value_t v)
+          {
+            if (field_width == Bitfield_impl::Num_bits<Value_t>::Value)
+              return(false);
+
+            return(v > mask(field_width));
+          }
+
+        bool check_width()
+          {
+            if (is_width_invalid())
+              {
+                Err_act::field_too_wide(field_width);
+
+                return(false);
+              }
+
+            return(true);
+          }
+
+        bool check_fit(Value_t v)
+          {
+            if (is_value_too_big(v))
+              {
+                Err_act::value_too_big(v, field_width);
+
+                return(false);
+              }
+
+            return(true);
+          }
+
+      }; // end class Bf
+
+    // Counterpart of Bf for a bit field whose offset and width are
+    // known at compile time.  The width check, the storage location
+    // index, the shifts and the masks are all compile-time constants, so
+    // the generated code does not depend on the optimizer folding them.
+    // An invalid width is a compile error rather than a call to
+    // Err_act::field_too_wide() .
+    //
+    // Modifiers passed to modify() / modify_nvc() must have the member:
+    //
+    //   template <class Piece>
+    //   void operator () (Storage_access_t s, Piece)
+    //
+    // Piece is an instance of Bitfield_impl::Static_piece, whose static
+    // members give the shifts, width and mask for the storage location s.
+    //
+    template <unsigned First_bit, unsigned Field_width>
+    class Static_bf
+      {
+      private:
+
+        const Storage_access_t base;
+
+        static const unsigned Value_bits =
+          Bitfield_impl::Num_bits<Value_t>::Value;
+
+        static const bool Width_invalid =
+          (Field_width == 0) || (Field_width > Value_bits);
+
+        // If the line following this comment causes a compile error, the
+        // bit field width is zero or more than the number of bits in
+        // Value_t.
+        static int not_used[1 / (Width_invalid ? 0 : 1)];
+
+        static const unsigned Storage_offset = First_bit / Storage_bits;
+
+        static const unsigned Storage_first_bit = First_bit % Storage_bits;
+
+      public:
+
+        Static_bf(Storage_access_t base_) : base(base_) { }
+
+        static unsigned offset() { return(First_bit); }
+
+        static unsigned short width() { return(Field_width); }
+
+        static bool is_width_invalid() { return(false); }
+
+        Value_t read()
+          {
+            Value_t v;
+
+            if (Bitfield_impl::Wide<Traits>::read(
+                  base, First_bit, Field_width, v))
+              return(v);
+
+            Storage_access_t access(base);
+            access += Storage_offset;
+
+            if (Traits::Storage_ls_bit_first)
+              return(
+                Bitfield_impl::Ls_static_read<
+                  Traits, Storage_first_bit, Field_width>::x(access));
+
+            return(
+              Bitfield_impl::Ms_static_read<
+                Traits, Storage_first_bit, Field_width>::x(access));
+          }
+
+        operator Value_t () { return(read()); }
+
+        Value_t read_sign_extend()
+          {
+            Value_t v = read();
+
+            const Value_t m =
+              ~Bitfield_impl::Static_mask<Value_t, Field_width - 1>::Value;
+
+            if (m & v)
+              v |= m;
+
+            return(v);
+          }
+
+        template <class Modifier>
+        bool modify_nvc(Modifier m)
+          {
+            if (Bitfield_impl::Wide_modify<Traits, Modifier>::x(
+                  base, First_bit, Field_width, m))
+              return(true);
+
+            Storage_access_t access(base);
+            access += Storage_offset;
+
+            if (Traits::Storage_ls_bit_first)
+              Bitfield_impl::Ls_static_modify<
+                Traits, Modifier, Storage_first_bit, Field_width>::x(
+                  access, m);
+            else
+              Bitfield_impl::Ms_static_modify<
+                Traits, Modifier, Storage_first_bit, Field_width>::x(
+                  access, m);
+
+            return(true);
+          }
+
+        template <class Modifier>
+        bool modify(Modifier m)
+          {
+            if (!check_fit(m.value()))
+              return(false);
+
+            return(modify_nvc(m));
+          }
+
+        bool write(Value_t val) { return(modify(Smod_write(val))); }
+
+        Value_t operator = (Value_t val) { write(val); return(val); }
+
+        bool write_nvc(Value_t val) { return(modify_nvc(Smod_write(val))); }
+
+        bool zero() { return(modify_nvc(Smod_zero())); }
+
+        bool b_and(Value_t val) { return(modify(Smod_and(val))); }
+
+        Static_bf & operator &= (Value_t val)
+          { modify(Smod_and(val)); return(*this); }
+
+        bool b_and_nvc(Value_t val) { return(modify_nvc(Smod_and(val))); }
+
+        bool b_or(Value_t val) { return(modify(Smod_or(val))); }
+
+        Static_bf & operator |= (Value_t val)
+          { modify(Smod_or(val)); return(*this); }
+
+        bool b_or_nvc(Value_t val) { return(modify_nvc(Smod_or(val))); }
+
+        bool b_xor(Value_t val) { return(modify(Smod_xor(val))); }
+
+        Static_bf & operator ^= (Value_t val)
+          { modify(Smod_xor(val)); return(*this); }
+
+        bool b_xor_nvc(Value_t val) { return(modify_nvc(Smod_xor(val))); }
+
+        bool b_comp() { return(modify_nvc(Smod_comp())); }
+
+      private:
+
+        static bool is_value_too_big(Value_t v)
+          {
+            if (Field_width == Value_bits)
+              return(false);
+
+            return(
+              v > Bitfield_impl::Static_mask<Value_t, Field_width>::Value);
+          }
+
+        static bool check_fit(Value_t v)
+          {
+            if (is_value_too_big(v))
+              {
+                Err_act::value_too_big(v, Field_width);
+
+                return(false);
+              }
+
+            return(true);
+          }
+
+      }; // end class Static_bf
+
+    static Bf fn(
+      Storage_access_t base,
+      typename Bitfield_impl::Bit_offset<Traits>::Param first_bit,
+      unsigned field_width)
+      {
+        return(
+          Bf(base, static_cast<Bit_offset_t>(first_bit),
+             static_cast<unsigned short>(field_width)));
+      }
+
+    // The offset and width of a bit field, without a base storage
+    // location.  Typically generated with the BITF_FIELD macros.
+    class Field
+      {
+      public:
+
+        BITF_CONSTEXPR14 Field(
+          Bit_offset_t first_bit_, unsigned short field_width_)
+          : first_bit(first_bit_), field_width(field_width_)
+          { }
+
+        Bit_offset_t first_bit;
+
+        unsigned short field_width;
+      };
+
+    // A bit field's offset and width, with the storage location index,
+    // shifts and masks that accessing it needs computed once, when the
+    // offset and width are only known at run time.  For a table of
+    // descriptors accessed repeatedly.  Errors are handled as by Bf .
+    class Descriptor
+      {
+      public:
+
+        Descriptor()
+          : first_mask(0), last_mask(0), word(0), width(0), offset(0),
+            shift(0), pieces(0), last_shift(0)
+          { }
+
+        Descriptor(Bit_offset_t first_bit, unsigned short field_width)
+          { init(first_bit, field_width); }
+
+        explicit Descriptor(const Field &f)
+          { init(f.first_bit, f.field_width); }
+
+        Bit_offset_t first_bit() const
+          {
+            return(
+              static_cast<Bit_offset_t>((word * Storage_bits) + offset));
+          }
+
+        unsigned short field_width() const { return(width); }
+
+        bool is_width_invalid() const { return(pieces == 0); }
+
+        Bf bf(Storage_access_t base) const
+          { return(Bf(base, first_bit(), width)); }
+
+        Value_t read(Storage_access_t base) const
+          {
+            if (!check_width())
+              return(~(Value_t(0)));
+
+            base += word;
+
+            Value_t v =
+              static_cast<Value_t>((base.read() & first_mask) >> shift);
+
+            if (pieces == 1)
+              return(v);
+
+            if (Storage_ls_bit_first)
+              {
+                unsigned bits = Storage_bits - shift;
+
+                for (unsigned i = 2; (Max_pieces > 2) && (i < pieces); ++i)
+                  {
+                    base += 1;
+                    v |= static_cast<Value_t>(base.read()) << bits;
+                    bits += Storage_bits;
+                  }
+
+                base += 1;
+                v |= static_cast<Value_t>(base.read() & last_mask) << bits;
+              }
+            else
+              {
+                for (unsigned i = 2; (Max_pieces > 2) && (i < pieces); ++i)
+                  {
+                    base += 1;
+                    v = (v << Mid_shift) | static_cast<Value_t>(base.read());
+                  }
+
+                base += 1;
+                v = (v << (Storage_bits - last_shift)) |
+                    static_cast<Value_t>(
+                      (base.read() & last_mask) >> last_shift);
+              }
+
+            return(v);
+          }
+
+        Value_t read_sign_extend(Storage_access_t base) const
+          {
+            Value_t v = read(base);
+
+            if (pieces != 0)
+              {
+                const Value_t m = ~mask(width - 1);
+
+                if (v & m)
+                  v |= m;
+              }
+
+            return(v);
+          }
+
+        bool write(Storage_access_t base, Value_t v) const
+          {
+            if (!check_width())
+              return(false);
+
+            if (!check_fit(v))
+              return(false);
+
+            each<Put>(base, v);
+
+            return(true);
+          }
+
+        bool write_nvc(Storage_access_t base, Value_t v) const
+          {
+            if (!check_width())
+              return(false);
+
+            each<Put>(base, v);
+
+            return(true);
+          }
+
+        bool zero(Storage_access_t base) const
+          { return(write_nvc(base, 0)); }
+
+        bool b_or(Storage_access_t base, Value_t v) const
+          {
+            if (!check_width())
+              return(false);
+
+            if (!check_fit(v))
+              return(false);
+
+            each<Or>(base, v);
+
+            return(true);
+          }
+
+        bool b_and(Storage_access_t base, Value_t v) const
+          {
+            if (!check_width())
+              return(false);
+
+            if (!check_fit(v))
+              return(false);
+
+            each<And>(base, v);
+
+            return(true);
+          }
+
+        bool b_xor(Storage_access_t base, Value_t v) const
+          {
+            if (!check_width())
+              return(false);
 
-        Value_t operator = (Value_t val) { write(val); return(val); }
+            if (!check_fit(v))
+              return(false);
 
-        bool write_nvc(Value_t val) { return(modify_nvc(Mod_write(val))); }
+            each<Xor>(base, v);
 
-        bool zero() { return(modify_nvc(Mod_zero())); }
+            return(true);
+          }
 
-        bool b_and(Value_t val) { return(modify(Mod_and(val))); }
+        bool b_comp(Storage_access_t base) const
+          {
+            if (!check_width())
+              return(false);
 
-        Bf & operator &= (Value_t val) { modify(Mod_and(val)); return(*this); }
+            each<Xor>(base, ~Value_t(0) >> (Value_bits - width));
 
-        bool b_and_nvc(Value_t val) { return(modify_nvc(Mod_and(val))); }
+            return(true);
+          }
 
-        bool b_or(Value_t val) { return(modify(Mod_or(val))); }
+      private:
 
-        Bf & operator |= (Value_t val) { modify(Mod_or(val)); return(*this); }
+        static const unsigned Value_bits =
+          Bitfield_impl::Num_bits<Value_t>::Value;
 
-        bool b_or_nvc(Value_t val) { return(modify_nvc(Mod_or(val))); }
+        // The most storage locations a bit field can be in.  The loops
+        // over the storage locations in the middle of a bit field compile
+        // to nothing if it is 2 (Storage_t is as wide as Value_t).
+        static const unsigned Max_pieces =
+          (Value_bits + (2 * Storage_bits) - 2) / Storage_bits;
 
-        bool b_xor(Value_t val) { return(modify(Mod_xor(val))); }
+        // Shift past a whole storage location in the middle of a bit
+        // field.
+        static const unsigned Mid_shift =
+          Storage_bits < Value_bits ? Storage_bits : 0;
 
-        Bf & operator ^= (Value_t val) { modify(Mod_xor(val)); return(*this); }
+        // Bits of the bit field in the first and last storage locations.
+        Storage_t first_mask, last_mask;
 
-        bool b_xor_nvc(Value_t val) { return(modify_nvc(Mod_xor(val))); }
+        typename Bitfield_impl::Bit_offset<Traits>::Param word;
 
-        bool b_comp() { return(modify_nvc(Mod_comp())); }
+        unsigned short width;
 
-      private:
+        // offset is first_bit % Storage_bits .  shift is the right shift
+        // of the first storage location's bits (0 if MS bit first and
+        // pieces > 1).  last_shift is the right shift of the last storage
+        // location's bits (0 if LS bit first).  pieces is the number of
+        // storage locations the bit field is in (0 if the width is
+        // invalid).
+        unsigned char offset, shift, pieces, last_shift;
 
-        bool is_value_too_big(Value_t v)
+        bool check_width() const
           {
-            if (field_width == Bitfield_impl::Num_bits<Value_t>::Value)
-              return(false);
+            if (pieces == 0)
+              {
+                Err_act::field_too_wide(width);
 
-            return(v > mask(field_width));
+                return(false);
+              }
+
+            return(true);
           }
 
-        bool check_width()
+        bool check_fit(Value_t v) const
           {
-            if (is_width_invalid())
+            if ((v >> (width - 1)) >> 1)
               {
-                Err_act::field_too_wide(field_width);
+                Err_act::value_too_big(v, width);
 
                 return(false);
               }
@@ -502,37 +2135,221 @@ class Bitfield
             return(true);
           }
 
-        bool check_fit(Value_t v)
+        void init(Bit_offset_t first_bit, unsigned field_width)
           {
-            if (is_value_too_big(v))
+            word = first_bit / Storage_bits;
+            offset = static_cast<unsigned char>(first_bit % Storage_bits);
+            width = static_cast<unsigned short>(field_width);
+            last_mask = 0;
+            last_shift = 0;
+
+            if ((field_width == 0) || (field_width > Value_bits))
               {
-                Err_act::value_too_big(v, field_width);
+                first_mask = 0;
+                shift = 0;
+                pieces = 0;
 
-                return(false);
+                return;
               }
 
-            return(true);
+            pieces = static_cast<unsigned char>(
+              (offset + field_width + Storage_bits - 1) / Storage_bits);
+
+            const unsigned last_width =
+              offset + field_width - ((pieces - 1) * Storage_bits);
+
+            if (pieces == 1)
+              {
+                shift = static_cast<unsigned char>(
+                  Storage_ls_bit_first ?
+                    offset : Storage_bits - offset - field_width);
+
+                first_mask = static_cast<Storage_t>(
+                  Bitfield_impl::mask<Storage_t>(field_width) << shift);
+              }
+            else if (Storage_ls_bit_first)
+              {
+                shift = offset;
+                first_mask = static_cast<Storage_t>(
+                  Bitfield_impl::mask<Storage_t>(Storage_bits - offset) <<
+                  offset);
+                last_mask = Bitfield_impl::mask<Storage_t>(last_width);
+              }
+            else
+              {
+                shift = 0;
+                first_mask =
+                  Bitfield_impl::mask<Storage_t>(Storage_bits - offset);
+                last_shift =
+                  static_cast<unsigned char>(Storage_bits - last_width);
+                last_mask = static_cast<Storage_t>(
+                  Bitfield_impl::mask<Storage_t>(last_width) << last_shift);
+              }
           }
 
-      }; // end class Bf
+        // Changes each storage location with Op::x(s, m, b) , where m is
+        // the bits of the bit field in it and b is the corresponding bits
+        // of v (in place).
+        template <class Op>
+        void each(Storage_access_t base, Value_t v) const
+          {
+            base += word;
 
-    static Bf fn(
-      Storage_access_t base, unsigned first_bit, unsigned field_width)
-      { return(Bf(base, first_bit, field_width)); }
+            if (pieces == 1)
+              {
+                Op::x(
+                  base, first_mask,
+                  static_cast<Storage_t>(
+                    static_cast<Storage_t>(v) << shift) & first_mask);
+                return;
+              }
+
+            if (Storage_ls_bit_first)
+              {
+                Op::x(
+                  base, first_mask,
+                  static_cast<Storage_t>(
+                    static_cast<Storage_t>(v) << shift));
+
+                v >>= Storage_bits - shift;
+
+                for (unsigned i = 2; (Max_pieces > 2) && (i < pieces); ++i)
+                  {
+                    base += 1;
+                    Op::x(
+                      base, static_cast<Storage_t>(~Storage_t(0)),
+                      static_cast<Storage_t>(v));
+                    v >>= Mid_shift;
+                  }
+
+                base += 1;
+                Op::x(
+                  base, last_mask, static_cast<Storage_t>(v) & last_mask);
+              }
+            else
+              {
+                unsigned rem = width - (Storage_bits - offset);
+
+                Op::x(
+                  base, first_mask,
+                  static_cast<Storage_t>(v >> rem) & first_mask);
+
+                for (unsigned i = 2; (Max_pieces > 2) && (i < pieces); ++i)
+                  {
+                    rem -= Storage_bits;
+                    base += 1;
+                    Op::x(
+                      base, static_cast<Storage_t>(~Storage_t(0)),
+                      static_cast<Storage_t>(v >> rem));
+                  }
+
+                base += 1;
+                Op::x(
+                  base, last_mask,
+                  static_cast<Storage_t>(
+                    static_cast<Storage_t>(v) << last_shift) & last_mask);
+              }
+          }
+
+        // Sets the bits m of a storage location to b .
+        class Put_mod
+          {
+          public:
+
+            Put_mod(Storage_t m_, Storage_t b_) : m(m_), b(b_) { }
+
+            template <class Piece>
+            void operator () (Storage_access_t s, Piece)
+              { s.write(static_cast<Storage_t>((s.read() & ~m) | b)); }
+
+          private:
+
+            Storage_t m, b;
+          };
+
+        struct Put
+          {
+            static void x(Storage_access_t s, Storage_t m, Storage_t b)
+              {
+                if (m == static_cast<Storage_t>(~Storage_t(0)))
+                  s.write(b);
+                else
+                  {
+                    Put_mod pm(m, b);
+
+                    Ops::modify(s, pm, 0);
+                  }
+              }
+          };
+
+        struct Or
+          {
+            static void x(Storage_access_t s, Storage_t, Storage_t b)
+              { Ops::b_or(s, b); }
+          };
+
+        struct And
+          {
+            static void x(Storage_access_t s, Storage_t m, Storage_t b)
+              { Ops::b_and(s, static_cast<Storage_t>(b | ~m)); }
+          };
+
+        struct Xor
+          {
+            static void x(Storage_access_t s, Storage_t, Storage_t b)
+              { Ops::b_xor(s, b); }
+          };
+
+      }; // end class Descriptor
+
+    // Reads num_fields bit fields into values, reading each of the
+    // storage locations 0 through Num_storage - 1 at most once.  (Storage
+    // locations past Num_storage - 1 are read once per bit field that
+    // uses them.)  Invalid widths are handled as in Bf::read() .
+    template <unsigned Num_storage>
+    static void read_fields(
+      Storage_access_t base, const Field *fields, unsigned num_fields,
+      Value_t *values)
+      {
+        typedef Bitfield<Read_once_traits<Num_storage>, Err_act> Bro;
+
+        Bitfield_impl::Read_once_buf<Storage_access_t, Storage_t, Num_storage>
+          rob(base);
+
+        typename Bro::Storage_access_t sa(rob);
+
+        for (unsigned i = 0; i < num_fields; ++i)
+          values[i] =
+            Bro::fn(sa, fields[i].first_bit, fields[i].field_width).read();
+      }
+
+    // With C++14 or later, field_width() and field_offset() are constant
+    // expressions (if their parameters are), so can be template
+    // arguments, for example of Static_bf .
 
     template<class Format, typename Mbr_type>
-    static unsigned field_width(Mbr_type Format::*)
+    static BITF_CONSTEXPR14 unsigned field_width(Mbr_type Format::*)
       { return(sizeof(Mbr_type)); }
 
     template<class Format, typename Mbr_type>
-    static unsigned field_offset(
+    static BITF_CONSTEXPR14 unsigned field_offset(
       Mbr_type Format::*field, unsigned base_offset = 0)
       {
+        #if __cplusplus >= 201402L
+
+        unsigned offset =
+          Bitfield_impl::fmt_offset_of<Format>(
+            &(Bitfield_impl::fmt_image<Format>.f.*field));
+
+        #else
+
         unsigned offset =
           reinterpret_cast<char *>(
             &(reinterpret_cast<Format *>(0x100)->*field)) -
            reinterpret_cast<char *>(0x100);
 
+        #endif
+
         if (!Bitfield::Fmt_offset_from_start)
           offset = sizeof(Format) - sizeof(Mbr_type) - offset;
 
@@ -555,22 +2372,204 @@ class Bitfield
         return(Bf(base, field_offset(field, offset), field_width(field)));
       }
 
+    #if __cplusplus >= 201703L
+
+    // The pointer to member is a template argument, so the offset and
+    // width are compile-time constants, as with BITF_S .  For example:
+    // Bitfield::f<&Fmt::data>(base)
+    template <auto Field, unsigned Offset = 0>
+    static Static_bf<field_offset(Field, Offset), field_width(Field)> f(
+      Storage_access_t base)
+      {
+        return(
+          Static_bf<field_offset(Field, Offset), field_width(Field)>(base));
+      }
+
+    #endif
+
+  private:
+
+    template <unsigned Num_storage>
+    struct Write_combine_traits : public Traits
+      {
+        typedef Bitfield_impl::Write_combine_t<
+            typename Bitfield::Storage_access_t, typename Bitfield::Storage_t,
+            Num_storage>
+          Storage_access_t;
+      };
+
+    template <unsigned Num_storage>
+    struct Read_once_traits : public Traits
+      {
+        typedef Bitfield_impl::Read_once_t<
+            typename Bitfield::Storage_access_t, typename Bitfield::Storage_t,
+            Num_storage>
+          Storage_access_t;
+      };
+
+  public:
+
+    // Collects writes, zeroing, anding and oring of bit fields in storage
+    // locations 0 through Num_storage - 1 (typically Num_storage is
+    // Define<Format>::Dimension).  commit() then does one read and one
+    // write for each storage location changed, or only a write if all
+    // the bits in it were written or zeroed.  Pending changes are
+    // discarded if commit() is not called.  Changes to storage locations
+    // past Num_storage - 1 are done immediately.  Validation and return
+    // values are as for the Bf members with the same names.
+    template <unsigned Num_storage>
+    class Write_combine
+      {
+      private:
+
+        typedef Bitfield<Write_combine_traits<Num_storage>, Err_act> Bwc;
+
+      public:
+
+        Write_combine(Storage_access_t base) : wcb(base) { }
+
+        bool write(const Field &f, Value_t val)
+          { return(bf(f).modify(Wcmod_write(val))); }
+
+        bool write_nvc(const Field &f, Value_t val)
+          { return(bf(f).modify_nvc(Wcmod_write(val))); }
+
+        bool zero(const Field &f)
+          { return(bf(f).modify_nvc(Wcmod_write(0))); }
+
+        bool b_and(const Field &f, Value_t val)
+          { return(bf(f).modify(Wcmod_and(val))); }
+
+        bool b_and_nvc(const Field &f, Value_t val)
+          { return(bf(f).modify_nvc(Wcmod_and(val))); }
+
+        bool b_or(const Field &f, Value_t val)
+          { return(bf(f).modify(Wcmod_or(val))); }
+
+        bool b_or_nvc(const Field &f, Value_t val)
+          { return(bf(f).modify_nvc(Wcmod_or(val))); }
+
+        void commit() { wcb.commit(); }
+
+        void discard() { wcb.discard(); }
+
+      private:
+
+        typedef typename Bwc::Storage_access_t Wc_t;
+
+        Bitfield_impl::Write_combine_buf<
+            Storage_access_t, Storage_t, Num_storage>
+          wcb;
+
+        typename Bwc::Bf bf(const Field &f)
+          { return(Bwc::fn(Wc_t(wcb), f.first_bit, f.field_width)); }
+
+        static Storage_t piece(
+          Value_t v, unsigned storage_shift, unsigned value_shift)
+          {
+            return(
+              static_cast<Storage_t>(
+                static_cast<Storage_t>(v >> value_shift) << storage_shift));
+          }
+
+        static Storage_t piece_mask(
+          unsigned storage_shift, unsigned storage_width)
+          {
+            return(
+              static_cast<Storage_t>(
+                Bitfield_impl::mask<Storage_t>(storage_width) <<
+                storage_shift));
+          }
+
+        class Wcmod_write : public Value_modifier_base
+          {
+          public:
+
+            Wcmod_write(Value_t v) : Value_modifier_base(v) { }
+
+            void operator () (
+              Wc_t s, unsigned storage_shift, unsigned value_shift,
+              unsigned storage_width)
+              {
+                s.update(
+                  piece_mask(storage_shift, storage_width),
+                  piece(this->value(), storage_shift, value_shift));
+              }
+          };
+
+        class Wcmod_and : public Value_modifier_base
+          {
+          public:
+
+            Wcmod_and(Value_t v) : Value_modifier_base(v) { }
+
+            void operator () (
+              Wc_t s, unsigned storage_shift, unsigned value_shift,
+              unsigned storage_width)
+              {
+                // Bits anded with 0 become 0, the rest are unchanged.
+                s.update(
+                  static_cast<Storage_t>(
+                    piece_mask(storage_shift, storage_width) &
+                    ~piece(this->value(), storage_shift, value_shift)),
+                  0);
+              }
+          };
+
+        class Wcmod_or : public Value_modifier_base
+          {
+          public:
+
+            Wcmod_or(Value_t v) : Value_modifier_base(v) { }
+
+            void operator () (
+              Wc_t s, unsigned storage_shift, unsigned value_shift,
+              unsigned storage_width)
+              {
+                // Bits ored with 1 become 1, the rest are unchanged.
+                Storage_t x =
+                  static_cast<Storage_t>(
+                    piece_mask(storage_shift, storage_width) &
+                    piece(this->value(), storage_shift, value_shift));
+
+                s.update(x, x);
+              }
+          };
+
+      }; // end class Write_combine
+
   private:
 
-    class Mod_zero : public Modifier_base
+    typedef Bitfield_impl::Storage_ops<Storage_access_t> Ops;
+
+    class Mod_zero
+      : public Modifier_base, public Bitfield_impl::Single_op_modifier
       {
       public:
 
+        typedef Bitfield_impl::Wide_zero Wide_op;
+
         void operator () (
           Storage_access_t s, unsigned storage_shift, unsigned,
           unsigned storage_width)
-          { s.write(this->clear(s, storage_shift, storage_width)); }
+          {
+            if (storage_width == Storage_bits)
+              s.write(0);
+            else
+              Ops::b_and(
+                s,
+                static_cast<Storage_t>(
+                  ~(Bitfield_impl::mask<Storage_t>(storage_width)
+                      << storage_shift)));
+          }
       };
 
     class Mod_write : public Value_modifier_base
       {
       public:
 
+        typedef Bitfield_impl::Wide_write Wide_op;
+
         Mod_write(Value_t v) : Value_modifier_base(v) { }
 
         void operator () (
@@ -578,7 +2577,10 @@ class Bitfield
           unsigned storage_width)
           {
             Storage_t x =
-              (Value_modifier_base::value() >> value_shift) << storage_shift;
+              static_cast<Storage_t>(
+                static_cast<Storage_t>(
+                  Value_modifier_base::value() >> value_shift)
+                << storage_shift);
 
             s.write(
               static_cast<Storage_t>(
@@ -586,10 +2588,13 @@ class Bitfield
           }
       };
 
-    class Mod_and : public Value_modifier_base
+    class Mod_and
+      : public Value_modifier_base, public Bitfield_impl::Single_op_modifier
       {
       public:
 
+        typedef Bitfield_impl::Wide_and Wide_op;
+
         Mod_and(Value_t v) : Value_modifier_base(v) { }
 
         void operator () (
@@ -597,20 +2602,25 @@ class Bitfield
           unsigned storage_width)
           {
             Storage_t x =
-              (Value_modifier_base::value() >> value_shift) << storage_shift;
+              static_cast<Storage_t>(
+                static_cast<Storage_t>(
+                  Value_modifier_base::value() >> value_shift)
+                << storage_shift);
 
             x |=
               ~(Bitfield_impl::mask<Storage_t>(storage_width) << storage_shift);
 
-
-            s.write(static_cast<Storage_t>(x & s.read()));
+            Ops::b_and(s, x);
           }
       };
 
-    class Mod_or : public Value_modifier_base
+    class Mod_or
+      : public Value_modifier_base, public Bitfield_impl::Single_op_modifier
       {
       public:
 
+        typedef Bitfield_impl::Wide_or Wide_op;
+
         Mod_or(Value_t v) : Value_modifier_base(v) { }
 
         void operator () (
@@ -618,16 +2628,22 @@ class Bitfield
           unsigned)
           {
             Storage_t x =
-              (Value_modifier_base::value() >> value_shift) << storage_shift;
+              static_cast<Storage_t>(
+                static_cast<Storage_t>(
+                  Value_modifier_base::value() >> value_shift)
+                << storage_shift);
 
-            s.write(static_cast<Storage_t>(x | s.read()));
+            Ops::b_or(s, x);
           }
       };
 
-    class Mod_xor : public Value_modifier_base
+    class Mod_xor
+      : public Value_modifier_base, public Bitfield_impl::Single_op_modifier
       {
       public:
 
+        typedef Bitfield_impl::Wide_xor Wide_op;
+
         Mod_xor(Value_t v) : Value_modifier_base(v) { }
 
         void operator () (
@@ -635,28 +2651,155 @@ class Bitfield
           unsigned)
           {
             Storage_t x =
-              (Value_modifier_base::value() >> value_shift) << storage_shift;
+              static_cast<Storage_t>(
+                static_cast<Storage_t>(
+                  Value_modifier_base::value() >> value_shift)
+                << storage_shift);
 
-            s.write(static_cast<Storage_t>(x ^ s.read()));
+            Ops::b_xor(s, x);
           }
       };
 
-    class Mod_comp : public Modifier_base
+    class Mod_comp
+      : public Modifier_base, public Bitfield_impl::Single_op_modifier
       {
       public:
 
+        typedef Bitfield_impl::Wide_comp Wide_op;
+
         void operator () (
           Storage_access_t s, unsigned storage_shift, unsigned,
           unsigned storage_width)
           {
-            s.write(
+            Ops::b_xor(
+              s,
+              static_cast<Storage_t>(
+                Bitfield_impl::mask<Storage_t>(storage_width)
+                  << storage_shift));
+          }
+      };
+
+    // Modifiers for Static_bf .
+
+    class Smod_zero
+      : public Modifier_base, public Bitfield_impl::Single_op_modifier
+      {
+      public:
+
+        typedef Bitfield_impl::Wide_zero Wide_op;
+
+        template <class Piece>
+        void operator () (Storage_access_t s, Piece)
+          {
+            if (Piece::Whole)
+              s.write(0);
+            else
+              Ops::b_and(s, static_cast<Storage_t>(~Piece::Mask));
+          }
+      };
+
+    class Smod_write : public Value_modifier_base
+      {
+      public:
+
+        typedef Bitfield_impl::Wide_write Wide_op;
+
+        Smod_write(Value_t v) : Value_modifier_base(v) { }
+
+        template <class Piece>
+        void operator () (Storage_access_t s, Piece)
+          {
+            Storage_t x =
+              static_cast<Storage_t>(
+                static_cast<Storage_t>(
+                  Value_modifier_base::value() >> Piece::Value_shift)
+                << Piece::Storage_shift);
+
+            if (Piece::Whole)
+              s.write(x);
+            else
+              s.write(static_cast<Storage_t>(x | (s.read() & ~Piece::Mask)));
+          }
+      };
+
+    class Smod_and
+      : public Value_modifier_base, public Bitfield_impl::Single_op_modifier
+      {
+      public:
+
+        typedef Bitfield_impl::Wide_and Wide_op;
+
+        Smod_and(Value_t v) : Value_modifier_base(v) { }
+
+        template <class Piece>
+        void operator () (Storage_access_t s, Piece)
+          {
+            Storage_t x =
+              static_cast<Storage_t>(
+                static_cast<Storage_t>(
+                  Value_modifier_base::value() >> Piece::Value_shift)
+                << Piece::Storage_shift);
+
+            Ops::b_and(s, static_cast<Storage_t>(x | ~Piece::Mask));
+          }
+      };
+
+    class Smod_or
+      : public Value_modifier_base, public Bitfield_impl::Single_op_modifier
+      {
+      public:
+
+        typedef Bitfield_impl::Wide_or Wide_op;
+
+        Smod_or(Value_t v) : Value_modifier_base(v) { }
+
+        template <class Piece>
+        void operator () (Storage_access_t s, Piece)
+          {
+            Storage_t x =
+              static_cast<Storage_t>(
+                static_cast<Storage_t>(
+                  Value_modifier_base::value() >> Piece::Value_shift)
+                << Piece::Storage_shift);
+
+            Ops::b_or(s, x);
+          }
+      };
+
+    class Smod_xor
+      : public Value_modifier_base, public Bitfield_impl::Single_op_modifier
+      {
+      public:
+
+        typedef Bitfield_impl::Wide_xor Wide_op;
+
+        Smod_xor(Value_t v) : Value_modifier_base(v) { }
+
+        template <class Piece>
+        void operator () (Storage_access_t s, Piece)
+          {
+            Storage_t x =
               static_cast<Storage_t>(
-                s.read() ^
-                (Bitfield_impl::mask<Storage_t>(storage_width)
-                   << storage_shift)));
+                static_cast<Storage_t>(
+                  Value_modifier_base::value() >> Piece::Value_shift)
+                << Piece::Storage_shift);
+
+            Ops::b_xor(s, x);
           }
       };
 
+    class Smod_comp
+      : public Modifier_base, public Bitfield_impl::Single_op_modifier
+      {
+      public:
+
+        typedef Bitfield_impl::Wide_comp Wide_op;
+
+        template <class Piece>
+        void operator () (Storage_access_t s, Piece)
+          { Ops::b_xor(s, Piece::Mask); }
+      };
+
     static const bool Uh_oh =
       Bitfield_impl::Num_bits<Value_t>::Value >
       (Bitfield_impl::Max_value_to_storage_bits_ratio * Storage_bits);
@@ -675,15 +2818,25 @@ struct Bitfield_w_fmt : public Bitfield
       Bitfield_impl::Num_bits<typename Bitfield::Storage_t>::Value;
 
     template <class Base_fmt>
-    static unsigned base_offset(unsigned derived_offset = 0)
+    static BITF_CONSTEXPR14 unsigned base_offset(unsigned derived_offset = 0)
       {
         const unsigned Storage_bits = Bitfield::Storage_bits;
 
+        #if __cplusplus >= 201402L
+
+        const unsigned From_start_unaligned =
+          Bitfield_impl::fmt_offset_of<Fmt>(
+            static_cast<const Base_fmt *>(&Bitfield_impl::fmt_image<Fmt>.f));
+
+        #else
+
         const unsigned From_start_unaligned =
           reinterpret_cast<char *>(static_cast<Base_fmt *>(
             reinterpret_cast<Fmt *>(0x100))) - 
           reinterpret_cast<char *>(0x100);
 
+        #endif
+
         const unsigned Unaligned =
           Bitfield::Fmt_offset_from_start ?
             From_start_unaligned :
@@ -697,6 +2850,19 @@ struct Bitfield_w_fmt : public Bitfield
              Storage_bits - (sizeof(Fmt) % Storage_bits) : derived_offset));
       }
 
+    // Reads several bit fields of a Fmt structure, reading each storage
+    // location in the structure at most once.  The parameter types are
+    // Bitfield::Storage_access_t, Bitfield::Field and Bitfield::Value_t .
+    template <class Storage_access_t, class Field, typename Value_t>
+    static void read_fields(
+      Storage_access_t base, const Field *fields, unsigned num_fields,
+      Value_t *values)
+      {
+        Bitfield::template read_fields<
+          Bitfield::template Define<Fmt>::Dimension>(
+            base, fields, num_fields, values);
+      }
+
     typedef Fmt Format;
   };
 
@@ -794,12 +2960,31 @@ struct Bitfield_w_fmt : public Bitfield
   BITF_CAT_W_OFS_STD(BITF_U_##SEL##_BWF, (BITF_U_##SEL##_BASE), FIELD_SPEC1, \
                      FIELD_SPEC2, OFS)
 
+// Evaluates to an instance of BWF::Field for the specified bit field.
+//
+#define BITF_FIELD_STD(BWF, FIELD_SPEC) \
+  typename BWF::Field(BITF_OFFSET(BWF, FIELD_SPEC), BITF_WIDTH(BWF, FIELD_SPEC))
+
+#define BITF_FIELD_ALT(SEL, FIELD_SPEC) \
+  BITF_FIELD_STD(BITF_U_##SEL##_BWF, FIELD_SPEC)
+
+// Evaluates to an instance of BWF::Static_bf for the specified bit field.
+//
+#define BITF_S_STD(BWF, BASE, FIELD_SPEC) \
+  (BWF::template Static_bf< \
+     BITF_OFFSET(BWF, FIELD_SPEC), BITF_WIDTH(BWF, FIELD_SPEC)>(BASE))
+
+#define BITF_S_ALT(SEL, FIELD_SPEC) \
+  BITF_S_STD(BITF_U_##SEL##_BWF, (BITF_U_##SEL##_BASE), FIELD_SPEC)
+
 #if defined(BITF_USE_ALT)
 
 #define BITF BITF_ALT
 #define BITF_W_OFS BITF_W_OFS_ALT
 #define BITF_CAT BITF_CAT_ALT
 #define BITF_CAT_W_OFS BITF_CAT_W_OFS_ALT
+#define BITF_S BITF_S_ALT
+#define BITF_FIELD BITF_FIELD_ALT
 
 #else
 
@@ -807,9 +2992,15 @@ struct Bitfield_w_fmt : public Bitfield
 #define BITF_W_OFS BITF_W_OFS_STD
 #define BITF_CAT BITF_CAT_STD
 #define BITF_CAT_W_OFS BITF_CAT_W_OFS_STD
+#define BITF_S BITF_S_STD
+#define BITF_FIELD BITF_FIELD_STD
 
 #endif
 
+// Buffers one storage location, for bit fields accessed in order of
+// increasing offset.  For access in any order, see Bitfield_shadow_buf in
+// bitfield_shadow.h .
+
 class Bitfield_seq_storage_write_default_traits
   {
   public:
@@ -0,0 +1,492 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Array of unsigned integers that are all Width bits, packed with no
+// padding into an array of storage locations.  Element i is the bit field
+// at offset (i * Width) from the start of the storage.  The storage is
+// either owned by the array (and can grow), or borrowed (has a fixed
+// capacity).
+//
+// The Storage_access_t of the Traits parameter must be constructible from
+// a pointer to Storage_t (as with Bitfield_traits_default).
+
+#ifndef BITFIELD_ARRAY_H_20160428
+#define BITFIELD_ARRAY_H_20160428
+
+#include "bitfield.h"
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+template <
+  class Traits, unsigned Width,
+  class Err_act = Bitfield_impl::Err_act_default<typename Traits::Value_t> >
+class Bitfield_array
+  {
+  public:
+
+    typedef Bitfield<Traits, Err_act> Bitfield_t;
+
+    typedef typename Bitfield_t::Value_t Value_t;
+
+    typedef typename Bitfield_t::Storage_t Storage_t;
+
+    typedef typename Bitfield_t::Storage_access_t Storage_access_t;
+
+    static const unsigned Storage_bits = Bitfield_t::Storage_bits;
+
+    typedef Value_t value_type;
+
+    typedef std::size_t size_type;
+
+    typedef std::ptrdiff_t difference_type;
+
+  private:
+
+    static int not_used[
+      1 / (((Width == 0) ||
+            (Width > Bitfield_impl::Num_bits<Value_t>::Value)) ? 0 : 1)];
+
+    // Index of the storage location, and offset within it, of the first
+    // bit of element i .  Storage_bits is a power of 2, so these are a
+    // shift and a mask.
+    static std::size_t word(std::size_t i)
+      { return((i * Width) / Storage_bits); }
+
+    static unsigned short offset(std::size_t i)
+      { return(static_cast<unsigned short>((i * Width) % Storage_bits)); }
+
+    // The Bf's base is the storage location containing the first bit, so
+    // the offset in the Bf is always less than Storage_bits .
+    static typename Bitfield_t::Bf bf(Storage_t *data, std::size_t i)
+      {
+        return(
+          typename Bitfield_t::Bf(
+            Storage_access_t(data + word(i)), offset(i), Width));
+      }
+
+    static std::size_t words(std::size_t n)
+      { return(((n * Width) + Storage_bits - 1) / Storage_bits); }
+
+    static unsigned gcd(unsigned a, unsigned b)
+      {
+        while (b)
+          {
+            unsigned t = a % b;
+            a = b;
+            b = t;
+          }
+
+        return(a);
+      }
+
+  public:
+
+    // Element of the array.  Has all of the capabilities of Bitfield::Bf
+    // (of which it is a derived class), and can be assigned to.
+    class Reference : public Bitfield_t::Bf
+      {
+      public:
+
+        Reference(Storage_t *data, std::size_t i)
+          : Bitfield_t::Bf(bf(data, i))
+          { }
+
+        Reference(const Reference &r) : Bitfield_t::Bf(r) { }
+
+        Reference & operator = (Value_t v) { this->write(v); return(*this); }
+
+        Reference & operator = (const Reference &r)
+          { this->write(Reference(r).read()); return(*this); }
+
+        friend void swap(Reference a, Reference b)
+          {
+            Value_t t = a.read();
+            a.write(b.read());
+            b.write(t);
+          }
+      };
+
+    template <typename Ref, typename Storage_ptr_t>
+    class Iterator_tmpl
+      {
+      public:
+
+        typedef std::random_access_iterator_tag iterator_category;
+
+        typedef typename Bitfield_array::Value_t value_type;
+
+        typedef std::ptrdiff_t difference_type;
+
+        typedef void pointer;
+
+        typedef Ref reference;
+
+        Iterator_tmpl() : data(0), idx(0) { }
+
+        Iterator_tmpl(Storage_ptr_t data_, std::size_t idx_)
+          : data(data_), idx(idx_)
+          { }
+
+        // Conversion from iterator to const_iterator.
+        template <typename R, typename S>
+        Iterator_tmpl(const Iterator_tmpl<R, S> &i)
+          : data(i.data), idx(i.idx)
+          { }
+
+        Ref operator * () const
+          { return(Ref(const_cast<Storage_t *>(data), idx)); }
+
+        Ref operator [] (difference_type d) const
+          { return(Ref(const_cast<Storage_t *>(data), idx + d)); }
+
+        Iterator_tmpl & operator ++ () { ++idx; return(*this); }
+
+        Iterator_tmpl & operator -- () { --idx; return(*this); }
+
+        Iterator_tmpl operator ++ (int)
+          { Iterator_tmpl t(*this); ++idx; return(t); }
+
+        Iterator_tmpl operator -- (int)
+          { Iterator_tmpl t(*this); --idx; return(t); }
+
+        Iterator_tmpl & operator += (difference_type d)
+          { idx += d; return(*this); }
+
+        Iterator_tmpl & operator -= (difference_type d)
+          { idx -= d; return(*this); }
+
+        Iterator_tmpl operator + (difference_type d) const
+          { return(Iterator_tmpl(data, idx + d)); }
+
+        friend Iterator_tmpl operator + (difference_type d, Iterator_tmpl i)
+          { return(i + d); }
+
+        Iterator_tmpl operator - (difference_type d) const
+          { return(Iterator_tmpl(data, idx - d)); }
+
+        difference_type operator - (const Iterator_tmpl &i) const
+          { return(difference_type(idx) - difference_type(i.idx)); }
+
+        bool operator == (const Iterator_tmpl &i) const
+          { return(idx == i.idx); }
+
+        bool operator != (const Iterator_tmpl &i) const
+          { return(idx != i.idx); }
+
+        bool operator < (const Iterator_tmpl &i) const
+          { return(idx < i.idx); }
+
+        bool operator > (const Iterator_tmpl &i) const
+          { return(idx > i.idx); }
+
+        bool operator <= (const Iterator_tmpl &i) const
+          { return(idx <= i.idx); }
+
+        bool operator >= (const Iterator_tmpl &i) const
+          { return(idx >= i.idx); }
+
+      private:
+
+        template <typename R, typename S> friend class Iterator_tmpl;
+
+        Storage_ptr_t data;
+
+        std::size_t idx;
+      };
+
+  private:
+
+    // Read-only element.
+    class Value_ref
+      {
+      public:
+
+        Value_ref(Storage_t *data, std::size_t i) : v(bf(data, i).read()) { }
+
+        operator Value_t () const { return(v); }
+
+      private:
+
+        Value_t v;
+      };
+
+  public:
+
+    typedef Reference reference;
+
+    typedef Value_t const_reference;
+
+    typedef Iterator_tmpl<Reference, Storage_t *> iterator;
+
+    typedef Iterator_tmpl<Value_ref, const Storage_t *> const_iterator;
+
+    // Empty array with owned storage.
+    Bitfield_array() : data_(0), size_(0), capacity_(0), owned(true) { }
+
+    // Array of n elements with owned storage, all elements set to v .
+    explicit Bitfield_array(std::size_t n, Value_t v = 0)
+      : store(words(n)), size_(n), capacity_(0), owned(true)
+      {
+        data_ = store.empty() ? 0 : &store[0];
+
+        fill(v);
+      }
+
+    // Array of n elements in borrowed storage, which must have room for
+    // at least capacity elements (capacity is increased to n if it is
+    // less).  The existing contents of the storage are the initial values
+    // of the elements.  Bits of the storage past the last element are
+    // never changed.
+    Bitfield_array(Storage_t *data, std::size_t n, std::size_t capacity = 0)
+      : data_(data), size_(n), capacity_(capacity < n ? n : capacity),
+        owned(false)
+      { }
+
+    Bitfield_array(const Bitfield_array &a)
+      : store(a.store), data_(a.data_), size_(a.size_),
+        capacity_(a.capacity_), owned(a.owned)
+      {
+        if (owned)
+          data_ = store.empty() ? 0 : &store[0];
+      }
+
+    Bitfield_array & operator = (const Bitfield_array &a)
+      {
+        store = a.store;
+        size_ = a.size_;
+        capacity_ = a.capacity_;
+        owned = a.owned;
+        data_ = owned ? (store.empty() ? 0 : &store[0]) : a.data_;
+
+        return(*this);
+      }
+
+    std::size_t size() const { return(size_); }
+
+    bool empty() const { return(size_ == 0); }
+
+    bool is_owned() const { return(owned); }
+
+    // Number of elements the array can hold without reallocating
+    // (owned) or at all (borrowed).
+    std::size_t capacity() const
+      {
+        return(owned ? ((store.capacity() * Storage_bits) / Width) : capacity_);
+      }
+
+    // Number of storage locations holding elements (that is,
+    // ceil(size() * Width / Storage_bits) ).
+    std::size_t num_words() const { return(words(size_)); }
+
+    Storage_t * data() { return(data_); }
+
+    const Storage_t * data() const { return(data_); }
+
+    Reference operator [] (std::size_t i) { return(Reference(data_, i)); }
+
+    Value_t operator [] (std::size_t i) const
+      { return(bf(const_cast<Storage_t *>(data_), i).read()); }
+
+    Reference front() { return((*this)[0]); }
+
+    Reference back() { return((*this)[size_ - 1]); }
+
+    iterator begin() { return(iterator(data_, 0)); }
+
+    iterator end() { return(iterator(data_, size_)); }
+
+    const_iterator begin() const { return(const_iterator(data_, 0)); }
+
+    const_iterator end() const { return(const_iterator(data_, size_)); }
+
+    // Appends an element.  Returns false (and does not change the array)
+    // if the value is too big for the element width, or the storage is
+    // borrowed and full.
+    bool push_back(Value_t v)
+      {
+        if (owned)
+          {
+            std::size_t w = words(size_ + 1);
+
+            if (w > store.size())
+              {
+                store.resize(w);
+                data_ = &store[0];
+              }
+          }
+        else if (size_ == capacity_)
+          return(false);
+
+        if (!bf(data_, size_).write(v))
+          {
+            if (owned)
+              store.resize(words(size_));
+
+            return(false);
+          }
+
+        ++size_;
+
+        return(true);
+      }
+
+    void pop_back()
+      {
+        --size_;
+
+        if (owned)
+          store.resize(words(size_));
+      }
+
+    // Changes the number of elements to n .  New elements are v .
+    // Returns false (and does not change the array) if the storage is
+    // borrowed and n is greater than the capacity.
+    bool resize(std::size_t n, Value_t v = 0)
+      {
+        if (owned)
+          {
+            store.resize(words(n));
+            data_ = store.empty() ? 0 : &store[0];
+          }
+        else if (n > capacity_)
+          return(false);
+
+        std::size_t old = size_;
+
+        size_ = n;
+
+        if (n > old)
+          fill(old, n, v);
+
+        return(true);
+      }
+
+    // Sets all elements to v .  Returns false (and does not change the
+    // array) if v is too big for the element width.
+    bool fill(Value_t v) { return(fill(0, size_, v)); }
+
+    // Sets elements first through last - 1 to v .
+    bool fill(std::size_t first, std::size_t last, Value_t v)
+      {
+        if (first >= last)
+          return(true);
+
+        if (!bf(data_, first).write(v))
+          return(false);
+
+        // Write elements up to a storage boundary, then one period (of
+        // the pattern of storage location values) of elements.  The
+        // storage locations that are entirely in the range are then
+        // copied from one period earlier.
+        std::size_t i = first + 1;
+
+        while ((i < last) && offset(i))
+          bf(data_, i++).write_nvc(v);
+
+        const unsigned g = gcd(Width, Storage_bits);
+
+        const std::size_t period_words = Width / g;
+
+        const std::size_t period_elems = Storage_bits / g;
+
+        std::size_t w = word(i);
+
+        std::size_t e = i + period_elems;
+
+        for ( ; (i < e) && (i < last); ++i)
+          bf(data_, i).write_nvc(v);
+
+        if (i < last)
+          {
+            std::size_t end_word = (last * Width) / Storage_bits;
+
+            for (std::size_t j = w + period_words; j < end_word; ++j)
+              data_[j] = data_[j - period_words];
+
+            // Elements in the last, partially covered storage location.
+            i = (end_word * Storage_bits) / Width;
+
+            for ( ; i < last; ++i)
+              bf(data_, i).write_nvc(v);
+          }
+
+        return(true);
+      }
+
+    // Sets count elements, starting at element pos, to values .  Returns
+    // false if a value is too big for the element width, in which case
+    // the elements before it have been set.
+    bool assign(std::size_t pos, const Value_t *values, std::size_t count)
+      {
+        Storage_t *p = data_ + word(pos);
+        unsigned short ofs = offset(pos);
+
+        for (std::size_t i = 0; i < count; ++i)
+          {
+            if (!Bitfield_t::fn(Storage_access_t(p), ofs, Width).
+                  write(values[i]))
+              return(false);
+
+            advance(p, ofs);
+          }
+
+        return(true);
+      }
+
+    // Copies count elements, starting at element pos, to values .
+    void copy_to(std::size_t pos, Value_t *values, std::size_t count) const
+      {
+        Storage_t *p = const_cast<Storage_t *>(data_) + word(pos);
+        unsigned short ofs = offset(pos);
+
+        for (std::size_t i = 0; i < count; ++i)
+          {
+            values[i] = Bitfield_t::fn(Storage_access_t(p), ofs, Width);
+
+            advance(p, ofs);
+          }
+      }
+
+  private:
+
+    // Moves to the next element.
+    static void advance(Storage_t *&p, unsigned short &ofs)
+      {
+        ofs += Width;
+
+        while (ofs >= Storage_bits)
+          {
+            ofs -= Storage_bits;
+            ++p;
+          }
+      }
+
+    std::vector<Storage_t> store;
+
+    Storage_t *data_;
+
+    std::size_t size_, capacity_;
+
+    bool owned;
+
+  }; // end class Bitfield_array
+
+#endif // Include once.
@@ -0,0 +1,297 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Bit fields in storage locations of type std::atomic<Storage_t> .
+// Requires C++11.
+//
+// Each storage location is changed atomically, so threads changing
+// different bit fields in the same storage location do not lose each
+// other's changes.  A bit field that straddles storage locations is not
+// read or changed atomically as a whole.
+//
+// The zero(), b_and(), b_or(), b_xor() and b_comp() operations (of Bf and
+// Static_bf) use fetch_and(), fetch_or() and fetch_xor() .  Other
+// modifiers (including the one for write()) are run in a compare-exchange
+// loop.  They may be called more than once for a storage location, so
+// they must depend only on the value they read from it.
+//
+// Read_order is the memory order for loads (so must not be
+// memory_order_release or memory_order_acq_rel).  Modify_order is the
+// memory order for read-modify-write operations.
+
+#ifndef BITFIELD_ATOMIC_H_20160428
+#define BITFIELD_ATOMIC_H_20160428
+
+#include "bitfield.h"
+
+#include <atomic>
+#include <type_traits>
+
+template <
+  typename S_t, std::memory_order Read_order = std::memory_order_seq_cst,
+  std::memory_order Modify_order = std::memory_order_seq_cst>
+class Bitfield_atomic_access
+  {
+  public:
+
+    typedef S_t Storage_t;
+
+    Bitfield_atomic_access(std::atomic<Storage_t> *p) : ptr(p), rec(nullptr)
+      { }
+
+    void operator += (std::size_t offset) { ptr += offset; }
+
+    Storage_t read() { return(rec ? *rec : ptr->load(Read_order)); }
+
+    void write(Storage_t t)
+      {
+        if (rec)
+          *rec = t;
+        else
+          ptr->store(t, Store_order);
+      }
+
+    void fetch_and(Storage_t x)
+      {
+        if (rec)
+          *rec &= x;
+        else
+          ptr->fetch_and(x, Modify_order);
+      }
+
+    void fetch_or(Storage_t x)
+      {
+        if (rec)
+          *rec |= x;
+        else
+          ptr->fetch_or(x, Modify_order);
+      }
+
+    void fetch_xor(Storage_t x)
+      {
+        if (rec)
+          *rec ^= x;
+        else
+          ptr->fetch_xor(x, Modify_order);
+      }
+
+    // Calls f (a function of an access to this storage location) until
+    // the changes it makes can be stored with a compare-exchange.  f
+    // reads and writes a local copy of the storage location.  If f
+    // returns false, returns false without changing the storage location.
+    template <class F>
+    bool cas_loop(F f)
+      {
+        Storage_t expected = ptr->load(Read_order), desired;
+
+        Bitfield_atomic_access r(*this);
+        r.rec = &desired;
+
+        do
+          {
+            desired = expected;
+
+            if (!f(r))
+              return(false);
+          }
+        while (!ptr->compare_exchange_weak(
+                  expected, desired, Modify_order, Failure_order));
+
+        return(true);
+      }
+
+    // True if this access is to the local copy of a storage location, in
+    // a function called by cas_loop() .
+    bool in_cas_loop() const { return(rec != nullptr); }
+
+  private:
+
+    // Memory orders derived from Modify_order that are valid for a store
+    // and for the load after a failed compare-exchange.
+
+    static const std::memory_order Store_order =
+      (Modify_order == std::memory_order_acq_rel) ?
+        std::memory_order_release :
+      ((Modify_order == std::memory_order_acquire) ||
+       (Modify_order == std::memory_order_consume)) ?
+        std::memory_order_relaxed : Modify_order;
+
+    static const std::memory_order Failure_order =
+      (Modify_order == std::memory_order_acq_rel) ?
+        std::memory_order_acquire :
+      (Modify_order == std::memory_order_release) ?
+        std::memory_order_relaxed : Modify_order;
+
+    std::atomic<Storage_t> *ptr;
+
+    // If not null, read and write this local copy of the storage location
+    // (in a compare-exchange loop).
+    Storage_t *rec;
+
+  }; // end class Bitfield_atomic_access
+
+namespace Bitfield_impl
+{
+
+template <
+  typename S_t, std::memory_order Read_order, std::memory_order Modify_order>
+struct Storage_ops<Bitfield_atomic_access<S_t, Read_order, Modify_order> >
+  {
+    typedef Bitfield_atomic_access<S_t, Read_order, Modify_order> Access;
+
+    template <class Modifier, class... Position>
+    static void modify(Access s, Modifier &m, Position... pos)
+      {
+        if (std::is_base_of<Single_op_modifier, Modifier>::value ||
+            s.in_cas_loop())
+          m(s, pos...);
+        else
+          s.cas_loop([&](Access r) { m(r, pos...); return(true); });
+      }
+
+    static void b_and(Access s, S_t x) { s.fetch_and(x); }
+
+    static void b_or(Access s, S_t x) { s.fetch_or(x); }
+
+    static void b_xor(Access s, S_t x) { s.fetch_xor(x); }
+  };
+
+} // namespace Bitfield_impl
+
+template <
+  typename V_t = unsigned, typename S_t = V_t,
+  std::memory_order Read_order = std::memory_order_seq_cst,
+  std::memory_order Modify_order = std::memory_order_seq_cst>
+class Bitfield_traits_atomic : public Bitfield_traits_default<V_t, S_t>
+  {
+  public:
+
+    typedef Bitfield_atomic_access<S_t, Read_order, Modify_order>
+      Storage_access_t;
+
+  }; // class Bitfield_traits_atomic
+
+// Compare-and-swap of several bit fields in one storage location.  The
+// Bitfield parameter is an instantiation of Bitfield (or Bitfield_w_fmt)
+// whose Storage_access_t is Bitfield_atomic_access .  For a 128-bit
+// storage location, Storage_t can be unsigned __int128 (with GCC on
+// x86-64, compile with -mcx16 and link with -latomic to get cmpxchg16b).
+template <class Bitfield>
+class Bitfield_atomic_fields
+  {
+  public:
+
+    typedef typename Bitfield::Value_t Value_t;
+
+    typedef typename Bitfield::Storage_t Storage_t;
+
+    typedef typename Bitfield::Storage_access_t Storage_access_t;
+
+    typedef typename Bitfield::Field Field;
+
+    static const unsigned Storage_bits = Bitfield::Storage_bits;
+
+    // True if the bit fields are all in the same storage location.
+    static bool is_single_unit(const Field *fields, unsigned num_fields)
+      {
+        if ((num_fields == 0) || !valid(fields[0]))
+          return(false);
+
+        unsigned unit = fields[0].first_bit / Storage_bits;
+
+        for (unsigned i = 0; i < num_fields; ++i)
+          if (!valid(fields[i]) ||
+              ((fields[i].first_bit / Storage_bits) != unit) ||
+              (((fields[i].first_bit + fields[i].field_width - 1) /
+                Storage_bits) != unit))
+            return(false);
+
+        return(true);
+      }
+
+    // If each bit field i (in the record at base) is equal to
+    // expected[i], sets it to desired[i], with a single compare-exchange,
+    // and returns true.  If the fields are not all equal to their
+    // expected values, returns false, and sets expected[] to the current
+    // values of the fields.  Returns false (leaving expected[] unchanged)
+    // if !is_single_unit(fields, num_fields) , or a desired value is too
+    // big for its field (reported through Err_act as by Bf::write()).
+    static bool compare_exchange(
+      Storage_access_t base, const Field *fields, unsigned num_fields,
+      Value_t *expected, const Value_t *desired)
+      {
+        if (!is_single_unit(fields, num_fields))
+          return(false);
+
+        for (unsigned i = 0; i < num_fields; ++i)
+          if ((desired[i] >> (fields[i].field_width - 1)) >> 1)
+            {
+              Bitfield::Err_act_t::value_too_big(
+                desired[i], fields[i].field_width);
+
+              return(false);
+            }
+
+        const unsigned unit = fields[0].first_bit / Storage_bits;
+
+        base += unit;
+
+        bool mismatch = false;
+
+        bool success =
+          base.cas_loop(
+            [&](Storage_access_t r)
+              {
+                for (unsigned i = 0; i < num_fields; ++i)
+                  if (fn(r, fields[i], unit).read() != expected[i])
+                    {
+                      for (unsigned j = 0; j < num_fields; ++j)
+                        expected[j] = fn(r, fields[j], unit).read();
+
+                      mismatch = true;
+
+                      return(false);
+                    }
+
+                for (unsigned i = 0; i < num_fields; ++i)
+                  fn(r, fields[i], unit).write_nvc(desired[i]);
+
+                return(true);
+              });
+
+        return(success && !mismatch);
+      }
+
+  private:
+
+    static bool valid(const Field &f)
+      {
+        return(
+          (f.field_width != 0) &&
+          (f.field_width <= Bitfield_impl::Num_bits<Value_t>::Value));
+      }
+
+    static typename Bitfield::Bf fn(
+      Storage_access_t r, const Field &f, unsigned unit)
+      { return(Bitfield::fn(r, f.first_bit - (unit * Storage_bits),
+                            f.field_width)); }
+
+  }; // end class Bitfield_atomic_fields
+
+#endif // Include once.
@@ -0,0 +1,1283 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Bulk access to one bit field in each of an array of records, where each
+// record is a bit field structure in main memory.  The records are at a
+// fixed stride (in storage locations) from each other.  The bit field can
+// be read or written, or tested with a predicate (select() ) to find the
+// records with values of interest.
+//
+// On x86-64 with GCC or Clang, AVX2 or SSE4.1 kernels are used when the
+// CPU supports them (checked at run time), and the value and storage
+// types are both 32 or both 64 bits.  (There are only AVX2 kernels for
+// select() .)  Otherwise, Bitfield::Bf is used for each record.
+
+#ifndef BITFIELD_BULK_H_20160428
+#define BITFIELD_BULK_H_20160428
+
+#include "bitfield.h"
+
+#include <cstddef>
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__x86_64__)
+
+#define BITFIELD_BULK_X86 1
+
+#include <immintrin.h>
+
+#define BITFIELD_BULK_AVX2 __attribute__((target("avx2")))
+#define BITFIELD_BULK_SSE41 __attribute__((target("sse4.1")))
+
+#else
+
+#define BITFIELD_BULK_X86 0
+
+#endif
+
+// Instruction sets the kernels can use, from least to most capable.
+enum Bitfield_bulk_isa
+  {
+    Bitfield_bulk_scalar,
+    Bitfield_bulk_sse41,
+    Bitfield_bulk_avx2
+  };
+
+// Names defined in this namespace should not be used outside this
+// header file.
+namespace Bitfield_bulk_impl
+{
+
+inline Bitfield_bulk_isa detect_isa()
+  {
+    #if BITFIELD_BULK_X86
+
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+      return(Bitfield_bulk_avx2);
+
+    if (__builtin_cpu_supports("sse4.1"))
+      return(Bitfield_bulk_sse41);
+
+    #endif
+
+    return(Bitfield_bulk_scalar);
+  }
+
+// The most capable instruction set the CPU supports, no more capable
+// than max_isa.
+inline Bitfield_bulk_isa isa(Bitfield_bulk_isa max_isa)
+  {
+    static const Bitfield_bulk_isa Cpu_isa = detect_isa();
+
+    return(Cpu_isa < max_isa ? Cpu_isa : max_isa);
+  }
+
+// Where a bit field (of at most 2 storage locations) is in each record,
+// and the shifts to move it between a record and a value.  For a
+// storage location w of the bit field, the corresponding part of the
+// value is ((w << ls[n]) >> rs[n]) .  Shift counts that are not less than
+// the number of bits in the storage type give a result of zero, as with
+// the x86 vector shift instructions.
+struct Plan
+  {
+    std::size_t word;
+
+    bool straddle;
+
+    unsigned ls[2], rs[2];
+
+    // For writing, the part of the value for storage location n is
+    // ((v >> vrs[n]) << vls[n]) , and wmask[n] is the bits of the storage
+    // location that are in the bit field.
+    unsigned vls[2], vrs[2];
+
+    unsigned long long wmask[2];
+
+    unsigned long long vmask;
+  };
+
+inline unsigned long long mask64(unsigned width)
+  { return(Bitfield_impl::mask<unsigned long long>(width)); }
+
+inline Plan plan(
+  unsigned storage_bits, bool ls_first, unsigned first_bit,
+  unsigned field_width)
+  {
+    Plan p;
+
+    p.word = first_bit / storage_bits;
+
+    const unsigned s = first_bit % storage_bits;
+
+    p.straddle = (s + field_width) > storage_bits;
+
+    const unsigned long long smask = mask64(storage_bits);
+
+    p.vmask = mask64(field_width);
+
+    // Width of the part in the second storage location.
+    const unsigned rem = p.straddle ? (s + field_width - storage_bits) : 0;
+
+    if (ls_first)
+      {
+        p.ls[0] = 0;
+        p.rs[0] = s;
+        p.ls[1] = storage_bits - s;
+        p.rs[1] = 0;
+
+        p.vls[0] = s;
+        p.vrs[0] = 0;
+        p.vls[1] = 0;
+        p.vrs[1] = storage_bits - s;
+
+        p.wmask[0] = (p.vmask << s) & smask;
+        p.wmask[1] = mask64(rem);
+      }
+    else if (p.straddle)
+      {
+        p.ls[0] = rem;
+        p.rs[0] = 0;
+        p.ls[1] = 0;
+        p.rs[1] = storage_bits - rem;
+
+        p.vls[0] = 0;
+        p.vrs[0] = rem;
+        p.vls[1] = storage_bits - rem;
+        p.vrs[1] = 0;
+
+        p.wmask[0] = mask64(storage_bits - s);
+        p.wmask[1] = (mask64(rem) << (storage_bits - rem)) & smask;
+      }
+    else
+      {
+        const unsigned r = storage_bits - s - field_width;
+
+        p.ls[0] = 0;
+        p.rs[0] = r;
+        p.ls[1] = storage_bits;
+        p.rs[1] = storage_bits;
+
+        p.vls[0] = r;
+        p.vrs[0] = 0;
+        p.vls[1] = storage_bits;
+        p.vrs[1] = storage_bits;
+
+        p.wmask[0] = (p.vmask << r) & smask;
+        p.wmask[1] = 0;
+      }
+
+    if (!p.straddle)
+      p.wmask[1] = 0;
+
+    return(p);
+  }
+
+// A predicate on the value v of a bit field:
+// (((v & mask) - lo) <= span) , in the value type, negated if invert is
+// true.
+struct Select
+  {
+    unsigned long long mask, lo, span;
+
+    bool invert;
+  };
+
+inline unsigned popcount64(unsigned long long w)
+  {
+    #if defined(__GNUC__) || defined(__clang__)
+
+    return(unsigned(__builtin_popcountll(w)));
+
+    #else
+
+    unsigned n = 0;
+
+    for ( ; w; w &= w - 1)
+      ++n;
+
+    return(n);
+
+    #endif
+  }
+
+// Index of the least significant one bit (w must not be 0).
+inline unsigned ctz64(unsigned long long w)
+  {
+    #if defined(__GNUC__) || defined(__clang__)
+
+    return(unsigned(__builtin_ctzll(w)));
+
+    #else
+
+    unsigned n = 0;
+
+    for ( ; !(w & 1); w >>= 1)
+      ++n;
+
+    return(n);
+
+    #endif
+  }
+
+#if BITFIELD_BULK_X86
+
+// The kernels access storage locations and values through these types,
+// which may alias other integer types of the same size (uint64_t is
+// unsigned long with LP64, for example).
+typedef unsigned __attribute__((__may_alias__)) Word32;
+
+typedef unsigned long long __attribute__((__may_alias__)) Word64;
+
+template <typename Word>
+struct Alias;
+
+template <>
+struct Alias<unsigned> { typedef Word32 Type; };
+
+template <>
+struct Alias<unsigned long long> { typedef Word64 Type; };
+
+// Kernels.  Each handles a multiple of the number of vector lanes of
+// records, and returns the number of records it handled.
+
+BITFIELD_BULK_AVX2
+inline std::size_t avx2_read(
+  const Word32 *base, std::size_t stride, std::size_t count,
+  const Plan &p, Word32 *values)
+  {
+    const __m256i idx =
+      _mm256_mullo_epi32(
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+        _mm256_set1_epi32(int(stride)));
+
+    const __m128i ls0 = _mm_cvtsi32_si128(int(p.ls[0]));
+    const __m128i rs0 = _mm_cvtsi32_si128(int(p.rs[0]));
+    const __m128i ls1 = _mm_cvtsi32_si128(int(p.ls[1]));
+    const __m128i rs1 = _mm_cvtsi32_si128(int(p.rs[1]));
+
+    const __m256i m = _mm256_set1_epi32(int(unsigned(p.vmask)));
+
+    const int *w = reinterpret_cast<const int *>(base + p.word);
+
+    std::size_t n = count & ~std::size_t(7);
+
+    for (std::size_t i = 0; i < n; i += 8, w += 8 * stride)
+      {
+        __m256i a = _mm256_i32gather_epi32(w, idx, 4);
+
+        __m256i v = _mm256_srl_epi32(_mm256_sll_epi32(a, ls0), rs0);
+
+        if (p.straddle)
+          {
+            __m256i b = _mm256_i32gather_epi32(w + 1, idx, 4);
+
+            v = _mm256_or_si256(
+                  v, _mm256_srl_epi32(_mm256_sll_epi32(b, ls1), rs1));
+          }
+
+        _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(values + i), _mm256_and_si256(v, m));
+      }
+
+    return(n);
+  }
+
+BITFIELD_BULK_AVX2
+inline std::size_t avx2_read(
+  const Word64 *base, std::size_t stride, std::size_t count,
+  const Plan &p, Word64 *values)
+  {
+    const __m128i idx =
+      _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(int(stride)));
+
+    const __m128i ls0 = _mm_cvtsi32_si128(int(p.ls[0]));
+    const __m128i rs0 = _mm_cvtsi32_si128(int(p.rs[0]));
+    const __m128i ls1 = _mm_cvtsi32_si128(int(p.ls[1]));
+    const __m128i rs1 = _mm_cvtsi32_si128(int(p.rs[1]));
+
+    const __m256i m = _mm256_set1_epi64x((long long)(p.vmask));
+
+    const long long *w = reinterpret_cast<const long long *>(base + p.word);
+
+    std::size_t n = count & ~std::size_t(3);
+
+    for (std::size_t i = 0; i < n; i += 4, w += 4 * stride)
+      {
+        __m256i a = _mm256_i32gather_epi64(w, idx, 8);
+
+        __m256i v = _mm256_srl_epi64(_mm256_sll_epi64(a, ls0), rs0);
+
+        if (p.straddle)
+          {
+            __m256i b = _mm256_i32gather_epi64(w + 1, idx, 8);
+
+            v = _mm256_or_si256(
+                  v, _mm256_srl_epi64(_mm256_sll_epi64(b, ls1), rs1));
+          }
+
+        _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(values + i), _mm256_and_si256(v, m));
+      }
+
+    return(n);
+  }
+
+BITFIELD_BULK_SSE41
+inline __m128i sse41_load4(const Word32 *w, std::size_t stride)
+  {
+    __m128i a = _mm_cvtsi32_si128(int(w[0]));
+    a = _mm_insert_epi32(a, int(w[stride]), 1);
+    a = _mm_insert_epi32(a, int(w[2 * stride]), 2);
+    return(_mm_insert_epi32(a, int(w[3 * stride]), 3));
+  }
+
+BITFIELD_BULK_SSE41
+inline __m128i sse41_load2(const Word64 *w, std::size_t stride)
+  {
+    __m128i a = _mm_cvtsi64_si128((long long)(w[0]));
+    return(_mm_insert_epi64(a, (long long)(w[stride]), 1));
+  }
+
+BITFIELD_BULK_SSE41
+inline std::size_t sse41_read(
+  const Word32 *base, std::size_t stride, std::size_t count,
+  const Plan &p, Word32 *values)
+  {
+    const __m128i ls0 = _mm_cvtsi32_si128(int(p.ls[0]));
+    const __m128i rs0 = _mm_cvtsi32_si128(int(p.rs[0]));
+    const __m128i ls1 = _mm_cvtsi32_si128(int(p.ls[1]));
+    const __m128i rs1 = _mm_cvtsi32_si128(int(p.rs[1]));
+
+    const __m128i m = _mm_set1_epi32(int(unsigned(p.vmask)));
+
+    const Word32 *w = base + p.word;
+
+    std::size_t n = count & ~std::size_t(3);
+
+    for (std::size_t i = 0; i < n; i += 4, w += 4 * stride)
+      {
+        __m128i v = _mm_srl_epi32(_mm_sll_epi32(sse41_load4(w, stride), ls0), rs0);
+
+        if (p.straddle)
+          v = _mm_or_si128(
+                v,
+                _mm_srl_epi32(
+                  _mm_sll_epi32(sse41_load4(w + 1, stride), ls1), rs1));
+
+        _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(values + i), _mm_and_si128(v, m));
+      }
+
+    return(n);
+  }
+
+BITFIELD_BULK_SSE41
+inline std::size_t sse41_read(
+  const Word64 *base, std::size_t stride, std::size_t count,
+  const Plan &p, Word64 *values)
+  {
+    const __m128i ls0 = _mm_cvtsi32_si128(int(p.ls[0]));
+    const __m128i rs0 = _mm_cvtsi32_si128(int(p.rs[0]));
+    const __m128i ls1 = _mm_cvtsi32_si128(int(p.ls[1]));
+    const __m128i rs1 = _mm_cvtsi32_si128(int(p.rs[1]));
+
+    const __m128i m = _mm_set1_epi64x((long long)(p.vmask));
+
+    const Word64 *w = base + p.word;
+
+    std::size_t n = count & ~std::size_t(1);
+
+    for (std::size_t i = 0; i < n; i += 2, w += 2 * stride)
+      {
+        __m128i v = _mm_srl_epi64(_mm_sll_epi64(sse41_load2(w, stride), ls0), rs0);
+
+        if (p.straddle)
+          v = _mm_or_si128(
+                v,
+                _mm_srl_epi64(
+                  _mm_sll_epi64(sse41_load2(w + 1, stride), ls1), rs1));
+
+        _mm_storeu_si128(
+          reinterpret_cast<__m128i *>(values + i), _mm_and_si128(v, m));
+      }
+
+    return(n);
+  }
+
+// The write kernels compute the new contents of the storage locations of
+// a vector of records, then store them one at a time (there is no scatter
+// before AVX-512).  As with Bf::write_nvc() , value bits beyond the width
+// of the field are not masked off.  Records must not share storage
+// locations.
+
+BITFIELD_BULK_AVX2
+inline std::size_t avx2_write(
+  Word32 *base, std::size_t stride, std::size_t count, const Plan &p,
+  const Word32 *values)
+  {
+    const __m256i idx =
+      _mm256_mullo_epi32(
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+        _mm256_set1_epi32(int(stride)));
+
+    const __m128i vls0 = _mm_cvtsi32_si128(int(p.vls[0]));
+    const __m128i vrs0 = _mm_cvtsi32_si128(int(p.vrs[0]));
+    const __m128i vls1 = _mm_cvtsi32_si128(int(p.vls[1]));
+    const __m128i vrs1 = _mm_cvtsi32_si128(int(p.vrs[1]));
+
+    const __m256i m0 = _mm256_set1_epi32(int(unsigned(p.wmask[0])));
+    const __m256i m1 = _mm256_set1_epi32(int(unsigned(p.wmask[1])));
+
+    Word32 *w = base + p.word;
+
+    unsigned n0[8], n1[8];
+
+    std::size_t n = count & ~std::size_t(7);
+
+    for (std::size_t i = 0; i < n; i += 8, w += 8 * stride)
+      {
+        __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+
+        __m256i a =
+          _mm256_i32gather_epi32(reinterpret_cast<const int *>(w), idx, 4);
+
+        _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(n0),
+          _mm256_or_si256(
+            _mm256_sll_epi32(_mm256_srl_epi32(v, vrs0), vls0),
+            _mm256_andnot_si256(m0, a)));
+
+        if (p.straddle)
+          {
+            __m256i b =
+              _mm256_i32gather_epi32(
+                reinterpret_cast<const int *>(w + 1), idx, 4);
+
+            _mm256_storeu_si256(
+              reinterpret_cast<__m256i *>(n1),
+              _mm256_or_si256(
+                _mm256_sll_epi32(_mm256_srl_epi32(v, vrs1), vls1),
+                _mm256_andnot_si256(m1, b)));
+
+            for (unsigned j = 0; j < 8; ++j)
+              {
+                w[j * stride] = n0[j];
+                w[(j * stride) + 1] = n1[j];
+              }
+          }
+        else
+          for (unsigned j = 0; j < 8; ++j)
+            w[j * stride] = n0[j];
+      }
+
+    return(n);
+  }
+
+BITFIELD_BULK_AVX2
+inline std::size_t avx2_write(
+  Word64 *base, std::size_t stride, std::size_t count,
+  const Plan &p, const Word64 *values)
+  {
+    const __m128i idx =
+      _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(int(stride)));
+
+    const __m128i vls0 = _mm_cvtsi32_si128(int(p.vls[0]));
+    const __m128i vrs0 = _mm_cvtsi32_si128(int(p.vrs[0]));
+    const __m128i vls1 = _mm_cvtsi32_si128(int(p.vls[1]));
+    const __m128i vrs1 = _mm_cvtsi32_si128(int(p.vrs[1]));
+
+    const __m256i m0 = _mm256_set1_epi64x((long long)(p.wmask[0]));
+    const __m256i m1 = _mm256_set1_epi64x((long long)(p.wmask[1]));
+
+    Word64 *w = base + p.word;
+
+    unsigned long long n0[4], n1[4];
+
+    std::size_t n = count & ~std::size_t(3);
+
+    for (std::size_t i = 0; i < n; i += 4, w += 4 * stride)
+      {
+        __m256i v =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(values + i));
+
+        __m256i a =
+          _mm256_i32gather_epi64(
+            reinterpret_cast<const long long *>(w), idx, 8);
+
+        _mm256_storeu_si256(
+          reinterpret_cast<__m256i *>(n0),
+          _mm256_or_si256(
+            _mm256_sll_epi64(_mm256_srl_epi64(v, vrs0), vls0),
+            _mm256_andnot_si256(m0, a)));
+
+        if (p.straddle)
+          {
+            __m256i b =
+              _mm256_i32gather_epi64(
+                reinterpret_cast<const long long *>(w + 1), idx, 8);
+
+            _mm256_storeu_si256(
+              reinterpret_cast<__m256i *>(n1),
+              _mm256_or_si256(
+                _mm256_sll_epi64(_mm256_srl_epi64(v, vrs1), vls1),
+                _mm256_andnot_si256(m1, b)));
+
+            for (unsigned j = 0; j < 4; ++j)
+              {
+                w[j * stride] = n0[j];
+                w[(j * stride) + 1] = n1[j];
+              }
+          }
+        else
+          for (unsigned j = 0; j < 4; ++j)
+            w[j * stride] = n0[j];
+      }
+
+    return(n);
+  }
+
+BITFIELD_BULK_SSE41
+inline std::size_t sse41_write(
+  Word32 *base, std::size_t stride, std::size_t count, const Plan &p,
+  const Word32 *values)
+  {
+    const __m128i vls0 = _mm_cvtsi32_si128(int(p.vls[0]));
+    const __m128i vrs0 = _mm_cvtsi32_si128(int(p.vrs[0]));
+    const __m128i vls1 = _mm_cvtsi32_si128(int(p.vls[1]));
+    const __m128i vrs1 = _mm_cvtsi32_si128(int(p.vrs[1]));
+
+    const __m128i m0 = _mm_set1_epi32(int(unsigned(p.wmask[0])));
+    const __m128i m1 = _mm_set1_epi32(int(unsigned(p.wmask[1])));
+
+    Word32 *w = base + p.word;
+
+    std::size_t n = count & ~std::size_t(3);
+
+    for (std::size_t i = 0; i < n; i += 4, w += 4 * stride)
+      {
+        __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+
+        __m128i x =
+          _mm_or_si128(
+            _mm_sll_epi32(_mm_srl_epi32(v, vrs0), vls0),
+            _mm_andnot_si128(m0, sse41_load4(w, stride)));
+
+        if (p.straddle)
+          {
+            __m128i y =
+              _mm_or_si128(
+                _mm_sll_epi32(_mm_srl_epi32(v, vrs1), vls1),
+                _mm_andnot_si128(m1, sse41_load4(w + 1, stride)));
+
+            w[1] = unsigned(_mm_extract_epi32(y, 0));
+            w[stride + 1] = unsigned(_mm_extract_epi32(y, 1));
+            w[(2 * stride) + 1] = unsigned(_mm_extract_epi32(y, 2));
+            w[(3 * stride) + 1] = unsigned(_mm_extract_epi32(y, 3));
+          }
+
+        w[0] = unsigned(_mm_extract_epi32(x, 0));
+        w[stride] = unsigned(_mm_extract_epi32(x, 1));
+        w[2 * stride] = unsigned(_mm_extract_epi32(x, 2));
+        w[3 * stride] = unsigned(_mm_extract_epi32(x, 3));
+      }
+
+    return(n);
+  }
+
+BITFIELD_BULK_SSE41
+inline std::size_t sse41_write(
+  Word64 *base, std::size_t stride, std::size_t count,
+  const Plan &p, const Word64 *values)
+  {
+    const __m128i vls0 = _mm_cvtsi32_si128(int(p.vls[0]));
+    const __m128i vrs0 = _mm_cvtsi32_si128(int(p.vrs[0]));
+    const __m128i vls1 = _mm_cvtsi32_si128(int(p.vls[1]));
+    const __m128i vrs1 = _mm_cvtsi32_si128(int(p.vrs[1]));
+
+    const __m128i m0 = _mm_set1_epi64x((long long)(p.wmask[0]));
+    const __m128i m1 = _mm_set1_epi64x((long long)(p.wmask[1]));
+
+    Word64 *w = base + p.word;
+
+    std::size_t n = count & ~std::size_t(1);
+
+    for (std::size_t i = 0; i < n; i += 2, w += 2 * stride)
+      {
+        __m128i v =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(values + i));
+
+        __m128i x =
+          _mm_or_si128(
+            _mm_sll_epi64(_mm_srl_epi64(v, vrs0), vls0),
+            _mm_andnot_si128(m0, sse41_load2(w, stride)));
+
+        if (p.straddle)
+          {
+            __m128i y =
+              _mm_or_si128(
+                _mm_sll_epi64(_mm_srl_epi64(v, vrs1), vls1),
+                _mm_andnot_si128(m1, sse41_load2(w + 1, stride)));
+
+            w[1] = (unsigned long long)(_mm_extract_epi64(y, 0));
+            w[stride + 1] = (unsigned long long)(_mm_extract_epi64(y, 1));
+          }
+
+        w[0] = (unsigned long long)(_mm_extract_epi64(x, 0));
+        w[stride] = (unsigned long long)(_mm_extract_epi64(x, 1));
+      }
+
+    return(n);
+  }
+
+// The select kernels compare the bit fields in a vector of records with
+// the predicate without storing their values.  Each handles a multiple of
+// 64 records, sets the bitmap word for each 64, and adds the number of
+// records selected to selected .  With a stride of one, the storage
+// locations are loaded rather than gathered.
+
+BITFIELD_BULK_AVX2
+inline __m256i avx2_load8(
+  const Word32 *w, std::size_t stride, const __m256i &idx)
+  {
+    if (stride == 1)
+      return(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(w)));
+
+    return(_mm256_i32gather_epi32(reinterpret_cast<const int *>(w), idx, 4));
+  }
+
+BITFIELD_BULK_AVX2
+inline __m256i avx2_load4(
+  const Word64 *w, std::size_t stride, const __m128i &idx)
+  {
+    if (stride == 1)
+      return(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(w)));
+
+    return(
+      _mm256_i32gather_epi64(reinterpret_cast<const long long *>(w), idx, 8));
+  }
+
+BITFIELD_BULK_AVX2
+inline std::size_t avx2_select(
+  const Word32 *base, std::size_t stride, std::size_t count,
+  const Plan &p, const Select &s, unsigned long long *bitmap,
+  std::size_t &selected)
+  {
+    const __m256i idx =
+      _mm256_mullo_epi32(
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+        _mm256_set1_epi32(int(stride)));
+
+    const __m128i ls0 = _mm_cvtsi32_si128(int(p.ls[0]));
+    const __m128i rs0 = _mm_cvtsi32_si128(int(p.rs[0]));
+    const __m128i ls1 = _mm_cvtsi32_si128(int(p.ls[1]));
+    const __m128i rs1 = _mm_cvtsi32_si128(int(p.rs[1]));
+
+    const __m256i m = _mm256_set1_epi32(int(unsigned(p.vmask & s.mask)));
+    const __m256i lo = _mm256_set1_epi32(int(unsigned(s.lo)));
+    const __m256i span = _mm256_set1_epi32(int(unsigned(s.span)));
+
+    const unsigned long long inv = s.invert ? ~0ULL : 0;
+
+    const Word32 *w = base + p.word;
+
+    std::size_t n = count & ~std::size_t(63);
+
+    for (std::size_t i = 0; i < n; i += 64)
+      {
+        unsigned long long bits = 0;
+
+        for (unsigned j = 0; j < 64; j += 8, w += 8 * stride)
+          {
+            __m256i v =
+              _mm256_srl_epi32(
+                _mm256_sll_epi32(avx2_load8(w, stride, idx), ls0), rs0);
+
+            if (p.straddle)
+              v = _mm256_or_si256(
+                    v,
+                    _mm256_srl_epi32(
+                      _mm256_sll_epi32(avx2_load8(w + 1, stride, idx), ls1),
+                      rs1));
+
+            // Unsigned x <= span .
+            __m256i x = _mm256_sub_epi32(_mm256_and_si256(v, m), lo);
+
+            __m256i c = _mm256_cmpeq_epi32(_mm256_min_epu32(x, span), x);
+
+            bits |=
+              (unsigned long long)(
+                unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(c)))) << j;
+          }
+
+        bits ^= inv;
+
+        bitmap[i / 64] = bits;
+
+        selected += popcount64(bits);
+      }
+
+    return(n);
+  }
+
+BITFIELD_BULK_AVX2
+inline std::size_t avx2_select(
+  const Word64 *base, std::size_t stride, std::size_t count,
+  const Plan &p, const Select &s, unsigned long long *bitmap,
+  std::size_t &selected)
+  {
+    const __m128i idx =
+      _mm_mullo_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(int(stride)));
+
+    const __m128i ls0 = _mm_cvtsi32_si128(int(p.ls[0]));
+    const __m128i rs0 = _mm_cvtsi32_si128(int(p.rs[0]));
+    const __m128i ls1 = _mm_cvtsi32_si128(int(p.ls[1]));
+    const __m128i rs1 = _mm_cvtsi32_si128(int(p.rs[1]));
+
+    const __m256i m = _mm256_set1_epi64x((long long)(p.vmask & s.mask));
+    const __m256i lo = _mm256_set1_epi64x((long long)(s.lo));
+
+    // There is no unsigned 64-bit compare, so compare with the sign bits
+    // flipped.
+    const __m256i sign = _mm256_set1_epi64x((long long)(1ULL << 63));
+    const __m256i span =
+      _mm256_xor_si256(_mm256_set1_epi64x((long long)(s.span)), sign);
+
+    // Bits are set for records where x > span .
+    const unsigned long long inv = s.invert ? 0 : ~0ULL;
+
+    const Word64 *w = base + p.word;
+
+    std::size_t n = count & ~std::size_t(63);
+
+    for (std::size_t i = 0; i < n; i += 64)
+      {
+        unsigned long long bits = 0;
+
+        for (unsigned j = 0; j < 64; j += 4, w += 4 * stride)
+          {
+            __m256i v =
+              _mm256_srl_epi64(
+                _mm256_sll_epi64(avx2_load4(w, stride, idx), ls0), rs0);
+
+            if (p.straddle)
+              v = _mm256_or_si256(
+                    v,
+                    _mm256_srl_epi64(
+                      _mm256_sll_epi64(avx2_load4(w + 1, stride, idx), ls1),
+                      rs1));
+
+            __m256i x = _mm256_sub_epi64(_mm256_and_si256(v, m), lo);
+
+            __m256i c =
+              _mm256_cmpgt_epi64(_mm256_xor_si256(x, sign), span);
+
+            bits |=
+              (unsigned long long)(
+                unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(c)))) << j;
+          }
+
+        bits ^= inv;
+
+        bitmap[i / 64] = bits;
+
+        selected += popcount64(bits);
+      }
+
+    return(n);
+  }
+
+#endif // BITFIELD_BULK_X86
+
+// The kernels load and store storage locations directly, rather than
+// through Storage_access_t , so they are only used when Access is the
+// storage access type of Bitfield_traits_default (Default_access) or
+// Bitfield_plain_memory_access .
+template <class Access, class Default_access>
+struct Direct_access { static const bool Value = false; };
+
+template <class Access>
+struct Direct_access<Access, Access> { static const bool Value = true; };
+
+template <typename S_t, class Default_access>
+struct Direct_access<Bitfield_plain_memory_access<S_t>, Default_access>
+  { static const bool Value = true; };
+
+// Selects the kernel word type from the size of the value and storage
+// types.  Word is void if there are no kernels for the sizes.
+template <unsigned Value_size, unsigned Storage_size>
+struct Kernel_word { typedef void Word; };
+
+template <>
+struct Kernel_word<4, 4> { typedef unsigned Word; };
+
+template <>
+struct Kernel_word<8, 8> { typedef unsigned long long Word; };
+
+// The unsigned type with the given size, for predicate arithmetic with
+// a signed value type.
+template <unsigned Size>
+struct Unsigned;
+
+template <>
+struct Unsigned<1> { typedef unsigned char Type; };
+
+template <>
+struct Unsigned<2> { typedef unsigned short Type; };
+
+template <>
+struct Unsigned<4> { typedef unsigned Type; };
+
+template <>
+struct Unsigned<8> { typedef unsigned long long Type; };
+
+template <typename Word>
+struct Kernels
+  {
+    static const bool Enabled = false;
+
+    template <typename Storage_t, typename Value_t>
+    static std::size_t read(
+      Bitfield_bulk_isa, const Storage_t *, std::size_t, std::size_t,
+      const Plan &, Value_t *)
+      { return(0); }
+
+    template <typename Storage_t, typename Value_t>
+    static std::size_t write(
+      Bitfield_bulk_isa, Storage_t *, std::size_t, std::size_t, const Plan &,
+      const Value_t *)
+      { return(0); }
+
+    template <typename Storage_t>
+    static std::size_t select(
+      Bitfield_bulk_isa, const Storage_t *, std::size_t, std::size_t,
+      const Plan &, const Select &, unsigned long long *, std::size_t &)
+      { return(0); }
+  };
+
+#if BITFIELD_BULK_X86
+
+template <typename Word>
+struct Word_kernels
+  {
+    static const bool Enabled = true;
+
+    typedef typename Alias<Word>::Type A;
+
+    template <typename Storage_t, typename Value_t>
+    static std::size_t read(
+      Bitfield_bulk_isa i, const Storage_t *base, std::size_t stride,
+      std::size_t count, const Plan &p, Value_t *values)
+      {
+        const A *b = reinterpret_cast<const A *>(base);
+        A *v = reinterpret_cast<A *>(values);
+
+        if (i == Bitfield_bulk_avx2)
+          return(avx2_read(b, stride, count, p, v));
+
+        if (i == Bitfield_bulk_sse41)
+          return(sse41_read(b, stride, count, p, v));
+
+        return(0);
+      }
+
+    template <typename Storage_t, typename Value_t>
+    static std::size_t write(
+      Bitfield_bulk_isa i, Storage_t *base, std::size_t stride,
+      std::size_t count, const Plan &p, const Value_t *values)
+      {
+        A *b = reinterpret_cast<A *>(base);
+        const A *v = reinterpret_cast<const A *>(values);
+
+        if (i == Bitfield_bulk_avx2)
+          return(avx2_write(b, stride, count, p, v));
+
+        if (i == Bitfield_bulk_sse41)
+          return(sse41_write(b, stride, count, p, v));
+
+        return(0);
+      }
+
+    // AVX2 only.
+    template <typename Storage_t>
+    static std::size_t select(
+      Bitfield_bulk_isa i, const Storage_t *base, std::size_t stride,
+      std::size_t count, const Plan &p, const Select &s,
+      unsigned long long *bitmap, std::size_t &selected)
+      {
+        const A *b = reinterpret_cast<const A *>(base);
+
+        if (i == Bitfield_bulk_avx2)
+          return(avx2_select(b, stride, count, p, s, bitmap, selected));
+
+        return(0);
+      }
+  };
+
+template <>
+struct Kernels<unsigned> : public Word_kernels<unsigned> { };
+
+template <>
+struct Kernels<unsigned long long>
+  : public Word_kernels<unsigned long long> { };
+
+#endif // BITFIELD_BULK_X86
+
+} // namespace Bitfield_bulk_impl
+
+// The Bitfield parameter must be an instantiation of the Bitfield class
+// template, whose Storage_access_t can be constructed from a pointer to
+// Storage_t (as with Bitfield_traits_default).  The kernels are only used
+// with the storage access types of Bitfield_traits_default and
+// Bitfield_traits_plain_memory; with others (such as
+// Bitfield_byte_swap_access), Bf is used for each record.  first_bit and
+// field_width are as for Bitfield::fn() , relative to each record.
+// stride is the number of storage locations from the start of one record
+// to the start of the next.  The optional max_isa parameter limits the
+// instruction set used (mainly for testing and benchmarking).
+template <class Bitfield>
+class Bitfield_bulk
+  {
+  public:
+
+    typedef typename Bitfield::Value_t Value_t;
+
+    typedef typename Bitfield::Storage_t Storage_t;
+
+    // A test of the value of a bit field, for select() .  Comparisons
+    // are of Value_t values, signed or not.
+    class Predicate
+      {
+      public:
+
+        // v == k
+        static Predicate eq(Value_t k) { return(Predicate(All, k, 0, false)); }
+
+        // v != k
+        static Predicate ne(Value_t k) { return(Predicate(All, k, 0, true)); }
+
+        // v < k
+        static Predicate lt(Value_t k)
+          {
+            return(k == Min ? never() :
+                   Predicate(All, Min, U(U(k) - U(Min) - 1), false));
+          }
+
+        // lo <= v <= hi
+        static Predicate range(Value_t lo, Value_t hi)
+          {
+            return(lo > hi ? never() :
+                   Predicate(All, lo, U(U(hi) - U(lo)), false));
+          }
+
+        // (v & m) == k
+        static Predicate mask_test(Value_t m, Value_t k)
+          { return(Predicate(m, k, 0, false)); }
+
+        bool operator () (Value_t v) const
+          { return((U(U(U(v) & mask) - lo) <= span) != invert); }
+
+      private:
+
+        friend class Bitfield_bulk;
+
+        // The arithmetic is unsigned, so wraps around for a signed
+        // Value_t too.
+        typedef typename Bitfield_bulk_impl::Unsigned<sizeof(Value_t)>::Type
+          U;
+
+        static const U All = U(~U(0));
+
+        // The least value of Value_t (its sign bit only if signed).
+        static const Value_t Min =
+          Value_t(Value_t(~Value_t(0)) < Value_t(0) ?
+                  U(1) << ((sizeof(Value_t) * CHAR_BIT) - 1) : 0);
+
+        U mask, lo, span;
+
+        bool invert;
+
+        Predicate(U mask_, U lo_, U span_, bool invert_)
+          : mask(mask_), lo(lo_), span(span_), invert(invert_)
+          { }
+
+        // (0 - 1) is never <= 0 .
+        static Predicate never() { return(Predicate(0, 1, 0, false)); }
+      };
+
+    // Reads the bit field from each of count records into values.
+    // values[i] is the same as what Bitfield::Bf::read() would return for
+    // the record at base + (i * stride) .
+    static void read(
+      const Storage_t *base, std::size_t stride, std::size_t count,
+      unsigned first_bit, unsigned field_width, Value_t *values,
+      Bitfield_bulk_isa max_isa = Bitfield_bulk_avx2)
+      {
+        if (count == 0)
+          return;
+
+        std::size_t i = 0;
+
+        if (Bitfield::fn(storage(base), first_bit, field_width).
+              is_width_invalid())
+          {
+            // Let Bf report the error (once), and return the same value.
+            Value_t v = Bitfield::fn(storage(base), first_bit, field_width);
+
+            for ( ; i < count; ++i)
+              values[i] = v;
+
+            return;
+          }
+
+        if (use_kernels(stride))
+          i = Kernels::read(
+                Bitfield_bulk_impl::isa(max_isa), base, stride, count,
+                make_plan(first_bit, field_width), values);
+
+        for ( ; i < count; ++i)
+          values[i] =
+            Bitfield::fn(storage(base + (i * stride)), first_bit, field_width);
+      }
+
+    // Writes values[i] into the bit field of the record at
+    // base + (i * stride) , for i from 0 to count - 1 .  If any value is
+    // too big for the field, the error is reported (once) as by
+    // Bitfield::Bf::write() , nothing is written, and false is returned.
+    static bool write(
+      Storage_t *base, std::size_t stride, std::size_t count,
+      unsigned first_bit, unsigned field_width, const Value_t *values,
+      Bitfield_bulk_isa max_isa = Bitfield_bulk_avx2)
+      {
+        if (count == 0)
+          return(true);
+
+        if (field_width < Bitfield_impl::Num_bits<Value_t>::Value)
+          {
+            Value_t all = 0;
+
+            for (std::size_t i = 0; i < count; ++i)
+              all |= values[i];
+
+            if (all > Bitfield_impl::mask<Value_t>(field_width))
+              {
+                std::size_t i = 0;
+
+                while (values[i] <= Bitfield_impl::mask<Value_t>(field_width))
+                  ++i;
+
+                // Bf reports the error (without writing).
+                return(
+                  Bitfield::fn(base + (i * stride), first_bit, field_width).
+                    write(values[i]));
+              }
+          }
+
+        return(write_nvc(
+                 base, stride, count, first_bit, field_width, values,
+                 max_isa));
+      }
+
+    // Like write(), but like Bitfield::Bf::write_nvc() , the values are
+    // not checked.
+    static bool write_nvc(
+      Storage_t *base, std::size_t stride, std::size_t count,
+      unsigned first_bit, unsigned field_width, const Value_t *values,
+      Bitfield_bulk_isa max_isa = Bitfield_bulk_avx2)
+      {
+        if (count == 0)
+          return(true);
+
+        // Let Bf report an invalid width.
+        if (Bitfield::fn(base, first_bit, field_width).is_width_invalid())
+          return(Bitfield::fn(base, first_bit, field_width).write_nvc(0));
+
+        std::size_t i = 0;
+
+        if (use_kernels(stride))
+          {
+            Bitfield_bulk_impl::Plan p = make_plan(first_bit, field_width);
+
+            // Records must not share storage locations.
+            if ((p.word + (p.straddle ? 2 : 1)) <= stride)
+              i = Kernels::write(
+                    Bitfield_bulk_impl::isa(max_isa), base, stride, count, p,
+                    values);
+          }
+
+        for ( ; i < count; ++i)
+          Bitfield::fn(base + (i * stride), first_bit, field_width).
+            write_nvc(values[i]);
+
+        return(true);
+      }
+
+    // Tests the bit field of the record at base + (i * stride) , for i
+    // from 0 to count - 1 , setting bit (i % 64) of bitmap[i / 64] if
+    // pred is true for its value and clearing it if not.  The bits of the
+    // last bitmap word past count are cleared.  Returns the number of
+    // records selected.
+    static std::size_t select(
+      const Storage_t *base, std::size_t stride, std::size_t count,
+      unsigned first_bit, unsigned field_width, const Predicate &pred,
+      unsigned long long *bitmap,
+      Bitfield_bulk_isa max_isa = Bitfield_bulk_avx2)
+      {
+        if (count == 0)
+          return(0);
+
+        std::size_t i = 0, selected = 0;
+
+        if (Bitfield::fn(storage(base), first_bit, field_width).
+              is_width_invalid())
+          {
+            // Let Bf report the error (once), and test the same value.
+            const bool b =
+              pred(Bitfield::fn(storage(base), first_bit, field_width));
+
+            for ( ; i < count; i += 64)
+              bitmap[i / 64] =
+                b ? (~0ULL >> (i + 64 > count ? i + 64 - count : 0)) : 0;
+
+            return(b ? count : 0);
+          }
+
+        if (use_kernels(stride))
+          {
+            Bitfield_bulk_impl::Select s;
+
+            s.mask = pred.mask;
+            s.lo = pred.lo;
+            s.span = pred.span;
+            s.invert = pred.invert;
+
+            i = Kernels::select(
+                  Bitfield_bulk_impl::isa(max_isa), base, stride, count,
+                  make_plan(first_bit, field_width), s, bitmap, selected);
+          }
+
+        for ( ; i < count; i += 64)
+          {
+            const std::size_t end = (i + 64) < count ? (i + 64) : count;
+
+            unsigned long long bits = 0;
+
+            for (std::size_t j = i; j < end; ++j)
+              if (pred(Bitfield::fn(
+                         storage(base + (j * stride)), first_bit,
+                         field_width)))
+                bits |= 1ULL << (j - i);
+
+            bitmap[i / 64] = bits;
+
+            selected += Bitfield_bulk_impl::popcount64(bits);
+          }
+
+        return(selected);
+      }
+
+    // Like select() , but writes the indexes of the records selected, in
+    // increasing order, into indexes.  Returns the number of indexes.
+    static std::size_t select_indexes(
+      const Storage_t *base, std::size_t stride, std::size_t count,
+      unsigned first_bit, unsigned field_width, const Predicate &pred,
+      std::size_t *indexes, Bitfield_bulk_isa max_isa = Bitfield_bulk_avx2)
+      {
+        if (count == 0)
+          return(0);
+
+        if (Bitfield::fn(storage(base), first_bit, field_width).
+              is_width_invalid())
+          {
+            // Let Bf report the error (once), and test the same value.
+            if (!pred(Bitfield::fn(storage(base), first_bit, field_width)))
+              return(0);
+
+            for (std::size_t i = 0; i < count; ++i)
+              indexes[i] = i;
+
+            return(count);
+          }
+
+        // Records per call of select() .
+        const std::size_t Chunk = 64 * 64;
+
+        unsigned long long bitmap[Chunk / 64];
+
+        std::size_t n = 0;
+
+        for (std::size_t i = 0; i < count; i += Chunk)
+          {
+            const std::size_t c = (count - i) < Chunk ? (count - i) : Chunk;
+
+            if (select(
+                  base + (i * stride), stride, c, first_bit, field_width, pred,
+                  bitmap, max_isa) == 0)
+              continue;
+
+            for (std::size_t k = 0; k < ((c + 63) / 64); ++k)
+              for (unsigned long long b = bitmap[k]; b; b &= b - 1)
+                indexes[n++] = i + (k * 64) + Bitfield_bulk_impl::ctz64(b);
+          }
+
+        return(n);
+      }
+
+  private:
+
+    typedef typename Bitfield_bulk_impl::Kernel_word<
+        sizeof(Value_t), sizeof(Storage_t)>::Word
+      Word;
+
+    typedef Bitfield_bulk_impl::Kernels<Word> Kernels;
+
+    static const bool Direct =
+      Bitfield_bulk_impl::Direct_access<
+        typename Bitfield::Storage_access_t,
+        typename Bitfield_traits_default<Value_t, Storage_t>::
+          Storage_access_t>::Value;
+
+    static const unsigned Storage_bits = Bitfield::Storage_bits;
+
+    static Storage_t * storage(const Storage_t *p)
+      { return(const_cast<Storage_t *>(p)); }
+
+    // Vector gather indexes are 32-bit signed integers.  (A plan is only
+    // valid for a field in at most two storage locations, which is so
+    // when there are kernels for the value and storage types.)
+    static bool use_kernels(std::size_t stride)
+      {
+        return(Kernels::Enabled && Direct && (stride != 0) &&
+               (stride <= (0x7fffffff / 8)));
+      }
+
+    static Bitfield_bulk_impl::Plan make_plan(
+      unsigned first_bit, unsigned field_width)
+      {
+        return(
+          Bitfield_bulk_impl::plan(
+            Storage_bits, Bitfield::Storage_ls_bit_first, first_bit,
+            field_width));
+      }
+
+  }; // end class Bitfield_bulk
+
+#endif // Include once.
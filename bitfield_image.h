@@ -0,0 +1,244 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// A register or record image, laid out by a Bitfield_format, that is
+// composed from bit field values at compile time (C++14 or later).
+// Instead of writing each bit field of a zeroed Define<Format>::T array
+// at run time, the image is built as a constant:
+//
+//   struct Fmt : public Bitfield_format { F<4> mode; F<12> count; ... };
+//   typedef Bitfield_w_fmt<Bitfield<Traits>, Fmt> Bwf;
+//
+//   constexpr Bitfield_image<Bwf> Init =
+//     Bitfield_image<Bwf>().set(&Fmt::mode, 3).set(&Fmt::count, 100).
+//       set(BITF_FIELD(Bwf, x.c), 5);
+//
+// A bit field is specified by a pointer to member of the format (or of
+// a base of it), or by a Bwf::Field (BITF_FIELD) for a field that is a
+// member of a member or an array element.  The image has a word and a
+// mask (of the bits that are in a set bit field) for each storage
+// location of the format.  At run time:
+//
+//   Init.store(base)
+//     Writes the whole image (with write_block() , if Bwf::Storage_access_t
+//     has it).  Bits not in a set bit field are zero.
+//
+//   Init.apply(base)
+//     Changes only the bits in a set bit field.  A storage location with
+//     no bits set is not accessed, one whose bits are all set is written,
+//     and any other is read, masked and written.
+//
+// When the image is a constant, a value that does not fit in its bit
+// field (or a bit field with a width of zero or more than the bits in
+// Bwf::Value_t) is a compile error (a call to the function that is not
+// constexpr , value_too_big() or field_too_wide() ).  If the image is
+// built at run time, such values are truncated, and such bit fields
+// ignored.
+
+#ifndef BITFIELD_IMAGE_H_20160428
+#define BITFIELD_IMAGE_H_20160428
+
+#include "bitfield.h"
+
+#if __cplusplus < 201402L
+#error bitfield_image.h requires C++14 or later
+#endif
+
+template <class Bwf>
+class Bitfield_image
+  {
+  public:
+
+    typedef typename Bwf::Value_t Value_t;
+
+    typedef typename Bitfield_impl::Remove_cv<typename Bwf::Storage_t>::Type
+      Storage_t;
+
+    typedef typename Bwf::Storage_access_t Storage_access_t;
+
+    typedef typename Bwf::Field Field;
+
+    typedef typename Bwf::Format Format;
+
+    static const unsigned Dimension =
+      Bwf::template Define<Format>::Dimension;
+
+    constexpr Bitfield_image() : w(), m() { }
+
+    // Returns a copy of this image with the bit field set to v .
+    constexpr Bitfield_image set(Field f, Value_t v) const
+      {
+        Bitfield_image i(*this);
+
+        i.put(f.first_bit, f.field_width, v);
+
+        return(i);
+      }
+
+    template <class Fmt, typename Mbr_type>
+    constexpr Bitfield_image set(Mbr_type Fmt::*field, Value_t v) const
+      {
+        return(set(field_of(static_cast<Mbr_type Format::*>(field)), v));
+      }
+
+    constexpr Storage_t word(unsigned i) const { return(w[i]); }
+
+    constexpr Storage_t mask(unsigned i) const { return(m[i]); }
+
+    // The whole image, Dimension storage locations.
+    constexpr const Storage_t * words() const { return(w); }
+
+    void store(Storage_access_t base) const
+      {
+        Bitfield_impl::Block_transfer<Storage_access_t>::write(
+          base, 0, Dimension, w);
+      }
+
+    void apply(Storage_access_t base) const
+      { Apply<0, (Dimension > 0)>::x(*this, base); }
+
+  private:
+
+    static const unsigned Storage_bits = Bwf::Storage_bits;
+
+    static const unsigned Value_bits =
+      Bitfield_impl::Num_bits<Value_t>::Value;
+
+    Storage_t w[Dimension], m[Dimension];
+
+    // Not constexpr , so that calling them while building a constant
+    // image is a compile error.
+    static void value_too_big(Value_t, unsigned) { }
+    static void field_too_wide(unsigned) { }
+
+    template <typename U>
+    static constexpr U low_bits(unsigned n)
+      {
+        return(
+          n >= Bitfield_impl::Num_bits<U>::Value ?
+            U(~U(0)) : U((U(1) << n) - 1));
+      }
+
+    template <typename Mbr_type>
+    static constexpr Field field_of(Mbr_type Format::*field)
+      {
+        return(Field(Bwf::field_offset(field), Bwf::field_width(field)));
+      }
+
+    // Sets the bits of the field in the words w and the mask m .  With
+    // Storage_ls_bit_first, the first storage location has the least
+    // significant bits of the value, otherwise the most significant.
+    constexpr void put(unsigned first_bit, unsigned width, Value_t v)
+      {
+        if ((width == 0) || (width > Value_bits))
+          {
+            field_too_wide(width);
+            return;
+          }
+
+        if (v & ~low_bits<Value_t>(width))
+          {
+            value_too_big(v, width);
+            v &= low_bits<Value_t>(width);
+          }
+
+        unsigned bit = first_bit, rem = width;
+
+        while (rem != 0)
+          {
+            const unsigned i = bit / Storage_bits, ofs = bit % Storage_bits;
+
+            const unsigned n =
+              rem < (Storage_bits - ofs) ? rem : Storage_bits - ofs;
+
+            const unsigned shift =
+              Bwf::Storage_ls_bit_first ? ofs : Storage_bits - ofs - n;
+
+            const Value_t piece =
+              Bwf::Storage_ls_bit_first ?
+                v >> (width - rem) : v >> (rem - n);
+
+            const Storage_t pm =
+              Storage_t(low_bits<Storage_t>(n) << shift);
+
+            w[i] = Storage_t(
+              (w[i] & ~pm) |
+              (Storage_t(Storage_t(piece) << shift) & pm));
+            m[i] = Storage_t(m[i] | pm);
+
+            bit += n;
+            rem -= n;
+          }
+      }
+
+    void apply(Storage_access_t base, unsigned i) const
+      {
+        if (m[i] == Storage_t(~Storage_t(0)))
+          {
+            base += i;
+            base.write(w[i]);
+          }
+        else if (m[i] != 0)
+          {
+            base += i;
+
+            Put_mod pm(m[i], w[i]);
+
+            Bitfield_impl::Storage_ops<Storage_access_t>::modify(base, pm, 0);
+          }
+      }
+
+    // Unrolled, so that with optimization the storage locations that are
+    // not changed are dropped, when the image is a constant.
+    template <unsigned I, bool More>
+    struct Apply
+      {
+        static void x(const Bitfield_image &img, Storage_access_t base)
+          {
+            img.apply(base, I);
+
+            Apply<I + 1, (I + 1 < Dimension)>::x(img, base);
+          }
+      };
+
+    template <unsigned I>
+    struct Apply<I, false>
+      {
+        static void x(const Bitfield_image &, Storage_access_t) { }
+      };
+
+    // Sets the bits m of a storage location to b .
+    class Put_mod
+      {
+      public:
+
+        Put_mod(Storage_t m_, Storage_t b_) : pm(m_), b(b_) { }
+
+        template <class Piece>
+        void operator () (Storage_access_t s, Piece)
+          { s.write(static_cast<Storage_t>((s.read() & ~pm) | b)); }
+
+      private:
+
+        Storage_t pm, b;
+      };
+
+  }; // end class Bitfield_image
+
+#endif // Include once.
@@ -0,0 +1,455 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Bit fields in a file mapped into memory (POSIX mmap), so that files of
+// bit-packed records are accessed in place, without reading them into
+// buffers.  Bitfield_mmap_file maps a region of a file, read-only or
+// read-write.  Since the mapping is ordinary memory, its storage access
+// type is Bitfield_plain_memory_access (with the wide path for bit fields
+// that straddle storage locations), and Bitfield_traits_mmap has
+// Bit_offset_t std::size_t , for offsets past 65535 bits.  For example:
+//
+//   typedef Bitfield<Bitfield_traits_mmap<uint64_t, uint8_t> > Bf;
+//   typedef Bitfield_w_fmt<Bf, Fmt> Bwf;
+//
+//   Bitfield_mmap_file f;
+//   if (!f.open("recs.bin", Bitfield_mmap_file::Read_only))
+//     ... f.error() ...
+//   f.advise(Bitfield_mmap_file::Sequential);
+//
+//   Bitfield_mmap_records<Bwf> recs(f);
+//   for (Bitfield_mmap_records<Bwf>::iterator i = recs.begin();
+//        i != recs.end(); ++i)
+//     sum += BITF_W_OFS(Bwf, i->base(), data, i->offset());
+//
+// With a read-write mapping, bit field writes change the page cache
+// directly.  sync() writes changed pages to the file (msync).  Writing to
+// a read-only mapping is a segmentation violation.
+
+#ifndef BITFIELD_MMAP_H_20160428
+#define BITFIELD_MMAP_H_20160428
+
+#include "bitfield.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+template <typename V_t = unsigned, typename S_t = V_t>
+class Bitfield_traits_mmap : public Bitfield_traits_plain_memory<V_t, S_t>
+  {
+  public:
+
+    typedef std::size_t Bit_offset_t;
+
+  }; // class Bitfield_traits_mmap
+
+class Bitfield_mmap_file
+  {
+  public:
+
+    // Flags for open() .
+    enum
+      {
+        Read_only = 0,
+
+        Read_write = 1,
+
+        // Create the file if it does not exist, and extend it to the end
+        // of the region (so the region's length cannot be 0).  Implies
+        // Read_write.
+        Create = 2,
+
+        // Align the mapping to Huge_page_size, and ask for transparent
+        // huge pages (where the system and file system support them).
+        Huge_pages = 4
+      };
+
+    // Access pattern hints for advise() .
+    enum Advice
+      {
+        Normal = MADV_NORMAL,
+        Sequential = MADV_SEQUENTIAL,
+        Random = MADV_RANDOM,
+        Will_need = MADV_WILLNEED,
+        Dont_need = MADV_DONTNEED
+      };
+
+    static const std::size_t Huge_page_size = std::size_t(1) << 21;
+
+    Bitfield_mmap_file() : region(0), len(0), map(0), map_len(0), rsv(0),
+      rsv_len(0)
+      { }
+
+    ~Bitfield_mmap_file() { close(); }
+
+    // Maps length bytes of the file at path, starting at byte offset .  If
+    // length is 0, the region is the rest of the file.  Without Create,
+    // the region must be within the file.  offset should be
+    // a multiple of the size of the storage locations accessed.  Returns
+    // false (with a message from error() ) if it fails.
+    bool open(
+      const char *path, unsigned flags = Read_only, std::size_t offset = 0,
+      std::size_t length = 0)
+      {
+        close();
+
+        const bool write = (flags & (Read_write | Create)) != 0;
+
+        int fd =
+          ::open(
+            path,
+            (write ? O_RDWR : O_RDONLY) | ((flags & Create) ? O_CREAT : 0),
+            0666);
+
+        if (fd < 0)
+          return(fail("open"));
+
+        struct stat st;
+
+        if (fstat(fd, &st) != 0)
+          return(fail_close("fstat", fd));
+
+        const std::size_t file_size = std::size_t(st.st_size);
+
+        if ((flags & Create) && (length != 0) &&
+            (file_size < (offset + length)) &&
+            (ftruncate(fd, off_t(offset + length)) != 0))
+          return(fail_close("ftruncate", fd));
+
+        if (length == 0)
+          {
+            if (file_size <= offset)
+              {
+                ::close(fd);
+                err = "open: empty region";
+                return(false);
+              }
+
+            length = file_size - offset;
+          }
+        else if (!(flags & Create) &&
+                 ((offset > file_size) || (length > (file_size - offset))))
+          {
+            // Accessing past the end of the file would be a bus error.
+            ::close(fd);
+            err = "open: region past end of file";
+            return(false);
+          }
+
+        const std::size_t page = std::size_t(sysconf(_SC_PAGESIZE));
+
+        const std::size_t lead = offset % page;
+
+        map_len = lead + length;
+
+        const int prot = PROT_READ | (write ? PROT_WRITE : 0);
+
+        void *p;
+
+        if (flags & Huge_pages)
+          {
+            // Reserve enough address space for an aligned mapping, then
+            // map the file over it.
+            rsv_len = map_len + Huge_page_size;
+
+            void *r = mmap(0, rsv_len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS,
+                           -1, 0);
+
+            if (r == MAP_FAILED)
+              {
+                rsv_len = 0;
+                return(fail_close("mmap", fd));
+              }
+
+            rsv = static_cast<char *>(r);
+
+            char *a =
+              rsv + ((Huge_page_size -
+                      (reinterpret_cast<std::size_t>(rsv) % Huge_page_size)) %
+                     Huge_page_size);
+
+            p = mmap(a, map_len, prot, MAP_SHARED | MAP_FIXED, fd,
+                     off_t(offset - lead));
+          }
+        else
+          p = mmap(0, map_len, prot, MAP_SHARED, fd, off_t(offset - lead));
+
+        ::close(fd);
+
+        if (p == MAP_FAILED)
+          {
+            fail("mmap");
+            close();
+            return(false);
+          }
+
+        map = static_cast<char *>(p);
+        region = map + lead;
+        len = length;
+
+        #ifdef MADV_HUGEPAGE
+
+        if (flags & Huge_pages)
+          madvise(map, map_len, MADV_HUGEPAGE);
+
+        #endif
+
+        return(true);
+      }
+
+    void close()
+      {
+        if (rsv_len != 0)
+          munmap(rsv, rsv_len);
+        else if (map)
+          munmap(map, map_len);
+
+        region = map = 0;
+        len = map_len = rsv_len = 0;
+      }
+
+    bool is_open() const { return(region != 0); }
+
+    // The mapped region.
+    void * data() const { return(region); }
+
+    std::size_t size() const { return(len); }
+
+    // Hints the access pattern for length bytes at offset in the region
+    // (to the end of the region if length is 0).
+    bool advise(Advice a, std::size_t offset = 0, std::size_t length = 0)
+      {
+        return(
+          range(offset, length) &&
+          ((madvise(map + offset, length, a) == 0) || fail("madvise")));
+      }
+
+    // Writes the changed pages in length bytes at offset in the region (to
+    // the end of the region if length is 0) to the file.  If wait is
+    // false, the writes are only started.
+    bool sync(std::size_t offset = 0, std::size_t length = 0, bool wait = true)
+      {
+        return(
+          range(offset, length) &&
+          ((msync(map + offset, length, wait ? MS_SYNC : MS_ASYNC) == 0) ||
+           fail("msync")));
+      }
+
+    // Message for the last error.
+    const std::string & error() const { return(err); }
+
+  private:
+
+    // Start of the region, and its length.
+    char *region;
+
+    std::size_t len;
+
+    // Start of the mapping (page aligned), and its length.
+    char *map;
+
+    std::size_t map_len;
+
+    // Reserved address space (if Huge_pages), and its length (0 if none).
+    char *rsv;
+
+    std::size_t rsv_len;
+
+    std::string err;
+
+    // Not copyable.
+    Bitfield_mmap_file(const Bitfield_mmap_file &);
+    Bitfield_mmap_file & operator = (const Bitfield_mmap_file &);
+
+    bool fail(const char *what)
+      {
+        err = std::string(what) + ": " + std::strerror(errno);
+
+        return(false);
+      }
+
+    bool fail_close(const char *what, int fd)
+      {
+        fail(what);
+
+        ::close(fd);
+
+        return(false);
+      }
+
+    // Changes offset and length in the region to offset and length in the
+    // mapping (from the start of the page containing offset).
+    bool range(std::size_t &offset, std::size_t &length)
+      {
+        if (!is_open() || (offset > len))
+          {
+            err = "range not in region";
+            return(false);
+          }
+
+        if ((length == 0) || (length > (len - offset)))
+          length = len - offset;
+
+        offset += region - map;
+
+        const std::size_t page = std::size_t(sysconf(_SC_PAGESIZE));
+
+        length += offset % page;
+        offset -= offset % page;
+
+        return(true);
+      }
+
+  }; // end class Bitfield_mmap_file
+
+// The records in a Bitfield_mmap_file , each laid out by Bwf::Format ,
+// starting at bit first_bit of the region, with stride bits from the
+// start of one record to the start of the next.  The default stride is
+// the size of the format (no padding between records).  Bwf::Storage_t
+// must be the type of the storage locations of the file, and
+// Bwf::Storage_access_t must be constructible from a pointer to it (as
+// with Bitfield_traits_mmap).
+template <class Bwf>
+class Bitfield_mmap_records
+  {
+  public:
+
+    typedef typename Bwf::Storage_t Storage_t;
+
+    typedef typename Bwf::Bit_offset_t Bit_offset_t;
+
+    static const unsigned Storage_bits = Bwf::Storage_bits;
+
+    // A record.  base() is the storage location containing its first bit,
+    // and offset() is the offset of the first bit in it (always 0 if the
+    // stride and first_bit are multiples of Storage_bits).  Use with the
+    // BITF_W_OFS macros, or field() .
+    class Record
+      {
+      public:
+
+        Record(Storage_t *base_, unsigned offset_)
+          : b(base_), ofs(offset_)
+          { }
+
+        Storage_t * base() const { return(b); }
+
+        unsigned offset() const { return(ofs); }
+
+        // The bit field in this record.  The offset of f is from the start
+        // of the record, without alignment (BITF_OFFSET_UNALIGNED, not
+        // BITF_FIELD).
+        typename Bwf::Bf field(const typename Bwf::Field &f) const
+          { return(Bwf::fn(b, ofs + f.first_bit, f.field_width)); }
+
+      private:
+
+        Storage_t *b;
+
+        unsigned ofs;
+      };
+
+    class iterator
+      {
+      public:
+
+        iterator(const Bitfield_mmap_records &r_, std::size_t i_)
+          : r(&r_), i(i_), rec(r_[i_])
+          { }
+
+        const Record & operator * () const { return(rec); }
+
+        const Record * operator -> () const { return(&rec); }
+
+        iterator & operator ++ ()
+          {
+            ++i;
+            rec = (*r)[i];
+            return(*this);
+          }
+
+        bool operator == (const iterator &x) const { return(i == x.i); }
+
+        bool operator != (const iterator &x) const { return(i != x.i); }
+
+        std::size_t index() const { return(i); }
+
+      private:
+
+        const Bitfield_mmap_records *r;
+
+        std::size_t i;
+
+        Record rec;
+      };
+
+    explicit Bitfield_mmap_records(
+      const Bitfield_mmap_file &f,
+      std::size_t stride_ = sizeof(typename Bwf::Format),
+      std::size_t first_bit_ = 0)
+      : data(static_cast<Storage_t *>(f.data())), stride(stride_),
+        first_bit(first_bit_),
+        num(count(f.size() * CHAR_BIT, stride_, first_bit_))
+      { }
+
+    // Number of whole records in the region.
+    std::size_t size() const { return(num); }
+
+    Record operator [] (std::size_t i) const
+      {
+        const std::size_t bit = first_bit + (i * stride);
+
+        return(
+          Record(data + (bit / Storage_bits), unsigned(bit % Storage_bits)));
+      }
+
+    iterator begin() const { return(iterator(*this, 0)); }
+
+    iterator end() const { return(iterator(*this, num)); }
+
+  private:
+
+    Storage_t *data;
+
+    std::size_t stride, first_bit, num;
+
+    // The number of records that end in a region of the given size.
+    static std::size_t count(
+      std::size_t bits, std::size_t stride, std::size_t first_bit)
+      {
+        const std::size_t Format_bits = sizeof(typename Bwf::Format);
+
+        if ((stride == 0) || (first_bit > bits) ||
+            ((bits - first_bit) < Format_bits))
+          return(0);
+
+        return(((bits - first_bit - Format_bits) / stride) + 1);
+      }
+
+  }; // end class Bitfield_mmap_records
+
+#endif // Include once.
@@ -0,0 +1,172 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Conversion of a whole record, laid out by a Bitfield_format, to and
+// from a plain struct with a member for each bit field.  The mapping from
+// the bit fields of the format to the members of the struct is declared
+// once, as a list macro, for example:
+//
+//   struct Fmt : public Bitfield_format { F<4> mode; F<12> count; ... };
+//   typedef Bitfield_w_fmt<Bitfield<Traits>, Fmt> Bwf;
+//
+//   struct Rec { unsigned char mode; unsigned short count; ... };
+//
+//   #define REC_FIELDS(X) X(mode, mode) X(count, count) ...
+//
+//   BITF_PACK(Rec_pack, Bwf, Rec, REC_FIELDS)
+//
+// X(FIELD_SPEC, MEMBER) maps a bit field (specified as for BITF) to a
+// member of the struct.  As with BITF_S, BWF cannot be a dependent type.
+// BITF_PACK defines a class (Rec_pack) with the static member functions:
+//
+//   unpack(Bwf::Storage_access_t base, Rec &r)
+//     Reads each storage location of the record once, then sets each
+//     member of r to its bit field.
+//
+//   pack(const Rec &r, Bwf::Storage_access_t base)
+//     Writes each storage location of the record once.  Bits not in a
+//     mapped bit field are zero.
+//
+//   update(const Rec &r, Bwf::Storage_access_t base)
+//     Like pack(), but bits not in a mapped bit field are unchanged (each
+//     storage location is read once first).
+//
+// The record is copied to (or from) a local array of storage locations,
+// whose bit fields are accessed with Static_bf , so that with
+// optimization the array is kept in registers, and the code is a load of
+// each storage location, then shifts and masks.  The storage locations
+// are transferred with read_block() and write_block() , if
+// Bwf::Storage_access_t has them.  Values are truncated to the width of
+// the bit field when packed (as with native bit fields), and members are
+// set with the value of the bit field converted to the member's type.
+
+#ifndef BITFIELD_PACK_H_20160428
+#define BITFIELD_PACK_H_20160428
+
+#include "bitfield.h"
+
+namespace Bitfield_impl
+{
+
+// Traits for bit fields in a local copy of a record laid out for Bwf .
+template <class Bwf>
+class Pack_traits
+  : public Bitfield_traits_default<
+      typename Bwf::Value_t,
+      typename Remove_cv<typename Bwf::Storage_t>::Type>
+  {
+  public:
+
+    static const bool Storage_ls_bit_first = Bwf::Storage_ls_bit_first;
+
+    static const bool Fmt_offset_from_start = Bwf::Fmt_offset_from_start;
+
+    static const bool Fmt_align_at_zero_offset =
+      Bwf::Fmt_align_at_zero_offset;
+  };
+
+} // namespace Bitfield_impl
+
+// Base of the classes defined by BITF_PACK .
+template <class Bwf>
+class Bitfield_pack_base
+  {
+  public:
+
+    typedef typename Bwf::Value_t Value_t;
+
+    typedef typename Bwf::Storage_access_t Storage_access_t;
+
+    typedef typename Bwf::Format Format;
+
+    static const unsigned Dimension =
+      Bwf::template Define<Format>::Dimension;
+
+  protected:
+
+    typedef Bitfield_w_fmt<
+        Bitfield<Bitfield_impl::Pack_traits<Bwf> >, Format>
+      Local_bwf;
+
+    typedef typename Local_bwf::Storage_t Storage_t;
+
+    struct Words
+      {
+        Storage_t s[Dimension];
+      };
+
+    static void load(Storage_access_t base, Words &w)
+      {
+        Bitfield_impl::Block_transfer<Storage_access_t>::read(
+          base, 0, Dimension, w.s);
+      }
+
+    static void zero(Words &w)
+      {
+        for (unsigned i = 0; i < Dimension; ++i)
+          w.s[i] = 0;
+      }
+
+    static void store(Storage_access_t base, const Words &w)
+      {
+        Bitfield_impl::Block_transfer<Storage_access_t>::write(
+          base, 0, Dimension, w.s);
+      }
+  };
+
+// These macros are private -- not for direct use.
+//
+#define BITF_PACK_UNPACK_(FIELD_SPEC, MEMBER) \
+  n.MEMBER = BITF_S_STD(Local_bwf, w.s, FIELD_SPEC).read();
+
+#define BITF_PACK_PACK_(FIELD_SPEC, MEMBER) \
+  BITF_S_STD(Local_bwf, w.s, FIELD_SPEC).write_nvc( \
+    static_cast<Value_t>(n.MEMBER) & \
+    Local_bwf::mask(BITF_WIDTH(Local_bwf, FIELD_SPEC)));
+
+#define BITF_PACK(NAME, BWF, NATIVE, LIST) \
+struct NAME : public Bitfield_pack_base<BWF> \
+  { \
+    typedef NATIVE Native_t; \
+    \
+    static void unpack(Storage_access_t base, Native_t &n) \
+      { \
+        Words w; \
+        load(base, w); \
+        LIST(BITF_PACK_UNPACK_) \
+      } \
+    \
+    static void pack(const Native_t &n, Storage_access_t base) \
+      { \
+        Words w; \
+        zero(w); \
+        LIST(BITF_PACK_PACK_) \
+        store(base, w); \
+      } \
+    \
+    static void update(const Native_t &n, Storage_access_t base) \
+      { \
+        Words w; \
+        load(base, w); \
+        LIST(BITF_PACK_PACK_) \
+        store(base, w); \
+      } \
+  };
+
+#endif // Include once.
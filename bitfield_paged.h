@@ -0,0 +1,533 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Bit fields in a file (or block device) that is read and written with
+// pread() and pwrite() through a bounded cache of pages, for storage that
+// cannot be mapped into memory (see bitfield_mmap.h otherwise).
+//
+// Bitfield_paged_buf<Storage_t> is the cache:  a fixed number of pages,
+// each a fixed (power of two) number of storage locations, allocated
+// together in one arena.  When a page that is not in the cache is
+// accessed, the least recently used page is replaced (after writing it to
+// the file, if it was changed).  Bitfield_paged_t<Storage_t> (constructed
+// from a reference to the cache) is the Storage_access_t to use in the
+// traits of Bitfield, for example Bitfield_traits_paged:
+//
+//   Bitfield_paged_buf<uint32_t> pb(fd, 1024, 64);  // 64 pages of 4 KiB
+//
+//   typedef Bitfield<Bitfield_traits_paged<uint64_t, uint32_t> > Bf;
+//
+//   Bf::fn(Bitfield_paged_t<uint32_t>(pb), 1000000000, 17) = 5;
+//   pb.flush();
+//
+// The file holds storage locations in host byte order, starting at byte
+// offset base .  Storage past the end of the file reads as zero, and a
+// changed page is always written whole, so writing may extend the file to
+// the end of a page.  For files opened with O_DIRECT, the size of a page
+// in bytes and base must be multiples of the block size of the device
+// (the arena is aligned to Arena_align bytes).
+//
+// Since read() and write() of a Storage_access_t cannot fail, errors from
+// pread() and pwrite() are recorded in the cache:  good() becomes false and
+// error() has the message.  A page that cannot be read is not cached:  the
+// access that failed reads zeros, and its writes are lost (they are never
+// written over the file).  A page that cannot be written stays changed in
+// the cache, and other pages are replaced instead.  If all the pages in
+// the cache are changed and the least recently used cannot be written, a
+// page that is not in the cache is read into a scratch page for each
+// access, and its writes are lost.
+
+#ifndef BITFIELD_PAGED_H_20160428
+#define BITFIELD_PAGED_H_20160428
+
+#include "bitfield.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <unistd.h>
+
+struct Bitfield_paged_counters
+  {
+    // Accesses of a page that was in the cache (other than repeated
+    // accesses of the most recently used page), and accesses that
+    // loaded a page.
+    unsigned long hits, misses;
+
+    // Pages read from and written to the file.
+    unsigned long page_reads, page_writes;
+
+    Bitfield_paged_counters() { clear(); }
+
+    void clear() { hits = misses = page_reads = page_writes = 0; }
+  };
+
+template <typename S_t>
+class Bitfield_paged_t;
+
+template <typename S_t>
+class Bitfield_paged_buf
+  {
+  friend class Bitfield_paged_t<S_t>;
+
+  public:
+
+    typedef S_t Storage_t;
+
+    static const std::size_t Arena_align = 4096;
+
+    // Caches num_pages (at least one) pages of page_words storage
+    // locations (a power of two) of the file open as fd .  The cache is
+    // initially empty.
+    Bitfield_paged_buf(
+      int fd_, unsigned page_words, unsigned num_pages, off_t base_ = 0)
+      : fd(fd_), base(base_), shift(0), num(num_pages), last(0),
+        page(num_pages + 1, No_page), dirty(num_pages + 1, false),
+        prev(num_pages + 1), next(num_pages + 1), chain(num_pages, None)
+      {
+        while ((1u << shift) < page_words)
+          ++shift;
+
+        unsigned nb = 1;
+
+        while (nb < (2 * num))
+          nb <<= 1;
+
+        bucket.assign(nb, None);
+
+        void *p;
+
+        // The last page of the arena is the scratch page.
+        if (posix_memalign(&p, Arena_align, (num + 1) * page_bytes()) != 0)
+          throw std::bad_alloc();
+
+        arena = static_cast<Storage_t *>(p);
+
+        // Sentinel of the LRU list is at index num , most recently used
+        // page first.
+        for (unsigned f = 0; f <= num; ++f)
+          {
+            next[f] = (f + 1) % (num + 1);
+            prev[(f + 1) % (num + 1)] = f;
+          }
+      }
+
+    ~Bitfield_paged_buf()
+      {
+        flush();
+
+        std::free(arena);
+      }
+
+    // Writes each changed page to the file.  Returns good() .
+    bool flush()
+      {
+        for (unsigned f = 0; f < num; ++f)
+          if (dirty[f])
+            write_back(f);
+
+        return(good());
+      }
+
+    // Empties the cache.  Changes that have not been flushed are lost.
+    void invalidate()
+      {
+        for (unsigned f = 0; f < num; ++f)
+          if (page[f] != No_page)
+            {
+              unhash(f);
+
+              page[f] = No_page;
+              dirty[f] = false;
+            }
+      }
+
+    std::size_t page_words() const { return(std::size_t(1) << shift); }
+
+    unsigned num_pages() const { return(num); }
+
+    bool good() const { return(err.empty()); }
+
+    // Message for the first error since the last clear_error() .
+    const std::string & error() const { return(err); }
+
+    void clear_error() { err.clear(); }
+
+    Bitfield_paged_counters count;
+
+  private:
+
+    // Not copyable.
+    Bitfield_paged_buf(const Bitfield_paged_buf &);
+    Bitfield_paged_buf & operator = (const Bitfield_paged_buf &);
+
+    static const std::size_t No_page = ~std::size_t(0);
+
+    static const unsigned None = ~0u;
+
+    const int fd;
+
+    const off_t base;
+
+    unsigned shift, num;
+
+    // Most recently used page (frame index).
+    unsigned last;
+
+    Storage_t *arena;
+
+    // Per frame:  page number in the file, and whether changed.  Frame
+    // num is the scratch page, whose page number is always No_page .
+    std::vector<std::size_t> page;
+
+    std::vector<bool> dirty;
+
+    // LRU list.
+    std::vector<unsigned> prev, next;
+
+    // Hash table of page numbers, with chains through the frames.
+    std::vector<unsigned> bucket, chain;
+
+    std::string err;
+
+    std::size_t page_bytes() const
+      { return(page_words() * sizeof(Storage_t)); }
+
+    off_t file_offset(std::size_t pg) const
+      { return(base + off_t(pg * page_bytes())); }
+
+    unsigned & head(std::size_t pg)
+      { return(bucket[pg & (bucket.size() - 1)]); }
+
+    void unhash(unsigned f)
+      {
+        unsigned *p = &head(page[f]);
+
+        while (*p != f)
+          p = &chain[*p];
+
+        *p = chain[f];
+      }
+
+    void fail(const char *what)
+      {
+        if (good())
+          err = std::string(what) + ": " + std::strerror(errno);
+      }
+
+    // Reads page pg into frame f .  Returns false if it could not be
+    // read.
+    bool load(unsigned f, std::size_t pg)
+      {
+        char *p = reinterpret_cast<char *>(arena + (std::size_t(f) << shift));
+
+        std::size_t n = 0;
+
+        while (n < page_bytes())
+          {
+            const ssize_t r =
+              pread(
+                fd, p + n, page_bytes() - n, file_offset(pg) + off_t(n));
+
+            if (r < 0)
+              {
+                if (errno == EINTR)
+                  continue;
+
+                fail("pread");
+
+                std::memset(p, 0, page_bytes());
+
+                return(false);
+              }
+
+            if (r == 0)
+              break;
+
+            n += std::size_t(r);
+          }
+
+        std::memset(p + n, 0, page_bytes() - n);
+
+        ++count.page_reads;
+
+        return(true);
+      }
+
+    // Returns false (with the page still changed) if the page could not
+    // be written.
+    bool write_back(unsigned f)
+      {
+        const char *p =
+          reinterpret_cast<const char *>(arena + (std::size_t(f) << shift));
+
+        std::size_t n = 0;
+
+        while (n < page_bytes())
+          {
+            const ssize_t r =
+              pwrite(
+                fd, p + n, page_bytes() - n, file_offset(page[f]) + off_t(n));
+
+            if (r < 0)
+              {
+                if (errno == EINTR)
+                  continue;
+
+                fail("pwrite");
+
+                return(false);
+              }
+
+            n += std::size_t(r);
+          }
+
+        dirty[f] = false;
+
+        ++count.page_writes;
+
+        return(true);
+      }
+
+    // The least recently used frame whose page is unchanged or is written
+    // back, or None if there is none.  Only the least recently used
+    // changed page is written, so each miss tries at most one pwrite()
+    // when the file cannot be written.
+    unsigned victim()
+      {
+        bool tried = false;
+
+        for (unsigned f = prev[num]; f != num; f = prev[f])
+          if (!dirty[f])
+            return(f);
+          else if (!tried)
+            {
+              tried = true;
+
+              if (write_back(f))
+                return(f);
+            }
+
+        return(None);
+      }
+
+    // Returns the frame holding page pg , loading it if necessary.
+    unsigned frame(std::size_t pg)
+      {
+        unsigned f = head(pg);
+
+        while ((f != None) && (page[f] != pg))
+          f = chain[f];
+
+        if (f != None)
+          ++count.hits;
+        else
+          {
+            ++count.misses;
+
+            f = victim();
+
+            if (f == None)
+              {
+                // Not cached, so read for each access, and never written
+                // back.
+                load(num, pg);
+
+                last = num;
+
+                return(num);
+              }
+
+            if (page[f] != No_page)
+              unhash(f);
+
+            page[f] = pg;
+
+            if (!load(f, pg))
+              {
+                // Not cached, and never written back.  Used only for the
+                // access that loaded it, and replaced first.
+                page[f] = No_page;
+
+                next[prev[f]] = next[f];
+                prev[next[f]] = prev[f];
+
+                next[f] = num;
+                prev[f] = prev[num];
+                next[prev[num]] = f;
+                prev[num] = f;
+
+                last = f;
+
+                return(f);
+              }
+
+            chain[f] = head(pg);
+            head(pg) = f;
+          }
+
+        // Move to the front of the LRU list.
+        next[prev[f]] = next[f];
+        prev[next[f]] = prev[f];
+
+        next[f] = next[num];
+        prev[f] = num;
+        prev[next[num]] = f;
+        next[num] = f;
+
+        last = f;
+
+        return(f);
+      }
+
+    Storage_t & word(std::size_t offset)
+      {
+        const std::size_t pg = offset >> shift;
+
+        const unsigned f = page[last] == pg ? last : frame(pg);
+
+        return(
+          arena[(std::size_t(f) << shift) +
+                (offset & (page_words() - 1))]);
+      }
+
+    // Marks the most recently used page as changed (unless it is not
+    // cached).
+    void changed()
+      {
+        if (page[last] != No_page)
+          dirty[last] = true;
+      }
+
+    Storage_t read(std::size_t offset) { return(word(offset)); }
+
+    void write(std::size_t offset, Storage_t t)
+      {
+        word(offset) = t;
+
+        changed();
+      }
+
+    // Returns the storage location at offset, and reduces n to no more
+    // than the number of storage locations from there to the end of its
+    // page.  If to_change is true, the page is marked as changed.
+    Storage_t * span(std::size_t offset, std::size_t &n, bool to_change)
+      {
+        const std::size_t r = page_words() - (offset & (page_words() - 1));
+
+        if (n > r)
+          n = r;
+
+        Storage_t *w = &word(offset);
+
+        if (to_change)
+          changed();
+
+        return(w);
+      }
+
+  }; // end class Bitfield_paged_buf
+
+template <typename S_t>
+const std::size_t Bitfield_paged_buf<S_t>::Arena_align;
+
+template <typename S_t>
+const std::size_t Bitfield_paged_buf<S_t>::No_page;
+
+template <typename S_t>
+const unsigned Bitfield_paged_buf<S_t>::None;
+
+template <typename S_t>
+class Bitfield_paged_t
+  {
+  public:
+
+    typedef S_t Storage_t;
+
+    Bitfield_paged_t(Bitfield_paged_buf<S_t> &pb_) : pb(pb_), cum_offset(0)
+      { }
+
+    void operator += (std::size_t offset) { cum_offset += offset; }
+
+    Storage_t read() { return(pb.read(cum_offset)); }
+
+    void write(Storage_t t) { pb.write(cum_offset, t); }
+
+    void read_block(unsigned offset, unsigned count, Storage_t *dst)
+      {
+        std::size_t o = cum_offset + offset;
+
+        while (count != 0)
+          {
+            std::size_t n = count;
+
+            const Storage_t *w = pb.span(o, n, false);
+
+            std::memcpy(dst, w, n * sizeof(Storage_t));
+
+            o += n;
+            dst += n;
+            count -= unsigned(n);
+          }
+      }
+
+    void write_block(unsigned offset, unsigned count, const Storage_t *src)
+      {
+        std::size_t o = cum_offset + offset;
+
+        while (count != 0)
+          {
+            std::size_t n = count;
+
+            Storage_t *w = pb.span(o, n, true);
+
+            std::memcpy(w, src, n * sizeof(Storage_t));
+
+            o += n;
+            src += n;
+            count -= unsigned(n);
+          }
+      }
+
+  private:
+
+    Bitfield_paged_buf<S_t> &pb;
+
+    std::size_t cum_offset;
+
+  }; // end class Bitfield_paged_t
+
+template <typename V_t = unsigned, typename S_t = V_t>
+class Bitfield_traits_paged : public Bitfield_traits_default<V_t, S_t>
+  {
+  public:
+
+    typedef Bitfield_paged_t<S_t> Storage_access_t;
+
+    typedef std::size_t Bit_offset_t;
+
+  }; // class Bitfield_traits_paged
+
+#endif // Include once.
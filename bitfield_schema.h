@@ -0,0 +1,757 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Bit field layouts read at run time from text (for example, generated
+// from a vendor's register description), rather than defined by a
+// Bitfield_format .  Loading a layout produces a table of bit fields,
+// with a name, a Field and a Bitfield<Traits, Err_act>::Descriptor for
+// each.  Names are looked up once (typically at startup) to get the
+// index of a bit field in the table.  A whole record can be decoded into
+// (or encoded from) an array of values, indexed like the table, with one
+// pass over the storage locations.
+//
+// Layout text has one item per line.  # starts a comment.  Numbers are
+// decimal, or hexadecimal with a 0x prefix.  The items are:
+//
+//   NAME WIDTH [@ OFFSET]            A bit field.
+//   NAME[COUNT] WIDTH [@ OFFSET]     An array of bit fields.
+//   NAME [@ OFFSET] {                A group of items (ended by }).
+//   NAME[COUNT] [@ OFFSET] {         An array of groups.
+//   }                                End of a group.
+//   - WIDTH                          Unused bits.
+//
+// OFFSET is the offset in bits of the item from the start of the
+// enclosing group (or record).  Without it, the item follows the one
+// before it.  The size of a group is the end of the item in it that ends
+// last.  A bit field in a group has the name GROUP.NAME, and element I of
+// an array is NAME[I], so for example:
+//
+//   hdr {
+//     len 12
+//     flags 4
+//   }
+//   ent[2] {
+//     addr 20
+//     - 4
+//     prio 8 @ 28
+//   }
+//
+// gives the bit fields hdr.len, hdr.flags, ent[0].addr, ent[0].prio,
+// ent[1].addr and ent[1].prio, in that order, at offsets 0, 12, 16, 44,
+// 52 and 80.  Offsets and widths are as for Bitfield<Traits>::Bf .
+
+#ifndef BITFIELD_SCHEMA_H_20160428
+#define BITFIELD_SCHEMA_H_20160428
+
+#include "bitfield.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+template <
+  class Traits,
+  class Err_act = Bitfield_impl::Err_act_default<typename Traits::Value_t> >
+class Bitfield_schema
+  {
+  public:
+
+    typedef Bitfield<Traits, Err_act> Bitfield_t;
+
+    typedef typename Bitfield_t::Value_t Value_t;
+
+    typedef typename Bitfield_t::Storage_t Storage_t;
+
+    typedef typename Bitfield_t::Storage_access_t Storage_access_t;
+
+    typedef typename Bitfield_t::Field Field;
+
+    typedef typename Bitfield_t::Descriptor Descriptor;
+
+    static const unsigned Storage_bits = Bitfield_t::Storage_bits;
+
+    Bitfield_schema() : bits(0) { }
+
+    // Replaces the layout with the one read from in .  If there is an
+    // error, returns false, and the schema is left empty, with the
+    // message from error() .
+    bool load(std::istream &in)
+      {
+        clear();
+
+        Parser p(*this);
+
+        if (!p.parse(in) || !p.layout())
+          {
+            std::string e = err;
+
+            clear();
+
+            err = e;
+
+            return(false);
+          }
+
+        return(true);
+      }
+
+    bool load_text(const std::string &text)
+      {
+        std::istringstream in(text);
+
+        return(load(in));
+      }
+
+    bool load_file(const char *path)
+      {
+        std::ifstream in(path);
+
+        if (!in)
+          {
+            clear();
+
+            err = std::string("cannot open ") + path;
+
+            return(false);
+          }
+
+        return(load(in));
+      }
+
+    // Description of the error that made the last load fail, with the
+    // line number.
+    const std::string & error() const { return(err); }
+
+    void clear()
+      {
+        entry.clear();
+        desc.clear();
+        local.clear();
+        cover.clear();
+        index.clear();
+        bits = 0;
+        err.clear();
+      }
+
+    // The number of bit fields.
+    unsigned size() const { return(unsigned(entry.size())); }
+
+    // The number of bits in a record (the end of the item that ends last).
+    unsigned record_bits() const { return(bits); }
+
+    // The number of storage locations in a record.
+    unsigned dimension() const
+      { return((bits + Storage_bits - 1) / Storage_bits); }
+
+    // Index of the bit field with the given name, or -1 if there is none.
+    int find(const std::string &name) const
+      {
+        typename std::map<std::string, unsigned>::const_iterator i =
+          index.find(name);
+
+        return(i == index.end() ? -1 : int(i->second));
+      }
+
+    const std::string & name(unsigned i) const { return(entry[i].name); }
+
+    Field field(unsigned i) const { return(entry[i].field); }
+
+    const Descriptor & descriptor(unsigned i) const { return(desc[i]); }
+
+    typename Bitfield_t::Bf bf(Storage_access_t base, unsigned i) const
+      { return(desc[i].bf(base)); }
+
+    // Reads all the bit fields of the record at base into values (which
+    // must have size() elements).  Each storage location that has a bit
+    // field in it is read once (consecutive ones with read_block() , if
+    // Storage_access_t has it).
+    void decode(Storage_access_t base, Value_t *values) const
+      {
+        Buf b(dimension());
+
+        for (unsigned i = 0; i < dimension(); )
+          {
+            const unsigned n = run(i, Any);
+
+            if (n == 0)
+              {
+                ++i;
+                continue;
+              }
+
+            Block::read(base, i, n, b.p + i);
+
+            i += n;
+          }
+
+        for (unsigned i = 0; i < size(); ++i)
+          values[i] = local[i].read(b.p);
+      }
+
+    // Writes all the bit fields of the record at base from values (which
+    // must have size() elements).  Each storage location that has a bit
+    // field in it is written once (consecutive ones with write_block() ,
+    // if Storage_access_t has it), and is read first only if some of its
+    // bits are not in any bit field.  If a value is too big for its bit
+    // field, Err_act::value_too_big() is called, and false is returned
+    // without writing anything.
+    bool encode(Storage_access_t base, const Value_t *values) const
+      {
+        for (unsigned i = 0; i < size(); ++i)
+          {
+            const unsigned w = entry[i].field.field_width;
+
+            if ((values[i] >> (w - 1)) >> 1)
+              {
+                Err_act::value_too_big(values[i], w);
+
+                return(false);
+              }
+          }
+
+        Buf b(dimension());
+
+        for (unsigned i = 0; i < dimension(); )
+          {
+            const unsigned n = run(i, Partial);
+
+            if (n == 0)
+              {
+                b.p[i++] = 0;
+                continue;
+              }
+
+            Block::read(base, i, n, b.p + i);
+
+            i += n;
+          }
+
+        for (unsigned i = 0; i < size(); ++i)
+          local[i].write_nvc(b.p, values[i]);
+
+        for (unsigned i = 0; i < dimension(); )
+          {
+            const unsigned n = run(i, Any);
+
+            if (n == 0)
+              {
+                ++i;
+                continue;
+              }
+
+            Block::write(base, i, n, b.p + i);
+
+            i += n;
+          }
+
+        return(true);
+      }
+
+  private:
+
+    typedef typename Bitfield_impl::Remove_cv<Storage_t>::Type S;
+
+    typedef Bitfield_impl::Block_transfer<Storage_access_t> Block;
+
+    // For bit fields in a local copy of a record.
+    struct Local_traits : public Traits
+      {
+        typedef typename Bitfield_traits_default<Value_t, S>::Storage_access_t
+          Storage_access_t;
+      };
+
+    typedef typename Bitfield<Local_traits, Err_act>::Descriptor
+      Local_descriptor;
+
+    struct Entry
+      {
+        std::string name;
+
+        Field field;
+
+        Entry(const std::string &name_, const Field &field_)
+          : name(name_), field(field_)
+          { }
+      };
+
+    std::vector<Entry> entry;
+
+    std::vector<Descriptor> desc;
+
+    std::vector<Local_descriptor> local;
+
+    // For each storage location, the bits that are in a bit field.
+    std::vector<S> cover;
+
+    std::map<std::string, unsigned> index;
+
+    unsigned bits;
+
+    std::string err;
+
+    // Local copy of a record, on the stack if it is small.
+    class Buf
+      {
+      public:
+
+        Buf(unsigned dim)
+          : p(dim <= Num_local ? local : (heap.resize(dim), &heap[0]))
+          { }
+
+      private:
+
+        static const unsigned Num_local = 256 / sizeof(S);
+
+        S local[Num_local];
+
+        std::vector<S> heap;
+
+      public:
+
+        S *const p;
+
+      private:
+
+        Buf(const Buf &);
+        void operator = (const Buf &);
+      };
+
+    enum Which { Any, Partial };
+
+    // The number of consecutive storage locations, starting at i, with
+    // any bits (or only some bits) in bit fields.
+    unsigned run(unsigned i, Which which) const
+      {
+        unsigned n = 0;
+
+        for ( ; (i + n) < cover.size(); ++n)
+          {
+            const S c = cover[i + n];
+
+            if ((c == 0) ||
+                ((which == Partial) && (c == static_cast<S>(~S(0)))))
+              break;
+          }
+
+        return(n);
+      }
+
+    bool add(const std::string &name, unsigned first_bit, unsigned width)
+      {
+        if (!index.insert(std::make_pair(name, size())).second)
+          return(false);
+
+        const Field f(
+          static_cast<typename Bitfield_t::Bit_offset_t>(first_bit),
+          static_cast<unsigned short>(width));
+
+        entry.push_back(Entry(name, f));
+        desc.push_back(Descriptor(f));
+        local.push_back(Local_descriptor(f.first_bit, f.field_width));
+
+        return(true);
+      }
+
+    void finish(unsigned record_bits)
+      {
+        bits = record_bits;
+
+        cover.assign(dimension(), 0);
+
+        for (unsigned i = 0; i < size(); ++i)
+          local[i].write_nvc(
+            &cover[0],
+            Bitfield_impl::mask<Value_t>(entry[i].field.field_width));
+      }
+
+    // Reads layout text into a tree of items, then lays them out.
+    class Parser
+      {
+      public:
+
+        Parser(Bitfield_schema &s_) : s(s_) { }
+
+        bool parse(std::istream &in)
+          {
+            // Item 0 is the record.
+            item.push_back(Item());
+
+            std::vector<unsigned> open(1, 0);
+
+            std::string text;
+
+            for (line = 1; std::getline(in, text); ++line)
+              {
+                if (!tokenize(text))
+                  return(false);
+
+                if (tok.empty())
+                  continue;
+
+                if (tok[0] == "}")
+                  {
+                    if (tok.size() != 1)
+                      return(fail("unexpected text after }"));
+
+                    if (open.size() == 1)
+                      return(fail("} without group"));
+
+                    open.pop_back();
+
+                    continue;
+                  }
+
+                Item it;
+
+                it.line = line;
+
+                unsigned t = 0;
+
+                if (tok[0] == "-")
+                  {
+                    if ((tok.size() != 2) || !number(tok[1], it.width) ||
+                        (it.width == 0))
+                      return(fail("expected - WIDTH"));
+
+                    it.padding = true;
+                  }
+                else
+                  {
+                    if (!is_name(tok[0]))
+                      return(fail("expected a name"));
+
+                    it.name = tok[0];
+                    t = 1;
+
+                    if ((t < tok.size()) && (tok[t] == "["))
+                      {
+                        if (((t + 2) >= tok.size()) ||
+                            !number(tok[t + 1], it.count) ||
+                            (tok[t + 2] != "]"))
+                          return(fail("expected [COUNT]"));
+
+                        if (it.count == 0)
+                          return(fail("count must not be 0"));
+
+                        it.array = true;
+                        t += 3;
+                      }
+
+                    if ((t < tok.size()) && (tok[t] != "@") &&
+                        (tok[t] != "{"))
+                      {
+                        if (!number(tok[t], it.width))
+                          return(fail("expected a width"));
+
+                        if ((it.width == 0) || (it.width > Value_bits))
+                          return(fail("invalid width"));
+
+                        ++t;
+                      }
+
+                    if ((t < tok.size()) && (tok[t] == "@"))
+                      {
+                        if (((t + 1) >= tok.size()) ||
+                            !number(tok[t + 1], it.offset))
+                          return(fail("expected @ OFFSET"));
+
+                        it.has_offset = true;
+                        t += 2;
+                      }
+
+                    if ((t < tok.size()) && (tok[t] == "{"))
+                      {
+                        if (it.width != 0)
+                          return(fail("a group has no width"));
+
+                        it.group = true;
+                        ++t;
+                      }
+                    else if (it.width == 0)
+                      return(fail("expected a width or {"));
+
+                    if (t != tok.size())
+                      return(fail("unexpected text at end of line"));
+                  }
+
+                item.push_back(it);
+                item[open.back()].member.push_back(unsigned(item.size() - 1));
+
+                if (it.group)
+                  open.push_back(unsigned(item.size() - 1));
+              }
+
+            if (open.size() != 1)
+              {
+                line = item[open.back()].line;
+
+                return(fail("group not ended with }"));
+              }
+
+            return(true);
+          }
+
+        // Adds the bit fields to the schema.
+        bool layout()
+          {
+            unsigned long record_bits = 0;
+
+            if (!size_of(0, record_bits) ||
+                !emit(0, std::string(), 0))
+              return(false);
+
+            s.finish(unsigned(record_bits));
+
+            return(true);
+          }
+
+      private:
+
+        static const unsigned Value_bits =
+          Bitfield_impl::Num_bits<Value_t>::Value;
+
+        // Greatest offset of the end of a bit field.
+        static const unsigned long Max_bits = 0x10000;
+
+        struct Item
+          {
+            std::string name;
+
+            unsigned long width, count, offset;
+
+            bool array, group, padding, has_offset;
+
+            unsigned line;
+
+            std::vector<unsigned> member;
+
+            // Size (in bits) of one element, if a group.
+            unsigned long size;
+
+            Item()
+              : width(0), count(1), offset(0), array(false), group(false),
+                padding(false), has_offset(false), line(0), size(0)
+              { }
+          };
+
+        Bitfield_schema &s;
+
+        std::vector<Item> item;
+
+        std::vector<std::string> tok;
+
+        unsigned line;
+
+        bool fail(const char *msg)
+          {
+            std::ostringstream os;
+
+            os << "line " << line << ": " << msg;
+
+            s.err = os.str();
+
+            return(false);
+          }
+
+        static bool is_name(const std::string &t)
+          { return(std::isalpha((unsigned char) t[0]) || (t[0] == '_')); }
+
+        static bool number(const std::string &t, unsigned long &n)
+          {
+            const bool hex =
+              (t.size() > 2) && (t[0] == '0') &&
+              ((t[1] == 'x') || (t[1] == 'X'));
+
+            if (!(hex ? std::isxdigit((unsigned char) t[2]) :
+                        std::isdigit((unsigned char) t[0])))
+              return(false);
+
+            char *end;
+
+            n = std::strtoul(t.c_str(), &end, hex ? 16 : 10);
+
+            return((*end == 0) && (n < Max_bits));
+          }
+
+        bool tokenize(const std::string &text)
+          {
+            tok.clear();
+
+            for (std::string::size_type i = 0; i < text.size(); )
+              {
+                const char c = text[i];
+
+                if (c == '#')
+                  break;
+
+                if (std::isspace((unsigned char) c))
+                  {
+                    ++i;
+                    continue;
+                  }
+
+                if ((c == '{') || (c == '}') || (c == '[') || (c == ']') ||
+                    (c == '@') || (c == '-'))
+                  {
+                    tok.push_back(std::string(1, c));
+                    ++i;
+                    continue;
+                  }
+
+                if (!std::isalnum((unsigned char) c) && (c != '_'))
+                  return(fail("unexpected character"));
+
+                std::string::size_type j = i;
+
+                while ((j < text.size()) &&
+                       (std::isalnum((unsigned char) text[j]) ||
+                        (text[j] == '_')))
+                  ++j;
+
+                tok.push_back(text.substr(i, j - i));
+                i = j;
+              }
+
+            return(true);
+          }
+
+        // Total size in bits of item i (all elements, if an array).
+        bool size_of(unsigned i, unsigned long &sz)
+          {
+            Item &it = item[i];
+
+            if (it.group || (i == 0))
+              {
+                unsigned long pos = 0, end = 0;
+
+                for (unsigned m = 0; m < it.member.size(); ++m)
+                  {
+                    const Item &mi = item[it.member[m]];
+
+                    unsigned long msz = 0;
+
+                    if (!size_of(it.member[m], msz))
+                      return(false);
+
+                    if (mi.has_offset)
+                      pos = mi.offset;
+
+                    pos += msz;
+
+                    if (pos > Max_bits)
+                      {
+                        line = mi.line;
+
+                        return(fail("offset too big"));
+                      }
+
+                    if (pos > end)
+                      end = pos;
+                  }
+
+                it.size = end;
+
+                sz = end * it.count;
+              }
+            else
+              sz = it.width * it.count;
+
+            if (sz > Max_bits)
+              {
+                line = it.line;
+
+                return(fail("offset too big"));
+              }
+
+            return(true);
+          }
+
+        // Adds the bit fields in the members of group i (whose element
+        // starts at offset first), with name prefix.
+        bool emit(unsigned i, const std::string &prefix, unsigned long first)
+          {
+            const Item &g = item[i];
+
+            unsigned long pos = 0;
+
+            for (unsigned m = 0; m < g.member.size(); ++m)
+              {
+                const Item &it = item[g.member[m]];
+
+                if (it.has_offset)
+                  pos = it.offset;
+
+                const unsigned long elem = it.group ? it.size : it.width;
+
+                for (unsigned long e = 0; e < it.count; ++e)
+                  {
+                    std::string name;
+
+                    if (!it.padding)
+                      {
+                        std::ostringstream os;
+
+                        os << prefix << it.name;
+
+                        if (it.array)
+                          os << '[' << e << ']';
+
+                        name = os.str();
+                      }
+
+                    const unsigned long at = first + pos + (e * elem);
+
+                    if (it.group)
+                      {
+                        if (!emit(g.member[m], name + ".", at))
+                          return(false);
+                      }
+                    else if (!it.padding)
+                      {
+                        if ((at + it.width) > Max_bits)
+                          {
+                            line = it.line;
+
+                            return(fail("offset too big"));
+                          }
+
+                        if (!s.add(name, unsigned(at), unsigned(it.width)))
+                          {
+                            line = it.line;
+
+                            return(fail("duplicate name"));
+                          }
+                      }
+                  }
+
+                pos += elem * it.count;
+              }
+
+            return(true);
+          }
+      }; // end class Parser
+
+  }; // end class Bitfield_schema
+
+#endif // Include once.
@@ -0,0 +1,360 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Shadow cache for a map of registers (or other storage locations that are
+// slow to access).  Unlike Bitfield_seq_storage_write_buf, which buffers
+// one storage location, the cache holds a copy of each storage location in
+// a range, so bit fields can be read and changed in any order with at most
+// one read of each storage location (until it is invalidated).
+//
+// Bitfield_shadow_buf<Storage_access_t, Traits> is the cache, and
+// Bitfield_shadow_t<Storage_access_t, Traits> (constructed from a
+// reference to the cache) is the Storage_access_t to use in the traits of
+// Bitfield.  Offsets are relative to the Storage_access_t the cache was
+// constructed with.  Storage locations outside the cached range, or that
+// are volatile, are always accessed directly.
+
+#ifndef BITFIELD_SHADOW_H_20160428
+#define BITFIELD_SHADOW_H_20160428
+
+#include "bitfield.h"
+
+#include <vector>
+
+class Bitfield_shadow_default_traits
+  {
+  public:
+
+    // If true, writes change only the cache, and the changed storage
+    // locations are written by flush().  If false, each write goes to the
+    // storage location as well as the cache.
+    static const bool Write_back = true;
+
+    static const bool Flush_on_destroy = true;
+
+    // True if the storage location at this offset must never be cached
+    // (for example, a status register that the device changes).
+    static bool is_volatile(unsigned /* offset */) { return(false); }
+  };
+
+template <
+  class Storage_access_t, class Traits = Bitfield_shadow_default_traits>
+class Bitfield_shadow_t;
+
+template <
+  class Storage_access_t, class Traits = Bitfield_shadow_default_traits>
+class Bitfield_shadow_buf
+  {
+  friend class Bitfield_shadow_t<Storage_access_t, Traits>;
+
+  public:
+
+    typedef typename Storage_access_t::Storage_t Storage_t;
+
+    // Caches the num_words storage locations starting at offset
+    // first_offset .  The cache is initially empty.
+    Bitfield_shadow_buf(
+      Storage_access_t sa_, unsigned first_offset, unsigned num_words)
+      : sa(sa_), first(first_offset), word(num_words), status(num_words, 0)
+      {
+        for (unsigned i = 0; i < num_words; ++i)
+          if (Traits::is_volatile(first + i))
+            status[i] = Volatile;
+      }
+
+    // Writes each changed storage location (in order of increasing
+    // offset).  Runs of consecutive changed storage locations are written
+    // with write_block() , if Storage_access_t has it.
+    void flush()
+      {
+        for (unsigned i = 0; i < word.size(); )
+          {
+            const unsigned n = run(i, Dirty, Dirty);
+
+            if (n == 0)
+              {
+                ++i;
+                continue;
+              }
+
+            // Do this first in case of exception.
+            for (unsigned j = i; j < (i + n); ++j)
+              status[j] &= ~Dirty;
+
+            Bitfield_impl::Block_transfer<Storage_access_t>::write(
+              sa, first + i, n, &word[i]);
+
+            i += n;
+          }
+      }
+
+    // Reads each storage location that is not volatile and not already in
+    // the cache into the cache, with read_block() (if Storage_access_t has
+    // it) for runs of consecutive storage locations.
+    void load()
+      {
+        for (unsigned i = 0; i < word.size(); )
+          {
+            const unsigned n = run(i, Valid | Volatile, 0);
+
+            if (n == 0)
+              {
+                ++i;
+                continue;
+              }
+
+            Bitfield_impl::Block_transfer<Storage_access_t>::read(
+              sa, first + i, n, &word[i]);
+
+            for (unsigned j = i; j < (i + n); ++j)
+              status[j] |= Valid;
+
+            i += n;
+          }
+      }
+
+    // Empties the cache.  Changes that have not been flushed are lost.
+    void invalidate()
+      {
+        for (unsigned i = 0; i < word.size(); ++i)
+          status[i] &= Volatile;
+      }
+
+    // Removes one storage location from the cache (losing any change to
+    // it that has not been flushed).
+    void invalidate(unsigned offset)
+      {
+        if (in_range(offset))
+          status[offset - first] &= Volatile;
+      }
+
+    // Makes a storage location volatile (after removing it from the cache
+    // without writing it).
+    void mark_volatile(unsigned offset)
+      {
+        if (in_range(offset))
+          status[offset - first] = Volatile;
+      }
+
+    bool is_valid(unsigned offset) const
+      { return(in_range(offset) and (status[offset - first] & Valid)); }
+
+    bool is_dirty(unsigned offset) const
+      { return(in_range(offset) and (status[offset - first] & Dirty)); }
+
+    ~Bitfield_shadow_buf()
+      {
+        if (Traits::Flush_on_destroy)
+          flush();
+      }
+
+  private:
+
+    // Not copyable.
+    Bitfield_shadow_buf(const Bitfield_shadow_buf &);
+    Bitfield_shadow_buf & operator = (const Bitfield_shadow_buf &);
+
+    enum { Valid = 1, Dirty = 2, Volatile = 4 };
+
+    const Storage_access_t sa;
+
+    const unsigned first;
+
+    std::vector<Storage_t> word;
+
+    std::vector<unsigned char> status;
+
+    bool in_range(unsigned offset) const
+      { return((offset >= first) and ((offset - first) < word.size())); }
+
+    // The number of consecutive storage locations, starting at index i,
+    // whose status bits in m are equal to v.
+    unsigned run(unsigned i, unsigned char m, unsigned char v) const
+      {
+        unsigned n = 0;
+
+        while (((i + n) < word.size()) && ((status[i + n] & m) == v))
+          ++n;
+
+        return(n);
+      }
+
+    bool cached(unsigned offset) const
+      { return(in_range(offset) and !(status[offset - first] & Volatile)); }
+
+    Storage_t read(unsigned offset)
+      {
+        if (!cached(offset))
+          return(device_read(offset));
+
+        const unsigned i = offset - first;
+
+        if (!(status[i] & Valid))
+          {
+            word[i] = device_read(offset);
+
+            status[i] |= Valid;
+          }
+
+        return(word[i]);
+      }
+
+    void write(unsigned offset, Storage_t t)
+      {
+        if (!cached(offset))
+          {
+            device_write(offset, t);
+
+            return;
+          }
+
+        const unsigned i = offset - first;
+
+        if (Traits::Write_back)
+          {
+            word[i] = t;
+
+            status[i] |= Valid | Dirty;
+          }
+        else
+          {
+            // Do this first in case of exception.
+            status[i] &= ~Valid;
+
+            device_write(offset, t);
+
+            word[i] = t;
+
+            status[i] |= Valid;
+          }
+      }
+
+    Storage_t device_read(unsigned offset) const
+      {
+        Storage_access_t sa_(sa);
+
+        sa_ += offset;
+
+        return(sa_.read());
+      }
+
+    void device_write(unsigned offset, Storage_t t) const
+      {
+        Storage_access_t sa_(sa);
+
+        sa_ += offset;
+
+        sa_.write(t);
+      }
+
+  }; // end class Bitfield_shadow_buf
+
+template <class Storage_access_t, class Traits>
+class Bitfield_shadow_t
+  {
+  public:
+
+    typedef typename Storage_access_t::Storage_t Storage_t;
+
+    Bitfield_shadow_t(Bitfield_shadow_buf<Storage_access_t, Traits> &sb_)
+      : sb(sb_), cum_offset(0)
+      { }
+
+    void operator += (unsigned offset) { cum_offset += offset; }
+
+    Storage_t read() { return(sb.read(cum_offset)); }
+
+    void write(Storage_t t) { sb.write(cum_offset, t); }
+
+  private:
+
+    Bitfield_shadow_buf<Storage_access_t, Traits> &sb;
+
+    unsigned cum_offset;
+
+  }; // end class Bitfield_shadow_t
+
+// Reads the storage locations with offsets less than Num_storage (for a
+// Format, typically Bitfield::Define<Format>::Dimension) once, in a burst
+// (with read_block() , if Storage_access_t has it).  Bit fields are then
+// read from the local copy, through Bitfield_snapshot_t<Storage_access_t,
+// Num_storage> .  Storage locations at or past Num_storage are read
+// directly.
+template <class Storage_access_t, unsigned Num_storage>
+class Bitfield_snapshot_buf
+  {
+  public:
+
+    typedef typename Storage_access_t::Storage_t Storage_t;
+
+    Bitfield_snapshot_buf(Storage_access_t sa_) : sa(sa_) { refresh(); }
+
+    // Reads the storage locations again.
+    void refresh()
+      {
+        Bitfield_impl::Block_transfer<Storage_access_t>::read(
+          sa, 0, Num_storage, buffer);
+      }
+
+    Storage_t read(unsigned offset) const
+      {
+        if (offset < Num_storage)
+          return(buffer[offset]);
+
+        Storage_access_t sa_(sa);
+
+        sa_ += offset;
+
+        return(sa_.read());
+      }
+
+  private:
+
+    const Storage_access_t sa;
+
+    typename Bitfield_impl::Remove_cv<Storage_t>::Type buffer[Num_storage];
+
+  }; // end class Bitfield_snapshot_buf
+
+// Read-only storage access type for Bitfield_snapshot_buf .
+template <class Storage_access_t, unsigned Num_storage>
+class Bitfield_snapshot_t
+  {
+  public:
+
+    typedef typename Storage_access_t::Storage_t Storage_t;
+
+    Bitfield_snapshot_t(
+      const Bitfield_snapshot_buf<Storage_access_t, Num_storage> &sb_)
+      : sb(sb_), cum_offset(0)
+      { }
+
+    void operator += (unsigned offset) { cum_offset += offset; }
+
+    Storage_t read() { return(sb.read(cum_offset)); }
+
+  private:
+
+    const Bitfield_snapshot_buf<Storage_access_t, Num_storage> &sb;
+
+    unsigned cum_offset;
+
+  }; // end class Bitfield_snapshot_t
+
+#endif // Include once.
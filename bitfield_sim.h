@@ -0,0 +1,211 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Simulated device with a map of registers that are not memory-mapped,
+// for measuring the bus transactions that ways of accessing bit fields
+// cost, without the hardware.  Like the device of Example_register_access
+// in ex_traits.cpp, a register is accessed by writing its offset to a
+// select register, then reading or writing a buffer register.  The
+// select register is only written when the register accessed is not the
+// one already selected.  The simulated device also does burst transfers
+// of consecutive registers (read_block() and write_block()).
+//
+// Latency is not real (there is no delay), it is accumulated as a count
+// of bus cycles in the device's counters.
+
+#ifndef BITFIELD_SIM_H_20160428
+#define BITFIELD_SIM_H_20160428
+
+#include "bitfield.h"
+
+#include <vector>
+
+// Bus cycles for each type of transaction.
+struct Bitfield_sim_latency
+  {
+    unsigned select, read, write, burst_setup, burst_word;
+
+    Bitfield_sim_latency(
+      unsigned select_ = 1, unsigned read_ = 4, unsigned write_ = 2,
+      unsigned burst_setup_ = 4, unsigned burst_word_ = 1)
+      : select(select_), read(read_), write(write_),
+        burst_setup(burst_setup_), burst_word(burst_word_)
+      { }
+  };
+
+struct Bitfield_sim_counters
+  {
+    unsigned long selects, reads, writes, block_reads, block_writes,
+      block_words, cycles;
+
+    Bitfield_sim_counters() { reset(); }
+
+    void reset()
+      {
+        selects = reads = writes = block_reads = block_writes =
+          block_words = cycles = 0;
+      }
+
+    // Read and write transactions (not counting selects).
+    unsigned long transactions() const
+      { return(reads + writes + block_reads + block_writes); }
+  };
+
+template <typename S_t>
+class Bitfield_sim_device
+  {
+  public:
+
+    typedef S_t Storage_t;
+
+    Bitfield_sim_device(
+      unsigned num_regs,
+      const Bitfield_sim_latency &latency_ = Bitfield_sim_latency())
+      : latency(latency_), reg(num_regs, 0), selected(~unsigned(0))
+      { }
+
+    Bitfield_sim_latency latency;
+
+    Bitfield_sim_counters count;
+
+    // Register values, for setting up and checking (without counting).
+    Storage_t & operator [] (unsigned offset) { return(reg[offset]); }
+
+    unsigned num_regs() const { return(unsigned(reg.size())); }
+
+    Storage_t read(unsigned offset)
+      {
+        select(offset);
+
+        ++count.reads;
+        count.cycles += latency.read;
+
+        return(reg[offset]);
+      }
+
+    void write(unsigned offset, Storage_t t)
+      {
+        select(offset);
+
+        ++count.writes;
+        count.cycles += latency.write;
+
+        reg[offset] = t;
+      }
+
+    void read_block(unsigned offset, unsigned n, Storage_t *dst)
+      {
+        burst(offset, n);
+
+        ++count.block_reads;
+
+        for (unsigned i = 0; i < n; ++i)
+          dst[i] = reg[offset + i];
+      }
+
+    void write_block(unsigned offset, unsigned n, const Storage_t *src)
+      {
+        burst(offset, n);
+
+        ++count.block_writes;
+
+        for (unsigned i = 0; i < n; ++i)
+          reg[offset + i] = src[i];
+      }
+
+  private:
+
+    std::vector<Storage_t> reg;
+
+    unsigned selected;
+
+    void select(unsigned offset)
+      {
+        if (offset != selected)
+          {
+            ++count.selects;
+            count.cycles += latency.select;
+
+            selected = offset;
+          }
+      }
+
+    void burst(unsigned offset, unsigned n)
+      {
+        select(offset);
+
+        count.block_words += n;
+        count.cycles += latency.burst_setup + (n * latency.burst_word);
+      }
+
+  }; // end class Bitfield_sim_device
+
+// Storage access type for Bitfield_sim_device .  If Block is false, the
+// access type does not have read_block() and write_block() , so each
+// register is transferred separately.
+template <typename S_t, bool Block = true>
+class Bitfield_sim_access
+  {
+  public:
+
+    typedef S_t Storage_t;
+
+    Bitfield_sim_access(Bitfield_sim_device<S_t> &d) : dev(&d), offset(0) { }
+
+    void operator += (unsigned ofs) { offset += ofs; }
+
+    Storage_t read() { return(dev->read(offset)); }
+
+    void write(Storage_t t) { dev->write(offset, t); }
+
+  protected:
+
+    Bitfield_sim_device<S_t> *dev;
+
+    unsigned offset;
+
+  }; // end class Bitfield_sim_access
+
+template <typename S_t>
+class Bitfield_sim_access<S_t, true> : public Bitfield_sim_access<S_t, false>
+  {
+  public:
+
+    Bitfield_sim_access(Bitfield_sim_device<S_t> &d)
+      : Bitfield_sim_access<S_t, false>(d)
+      { }
+
+    void read_block(unsigned ofs, unsigned n, S_t *dst)
+      { this->dev->read_block(this->offset + ofs, n, dst); }
+
+    void write_block(unsigned ofs, unsigned n, const S_t *src)
+      { this->dev->write_block(this->offset + ofs, n, src); }
+
+  }; // end class Bitfield_sim_access
+
+template <typename V_t, typename S_t, bool Block = true>
+class Bitfield_traits_sim : public Bitfield_traits_default<V_t, S_t>
+  {
+  public:
+
+    typedef Bitfield_sim_access<S_t, Block> Storage_access_t;
+
+  }; // class Bitfield_traits_sim
+
+#endif // Include once.
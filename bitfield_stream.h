@@ -0,0 +1,487 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Sequential reading and writing of bit fields, one after another, with
+// each storage location read (or written) once.  The bit fields are laid
+// out as for Bitfield<Traits> (in the order given by
+// Traits::Storage_ls_bit_first).  Bits not yet used are kept in an
+// accumulator of type Accum_t (unsigned long long by default, or for
+// example unsigned __int128), which must have at least as many bits as
+// Traits::Storage_t and Traits::Value_t .  A width passed to a member
+// function must not be more than the number of bits in Value_t .
+
+#ifndef BITFIELD_STREAM_H_20160428
+#define BITFIELD_STREAM_H_20160428
+
+#include "bitfield.h"
+
+namespace Bitfield_impl
+{
+
+// Shifts that give zero if the shift is the number of bits in U .
+
+template <typename U>
+inline U shl(U u, unsigned n)
+  { return(n >= Num_bits<U>::Value ? 0 : u << n); }
+
+template <typename U>
+inline U shr(U u, unsigned n)
+  { return(n >= Num_bits<U>::Value ? 0 : u >> n); }
+
+template <class Traits, typename Accum_t>
+class Stream_base
+  {
+  public:
+
+    typedef typename Traits::Value_t Value_t;
+
+    typedef typename Traits::Storage_t Storage_t;
+
+    typedef typename Traits::Storage_access_t Storage_access_t;
+
+    typedef typename Bitfield<Traits>::Field Field;
+
+    // The number of bits read or written.
+    unsigned long position() const { return(pos); }
+
+  protected:
+
+    static const unsigned Storage_bits = Num_bits<Storage_t>::Value;
+
+    static const unsigned Accum_bits = Num_bits<Accum_t>::Value;
+
+    static const bool Ls_first = Traits::Storage_ls_bit_first;
+
+    Stream_base(Storage_access_t sa_) : sa(sa_), acc(0), count(0), pos(0) { }
+
+    // Next storage location to read or write.
+    Storage_access_t sa;
+
+    // count bits not yet used, starting at the LS bit (if Ls_first) or the
+    // MS bit.
+    Accum_t acc;
+
+    unsigned count;
+
+    unsigned long pos;
+
+    static Accum_t amask(unsigned width) { return(mask<Accum_t>(width)); }
+
+    static const bool Uh_oh =
+      (Accum_bits < Storage_bits) || (Accum_bits < Num_bits<Value_t>::Value);
+
+    // If the line following this comment causes a compile error, the
+    // accumulator has fewer bits than Storage_t or Value_t .
+    static int not_used[1 / (Uh_oh ? 0 : 1)];
+  };
+
+} // namespace Bitfield_impl
+
+template <class Traits, typename Accum_t = unsigned long long>
+class Bitfield_stream_reader
+  : public Bitfield_impl::Stream_base<Traits, Accum_t>
+  {
+  private:
+
+    typedef Bitfield_impl::Stream_base<Traits, Accum_t> Base;
+
+    using Base::Storage_bits;
+    using Base::Accum_bits;
+    using Base::Ls_first;
+    using Base::sa;
+    using Base::acc;
+    using Base::count;
+    using Base::pos;
+    using Base::amask;
+
+  public:
+
+    typedef typename Base::Value_t Value_t;
+
+    typedef typename Base::Storage_t Storage_t;
+
+    typedef typename Base::Storage_access_t Storage_access_t;
+
+    typedef typename Base::Field Field;
+
+    // Reads starting at bit first_bit of the storage at base.
+    Bitfield_stream_reader(Storage_access_t base, unsigned first_bit = 0)
+      : Base(base)
+      {
+        sa += first_bit / Storage_bits;
+
+        const unsigned s = first_bit % Storage_bits;
+
+        if (s)
+          {
+            load();
+            drop(s);
+            pos = 0;
+          }
+      }
+
+    // Reads the next field_width bits.
+    Value_t read(unsigned field_width)
+      {
+        if (field_width == 0)
+          return(0);
+
+        while ((count < field_width) &&
+               ((count + Storage_bits) <= Accum_bits))
+          load();
+
+        Accum_t v;
+
+        if (count >= field_width)
+          {
+            v = top(field_width);
+            drop(field_width);
+          }
+        else
+          {
+            // The rest of the bits are in a storage location that does
+            // not fit in the accumulator.
+            const Accum_t w = next();
+
+            const unsigned need = field_width - count;
+
+            if (Ls_first)
+              {
+                v = acc | ((w & amask(need)) << count);
+                acc = Bitfield_impl::shr(w, need);
+              }
+            else
+              {
+                v = Bitfield_impl::shr(acc, Accum_bits - field_width) |
+                    (w >> (Storage_bits - need));
+                acc = Bitfield_impl::shl(w, Accum_bits - Storage_bits + need);
+              }
+
+            count = Storage_bits - need;
+            pos += field_width;
+          }
+
+        return(static_cast<Value_t>(v));
+      }
+
+    // Returns the next field_width bits without moving past them.
+    Value_t peek(unsigned field_width) const
+      {
+        Bitfield_stream_reader r(*this);
+
+        return(r.read(field_width));
+      }
+
+    // Moves past the next num_bits bits.  Whole storage locations that are
+    // skipped are not read.
+    void skip(unsigned long num_bits)
+      {
+        if (num_bits <= count)
+          {
+            drop(unsigned(num_bits));
+            return;
+          }
+
+        num_bits -= count;
+        pos += count;
+        acc = 0;
+        count = 0;
+
+        sa += unsigned(num_bits / Storage_bits);
+        pos += (num_bits / Storage_bits) * Storage_bits;
+
+        const unsigned s = unsigned(num_bits % Storage_bits);
+
+        if (s)
+          {
+            load();
+            drop(s);
+          }
+      }
+
+    // Moves to the next position (relative to the start) that is a
+    // multiple of boundary bits (by default, the start of the next storage
+    // location).
+    void align(unsigned boundary = Storage_bits)
+      {
+        const unsigned long r = pos % boundary;
+
+        if (r)
+          skip(boundary - r);
+      }
+
+    // Reads the bit fields of a record that starts at the current position
+    // and is record_bits long (for example, sizeof(Format) for a format
+    // laid out from the start), leaving the position at the end of the
+    // record.  The fields must be in order of increasing first_bit, and
+    // must not overlap.
+    void read_record(
+      const Field *fields, unsigned num_fields, Value_t *values,
+      unsigned record_bits)
+      {
+        const unsigned long start = pos;
+
+        for (unsigned i = 0; i < num_fields; ++i)
+          {
+            skip(start + fields[i].first_bit - pos);
+            values[i] = read(fields[i].field_width);
+          }
+
+        skip(start + record_bits - pos);
+      }
+
+  private:
+
+    Accum_t next()
+      {
+        Storage_access_t s(sa);
+
+        sa += 1;
+
+        return(static_cast<Accum_t>(s.read()));
+      }
+
+    // Adds a storage location to the accumulator.
+    void load()
+      {
+        const Accum_t w = next();
+
+        if (Ls_first)
+          acc |= w << count;
+        else
+          acc |= w << (Accum_bits - Storage_bits - count);
+
+        count += Storage_bits;
+      }
+
+    // The next n bits in the accumulator (n <= count).
+    Accum_t top(unsigned n) const
+      {
+        if (Ls_first)
+          return(acc & amask(n));
+
+        return(Bitfield_impl::shr(acc, Accum_bits - n));
+      }
+
+    void drop(unsigned n)
+      {
+        if (Ls_first)
+          acc = Bitfield_impl::shr(acc, n);
+        else
+          acc = Bitfield_impl::shl(acc, n);
+
+        count -= n;
+        pos += n;
+      }
+
+  }; // end class Bitfield_stream_reader
+
+// Storage locations are written when they are full, and by flush() .  Bits
+// before the starting position, and after the last bit written, in the
+// storage locations written are unchanged.  The destructor calls flush() .
+template <class Traits, typename Accum_t = unsigned long long>
+class Bitfield_stream_writer
+  : public Bitfield_impl::Stream_base<Traits, Accum_t>
+  {
+  private:
+
+    typedef Bitfield_impl::Stream_base<Traits, Accum_t> Base;
+
+    using Base::Storage_bits;
+    using Base::Accum_bits;
+    using Base::Ls_first;
+    using Base::sa;
+    using Base::acc;
+    using Base::count;
+    using Base::pos;
+    using Base::amask;
+
+  public:
+
+    typedef typename Base::Value_t Value_t;
+
+    typedef typename Base::Storage_t Storage_t;
+
+    typedef typename Base::Storage_access_t Storage_access_t;
+
+    typedef typename Base::Field Field;
+
+    // Writes starting at bit first_bit of the storage at base.
+    Bitfield_stream_writer(Storage_access_t base, unsigned first_bit = 0)
+      : Base(base)
+      {
+        sa += first_bit / Storage_bits;
+
+        const unsigned keep = first_bit % Storage_bits;
+
+        if (keep)
+          {
+            // Keep the bits before the start.
+            Storage_access_t s(sa);
+
+            const Accum_t w = static_cast<Accum_t>(s.read());
+
+            put(Ls_first ? (w & amask(keep)) : (w >> (Storage_bits - keep)),
+                keep);
+
+            pos = 0;
+          }
+      }
+
+    // Writes the field_width LS bits of v (which must fit in them).
+    void write(Value_t v, unsigned field_width)
+      {
+        Accum_t a = static_cast<Accum_t>(v);
+
+        while (field_width)
+          {
+            const unsigned n =
+              field_width < (Accum_bits - count) ?
+                field_width : (Accum_bits - count);
+
+            if (Ls_first)
+              {
+                put(a & amask(n), n);
+                a = Bitfield_impl::shr(a, n);
+              }
+            else
+              put((a >> (field_width - n)) & amask(n), n);
+
+            field_width -= n;
+          }
+      }
+
+    // Writes num_bits zero bits.
+    void zero(unsigned long num_bits)
+      {
+        while (num_bits)
+          {
+            const unsigned n =
+              num_bits < Storage_bits ? unsigned(num_bits) : Storage_bits;
+
+            put(0, n);
+            num_bits -= n;
+          }
+      }
+
+    // Writes zero bits up to the next position (relative to the start)
+    // that is a multiple of boundary bits.
+    void align(unsigned boundary = Storage_bits)
+      {
+        const unsigned long r = pos % boundary;
+
+        if (r)
+          zero(boundary - r);
+      }
+
+    // Writes the bit fields of a record that starts at the current
+    // position and is record_bits long, leaving the position at the end
+    // of the record.  The fields must be in order of increasing first_bit,
+    // and must not overlap.  Bits of the record not in a field are written
+    // as zero.
+    void write_record(
+      const Field *fields, unsigned num_fields, const Value_t *values,
+      unsigned record_bits)
+      {
+        const unsigned long start = pos;
+
+        for (unsigned i = 0; i < num_fields; ++i)
+          {
+            zero(start + fields[i].first_bit - pos);
+            write(values[i], fields[i].field_width);
+          }
+
+        zero(start + record_bits - pos);
+      }
+
+    // Writes the bits in the accumulator into the storage location they
+    // are in, without changing its other bits.  Writing can continue after
+    // a flush.
+    void flush()
+      {
+        if (count == 0)
+          return;
+
+        Storage_access_t s(sa);
+
+        const Accum_t m = piece_mask(count);
+
+        s.write(
+          static_cast<Storage_t>(
+            (static_cast<Accum_t>(s.read()) & ~m) | (word() & m)));
+      }
+
+    ~Bitfield_stream_writer() { flush(); }
+
+  private:
+
+    // Not copyable (each copy would flush).
+    Bitfield_stream_writer(const Bitfield_stream_writer &);
+    Bitfield_stream_writer & operator = (const Bitfield_stream_writer &);
+
+    // Mask for the first n bits of a storage location.
+    static Accum_t piece_mask(unsigned n)
+      {
+        if (Ls_first)
+          return(amask(n));
+
+        return(amask(n) << (Storage_bits - n));
+      }
+
+    // The first storage location's worth of bits in the accumulator.
+    Accum_t word() const
+      {
+        if (Ls_first)
+          return(acc & amask(Storage_bits));
+
+        return(acc >> (Accum_bits - Storage_bits));
+      }
+
+    // Adds n bits (n <= Accum_bits - count) to the accumulator, then writes
+    // any full storage locations.
+    void put(Accum_t bits, unsigned n)
+      {
+        if (Ls_first)
+          acc |= Bitfield_impl::shl(bits, count);
+        else
+          acc |= Bitfield_impl::shl(bits, Accum_bits - count - n);
+
+        count += n;
+        pos += n;
+
+        while (count >= Storage_bits)
+          {
+            Storage_access_t s(sa);
+
+            sa += 1;
+
+            s.write(static_cast<Storage_t>(word()));
+
+            if (Ls_first)
+              acc = Bitfield_impl::shr(acc, Storage_bits);
+            else
+              acc = Bitfield_impl::shl(acc, Storage_bits);
+
+            count -= Storage_bits;
+          }
+      }
+
+  }; // end class Bitfield_stream_writer
+
+#endif // Include once.
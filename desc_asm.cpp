@@ -0,0 +1,46 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitfield.h"
+
+#include <stdint.h>
+
+// This code is for compiling into assembler, to compare accessing a bit
+// field through a Bitfield::Descriptor (offset and width known at run
+// time, with the storage location index, shifts and masks precomputed)
+// with Bitfield::fn() (var_asm.cpp) and Static_bf (offset and width known
+// at compile time).
+
+typedef Bitfield<Bitfield_traits_default<uint64_t, uint8_t> > Bf1;
+typedef Bitfield<Bitfield_traits_default<uint64_t> > Bf2;
+
+Bf1::Value_t r1d(Bf1::Storage_t *p, const Bf1::Descriptor &d)
+  { return(d.read(p)); }
+void w1d(Bf1::Storage_t *p, const Bf1::Descriptor &d, Bf1::Value_t v)
+  { d.write(p, v); }
+
+Bf2::Value_t r2d(Bf2::Storage_t *p, const Bf2::Descriptor &d)
+  { return(d.read(p)); }
+void w2d(Bf2::Storage_t *p, const Bf2::Descriptor &d, Bf2::Value_t v)
+  { d.write(p, v); }
+
+Bf2::Value_t r2s(Bf2::Storage_t *p)
+  { return(Bf2::Static_bf<59, 17>(p).read()); }
+void w2s(Bf2::Storage_t *p, Bf2::Value_t v)
+  { Bf2::Static_bf<59, 17>(p).write(v); }
@@ -17,47 +17,56 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#include "bitfield.h"
+
 #include <stdint.h>
 
-class Example_bitfield_traits
+// Access to 16-bit device registers, which are big endian.  The byte
+// swapping is done by Bitfield_byte_swap_access, below.
+class Example_register_access
   {
-  public:
+  private:
 
-    typedef uint32_t Value_t;
+    static volatile uint8_t & reg_select()
+      { return(*reinterpret_cast<volatile uint8_t *>(0xE0000400)); }
 
-    typedef uint16_t Storage_t;
+    static volatile uint16_t & reg_buffer()
+      { return(*reinterpret_cast<volatile uint16_t *>(0xE0000402)); }
 
-    class Storage_access_t
-      {
-      private:
+    uint16_t reg_offset;
+
+  public:
+
+    typedef uint16_t Storage_t;
 
-        static volatile uint8_t & reg_select()
-          { return(*reinterpret_cast<volatile uint8_t *>(0xE0000400)); }
+    Example_register_access() : reg_offset(0) { }
 
-        static volatile uint16_t & reg_buffer()
-          { return(*reinterpret_cast<volatile uint16_t *>(0xE0000402)); }
+    void operator += (unsigned offset) { reg_offset += offset; }
 
-        uint16_t reg_offset;
+    Storage_t read()
+      {
+        reg_select() = reg_offset;
+        return(reg_buffer());
+      }
 
-      public:
+    void write(Storage_t reg_val)
+      {
+        reg_select() = reg_offset;
+        reg_buffer() = reg_val;
+      }
+  };
 
-        Storage_access_t() : reg_offset(0) { }
+class Example_bitfield_traits
+  {
+  public:
 
-        void operator += (unsigned offset) { reg_offset += offset; }
+    typedef uint32_t Value_t;
 
-        Storage_t read()
-          {
-            reg_select() = reg_offset;
-            Storage_t reg_val = reg_buffer();
-            return((reg_val >> 8) | (reg_val << 8));
-          }
+    typedef uint16_t Storage_t;
 
-        void write(uint8_t reg_val)
-          {
-            reg_select() = reg_offset;
-            reg_buffer() = (reg_val >> 8) | (reg_val << 8);
-          }
-      };
+    typedef Bitfield_byte_swap_access<
+        Example_register_access, Bitfield_big_endian>
+      Storage_access_t;
 
     static const bool Storage_ls_bit_first = true;
 
@@ -66,3 +75,9 @@ class Example_bitfield_traits
     static const bool Fmt_align_at_zero_offset = true;
 
   };
+
+typedef Bitfield<Example_bitfield_traits> Example_bf;
+
+// Reads the 5-bit field at bit 12 of register 3.
+uint32_t example_read()
+  { return(Example_bf::fn(Example_bf::Storage_access_t(), 60, 5)); }
@@ -0,0 +1,58 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitfield_image.h"
+
+#include <stdint.h>
+
+// This code is for compiling into assembler, to see that applying or
+// storing a constant Bitfield_image is only masked stores (of the storage
+// locations with bits in a set bit field) or plain stores.
+
+struct Fmt : public Bitfield_format
+  {
+    F<4> mode;
+    F<12> count;
+    F<20> addr;
+    F<15> pad;
+    F<33> data;
+    F<1> enable;
+    F<7> irq;
+  };
+
+typedef Bitfield_w_fmt<Bitfield<Bitfield_traits_default<uint64_t, uint8_t> >,
+                       Fmt> Bwf8;
+typedef Bitfield_w_fmt<Bitfield<Bitfield_traits_default<uint64_t> >, Fmt>
+  Bwf64;
+
+typedef Bitfield_image<Bwf8> Img8;
+typedef Bitfield_image<Bwf64> Img64;
+
+constexpr Img8 img8 =
+  Img8().set(&Fmt::mode, 0x9).set(&Fmt::addr, 0xabcde).set(&Fmt::irq, 0x7f);
+
+constexpr Img64 img64 =
+  Img64().set(&Fmt::mode, 0x9).set(&Fmt::addr, 0xabcde).
+    set(&Fmt::data, 0x123456789ULL);
+
+void ap8(Bwf8::Storage_t *p) { img8.apply(p); }
+void st8(Bwf8::Storage_t *p) { img8.store(p); }
+
+void ap64(Bwf64::Storage_t *p) { img64.apply(p); }
+void st64(Bwf64::Storage_t *p) { img64.store(p); }
@@ -0,0 +1,81 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitfield.h"
+
+#include <stdint.h>
+
+// This code is for compiling into assembler, to compare the code for a
+// pointer to member as a template argument (C++17) with the code for
+// BITF_S .  The pairs of functions should compile to the same code.
+
+struct Fmt : private Bitfield_format
+  {
+    F<64> pad;
+    F<5> ofs;
+    F<64> data;
+    F<7> ofs2;
+    F<64> pad2;
+  };
+
+typedef Bitfield<Bitfield_traits_default<uint64_t, uint8_t> > Bf11;
+typedef Bitfield_w_fmt<Bf11, Fmt> Bwf11;
+typedef Bitfield<Bitfield_traits_default<uint64_t> > Bf12;
+typedef Bitfield_w_fmt<Bf12, Fmt> Bwf12;
+
+struct Bft21 : Bitfield_traits_default<uint64_t, uint8_t>
+  {
+    static const bool Fmt_offset_from_start = false;
+  };
+typedef Bitfield<Bft21> Bf21;
+typedef Bitfield_w_fmt<Bf21, Fmt> Bwf21;
+
+Bf11::Value_t r11s(Bf11::Storage_t *p)
+  { return(BITF_S(Bwf11, p, data).read()); }
+void w11s(Bf11::Storage_t *p, Bf11::Value_t v)
+  { BITF_S(Bwf11, p, data).write(v); }
+
+Bf12::Value_t r12s(Bf12::Storage_t *p)
+  { return(BITF_S(Bwf12, p, data)); }
+void w12s(Bf12::Storage_t *p, Bf12::Value_t v)
+  { BITF_S(Bwf12, p, data) = v; }
+
+Bf21::Value_t r21s(Bf21::Storage_t *p)
+  { return(BITF_S(Bwf21, p, data).read()); }
+void w21s(Bf21::Storage_t *p, Bf21::Value_t v)
+  { BITF_S(Bwf21, p, data).write(v); }
+
+#if __cplusplus >= 201703L
+
+Bf11::Value_t r11c(Bf11::Storage_t *p)
+  { return(Bf11::f<&Fmt::data>(p).read()); }
+void w11c(Bf11::Storage_t *p, Bf11::Value_t v)
+  { Bf11::f<&Fmt::data>(p).write(v); }
+
+Bf12::Value_t r12c(Bf12::Storage_t *p)
+  { return(Bf12::f<&Fmt::data>(p)); }
+void w12c(Bf12::Storage_t *p, Bf12::Value_t v)
+  { Bf12::f<&Fmt::data>(p) = v; }
+
+Bf21::Value_t r21c(Bf21::Storage_t *p)
+  { return(Bf21::f<&Fmt::data>(p).read()); }
+void w21c(Bf21::Storage_t *p, Bf21::Value_t v)
+  { Bf21::f<&Fmt::data>(p).write(v); }
+
+#endif
@@ -0,0 +1,80 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitfield.h"
+#include "bitfield_pack.h"
+
+#include <stdint.h>
+
+// This code is for compiling into assembler, to compare converting a
+// whole record to and from a struct with BITF_PACK (up) with one BITF
+// access per bit field (ub).
+
+struct Fmt : public Bitfield_format
+  {
+    F<4> mode;
+    F<12> count;
+    F<20> addr;
+    F<12> len;
+    F<1> enable;
+    F<7> irq;
+    F<8> prio;
+  };
+
+struct Rec
+  {
+    uint8_t mode;
+    uint16_t count;
+    uint32_t addr;
+    uint16_t len;
+    uint8_t enable, irq, prio;
+  };
+
+#define REC_FIELDS(X) \
+  X(mode, mode) \
+  X(count, count) \
+  X(addr, addr) \
+  X(len, len) \
+  X(enable, enable) \
+  X(irq, irq) \
+  X(prio, prio)
+
+typedef Bitfield_w_fmt<
+    Bitfield<Bitfield_traits_default<uint32_t, uint16_t> >, Fmt>
+  Bwf1;
+
+BITF_PACK(Rec_pack1, Bwf1, Rec, REC_FIELDS)
+
+typedef Bitfield_w_fmt<
+    Bitfield<Bitfield_traits_default<uint64_t, uint8_t> >, Fmt>
+  Bwf2;
+
+BITF_PACK(Rec_pack2, Bwf2, Rec, REC_FIELDS)
+
+void up1(Bwf1::Storage_t *p, Rec &r) { Rec_pack1::unpack(p, r); }
+void p1(const Rec &r, Bwf1::Storage_t *p) { Rec_pack1::pack(r, p); }
+
+void up2(Bwf2::Storage_t *p, Rec &r) { Rec_pack2::unpack(p, r); }
+void p2(const Rec &r, Bwf2::Storage_t *p) { Rec_pack2::pack(r, p); }
+
+#define X(FIELD_SPEC, MEMBER) r.MEMBER = BITF(Bwf1, p, FIELD_SPEC);
+
+void ub1(Bwf1::Storage_t *p, Rec &r) { REC_FIELDS(X) }
+
+#undef X
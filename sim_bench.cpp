@@ -0,0 +1,257 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Prints the bus transactions and cycles that ways of accessing the bit
+// fields of a register map cost, using the simulated device in
+// bitfield_sim.h .  The output has one line per access pattern:
+//
+// name selects reads writes block_reads block_writes block_words cycles
+//
+// Since the counts do not depend on timing, the output can be compared
+// with saved output to catch changes in the number of transactions.
+
+#include "bitfield.h"
+#include "bitfield_shadow.h"
+#include "bitfield_sim.h"
+
+#include <stdint.h>
+#include <cstdio>
+
+namespace
+{
+
+// Register map of seven 16-bit registers.
+struct Fmt : public Bitfield_format
+  {
+    F<4> mode;
+    F<12> count;
+    F<20> addr;
+    F<12> len;
+    F<1> enable;
+    F<7> irq;
+    F<8> prio;
+    F<32> data;
+    F<16> crc;
+  };
+
+typedef Bitfield<Bitfield_traits_sim<uint32_t, uint16_t> > Bf;
+typedef Bitfield_w_fmt<Bf, Fmt> Bwf;
+
+typedef Bitfield_sim_device<uint16_t> Device;
+typedef Bitfield_sim_access<uint16_t> Access;
+typedef Bitfield_sim_access<uint16_t, false> Single_access;
+
+const unsigned Dim = Bf::Define<Fmt>::Dimension;
+
+template <class Access_t>
+struct Traits_over : public Bitfield_traits_default<uint32_t, uint16_t>
+  {
+    typedef Access_t Storage_access_t;
+  };
+
+template <class Access_t>
+struct Bwf_over
+  {
+    typedef Bitfield_w_fmt<Bitfield<Traits_over<Access_t> >, Fmt> T;
+  };
+
+void report(const char *name, const Device &d)
+  {
+    const Bitfield_sim_counters &c = d.count;
+
+    std::printf(
+      "%-24s %4lu %4lu %4lu %4lu %4lu %4lu %6lu\n", name, c.selects, c.reads,
+      c.writes, c.block_reads, c.block_writes, c.block_words, c.cycles);
+  }
+
+volatile uint32_t sink;
+
+void read_each(Device &d)
+  {
+    Access a(d);
+
+    sink = BITF(Bwf, a, mode);
+    sink = BITF(Bwf, a, count);
+    sink = BITF(Bwf, a, addr);
+    sink = BITF(Bwf, a, len);
+    sink = BITF(Bwf, a, enable);
+    sink = BITF(Bwf, a, irq);
+    sink = BITF(Bwf, a, prio);
+    sink = BITF(Bwf, a, data);
+    sink = BITF(Bwf, a, crc);
+  }
+
+void read_cat(Device &d)
+  {
+    Access a(d);
+
+    sink = BITF_CAT(Bwf, a, count, addr);
+    sink = BITF_CAT(Bwf, a, len, prio);
+  }
+
+void read_fields(Device &d)
+  {
+    const Bf::Field f[] =
+      {
+        BITF_FIELD(Bwf, mode), BITF_FIELD(Bwf, count), BITF_FIELD(Bwf, addr),
+        BITF_FIELD(Bwf, len), BITF_FIELD(Bwf, enable), BITF_FIELD(Bwf, irq),
+        BITF_FIELD(Bwf, prio), BITF_FIELD(Bwf, data), BITF_FIELD(Bwf, crc)
+      };
+
+    uint32_t v[sizeof(f) / sizeof(f[0])];
+
+    Bwf::read_fields(Access(d), f, sizeof(f) / sizeof(f[0]), v);
+
+    sink = v[0];
+  }
+
+template <class A>
+void read_snapshot(Device &d)
+  {
+    typedef Bitfield_snapshot_t<A, Dim> Sa;
+    typedef typename Bwf_over<Sa>::T Bwf_s;
+
+    Bitfield_snapshot_buf<A, Dim> snap((A(d)));
+    Sa a(snap);
+
+    sink = BITF(Bwf_s, a, mode);
+    sink = BITF(Bwf_s, a, addr);
+    sink = BITF(Bwf_s, a, irq);
+    sink = BITF(Bwf_s, a, crc);
+  }
+
+template <class Bwf_t, class A>
+void write_in_order(A a)
+  {
+    BITF(Bwf_t, a, mode) = 1;
+    BITF(Bwf_t, a, count) = 2;
+    BITF(Bwf_t, a, addr) = 3;
+    BITF(Bwf_t, a, len) = 4;
+    BITF(Bwf_t, a, enable) = 1;
+    BITF(Bwf_t, a, irq) = 5;
+    BITF(Bwf_t, a, prio) = 6;
+    BITF(Bwf_t, a, data) = 7;
+    BITF(Bwf_t, a, crc) = 8;
+  }
+
+template <class Bwf_t, class A>
+void write_out_of_order(A a)
+  {
+    BITF(Bwf_t, a, crc) = 8;
+    BITF(Bwf_t, a, mode) = 1;
+    BITF(Bwf_t, a, irq) = 5;
+    BITF(Bwf_t, a, count) = 2;
+    BITF(Bwf_t, a, data) = 7;
+    BITF(Bwf_t, a, addr) = 3;
+  }
+
+void write_each(Device &d) { write_in_order<Bwf>(Access(d)); }
+
+void write_each_out_of_order(Device &d)
+  { write_out_of_order<Bwf>(Access(d)); }
+
+typedef Bitfield_seq_storage_write_t<Access> Seq_access;
+
+void write_seq(Device &d)
+  {
+    Bitfield_seq_storage_write_buf<Access> buf((Access(d)));
+
+    write_in_order<Bwf_over<Seq_access>::T>(Seq_access(buf));
+  }
+
+void write_seq_out_of_order(Device &d)
+  {
+    Bitfield_seq_storage_write_buf<Access> buf((Access(d)));
+
+    write_out_of_order<Bwf_over<Seq_access>::T>(Seq_access(buf));
+  }
+
+template <class A>
+void write_shadow(Device &d)
+  {
+    typedef Bitfield_shadow_t<A> Sa;
+
+    Bitfield_shadow_buf<A> buf(A(d), 0, Dim);
+
+    write_out_of_order<typename Bwf_over<Sa>::T>(Sa(buf));
+  }
+
+template <class A>
+void write_shadow_loaded(Device &d)
+  {
+    typedef Bitfield_shadow_t<A> Sa;
+
+    Bitfield_shadow_buf<A> buf(A(d), 0, Dim);
+
+    buf.load();
+
+    write_out_of_order<typename Bwf_over<Sa>::T>(Sa(buf));
+  }
+
+template <class A>
+void write_combine(Device &d)
+  {
+    typedef Bitfield<Traits_over<A> > Bf_a;
+    typedef typename Bwf_over<A>::T Bwf_a;
+
+    typename Bf_a::template Write_combine<Dim> wc((A(d)));
+
+    wc.write(BITF_FIELD(Bwf_a, crc), 8);
+    wc.write(BITF_FIELD(Bwf_a, mode), 1);
+    wc.write(BITF_FIELD(Bwf_a, irq), 5);
+    wc.write(BITF_FIELD(Bwf_a, count), 2);
+    wc.write(BITF_FIELD(Bwf_a, data), 7);
+    wc.write(BITF_FIELD(Bwf_a, addr), 3);
+    wc.commit();
+  }
+
+void run(const char *name, void (*f)(Device &))
+  {
+    Device d(Dim);
+
+    f(d);
+
+    report(name, d);
+  }
+
+} // end anonymous namespace
+
+int main()
+  {
+    std::printf(
+      "%-24s %4s %4s %4s %4s %4s %4s %6s\n", "pattern", "sel", "rd", "wr",
+      "brd", "bwr", "bwd", "cycles");
+
+    run("read_each", read_each);
+    run("read_cat", read_cat);
+    run("read_fields", read_fields);
+    run("read_snapshot", read_snapshot<Access>);
+    run("read_snapshot_single", read_snapshot<Single_access>);
+    run("write_each", write_each);
+    run("write_each_ooo", write_each_out_of_order);
+    run("write_seq", write_seq);
+    run("write_seq_ooo", write_seq_out_of_order);
+    run("write_shadow_ooo", write_shadow<Access>);
+    run("write_shadow_single_ooo", write_shadow<Single_access>);
+    run("write_shadow_loaded_ooo", write_shadow_loaded<Access>);
+    run("write_combine_ooo", write_combine<Access>);
+    run("write_combine_single_ooo", write_combine<Single_access>);
+
+    return(0);
+  }
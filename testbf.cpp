@@ -18,6 +18,23 @@ SOFTWARE.
 */
 
 #include "bitfield.h"
+#include "bitfield_bulk.h"
+#include "bitfield_array.h"
+#include "bitfield_shadow.h"
+#include "bitfield_sim.h"
+#include "bitfield_pack.h"
+#include "bitfield_schema.h"
+#include "bitfield_stream.h"
+#include "bitfield_mmap.h"
+#include "bitfield_paged.h"
+
+#if __cplusplus >= 201103L
+#include "bitfield_atomic.h"
+#endif
+
+#if __cplusplus >= 201402L
+#include "bitfield_image.h"
+#endif
 
 #include "testloop.h"
 
@@ -26,6 +43,9 @@ SOFTWARE.
 #include <cstdlib>
 #include <cstddef>
 #include <vector>
+#include <cstring>
+#include <algorithm>
+#include <cstdio>
 
 inline bool is_big_endian()
   {
@@ -503,6 +523,51 @@ class Test_value_mask : private Test_base
 
 Test_value_mask test_value_mask;
 
+// Value type narrower than the storage type.  Values must be converted to
+// the storage type before they are shifted into place.
+class Test_narrow_value : private Test_base
+  {
+    typedef Bitfield<Bitfield_traits_default<uint32_t, uint64_t> > Bf;
+
+    // The same value type as the storage type.
+    typedef Bitfield<Bitfield_traits_default<uint64_t, uint64_t> > Wbf;
+
+    virtual bool test()
+      {
+        uint64_t w[2] = { 0, 0 };
+
+        Bf::fn(w, 40, 8) = 0xa5;
+        Bf::fn(w, 60, 12) = 0xabc;
+        Bf::fn(w, 0, 4) |= 9;
+
+        if ((w[0] != 0xc000a50000000009ULL) || (w[1] != 0xab))
+          return(false);
+
+        if ((Bf::fn(w, 40, 8) != 0xa5) || (Bf::fn(w, 60, 12) != 0xabc))
+          return(false);
+
+        uint64_t x[2] = { w[0], w[1] };
+
+        Bf::fn(w, 36, 16) |= 0x0f0f;
+        Wbf::fn(x, 36, 16) |= 0x0f0f;
+        Bf::fn(w, 44, 20) ^= 0xfffff;
+        Wbf::fn(x, 44, 20) ^= 0xfffff;
+        Bf::fn(w, 56, 12) ^= 0x5a5;
+        Wbf::fn(x, 56, 12) ^= 0x5a5;
+
+        (Bf::Static_bf<48, 8>(w)) = 0x3c;
+        (Wbf::Static_bf<48, 8>(x)) = 0x3c;
+        (Bf::Static_bf<40, 12>(w)) |= 0x801;
+        (Wbf::Static_bf<40, 12>(x)) |= 0x801;
+        (Bf::Static_bf<60, 8>(w)) ^= 0x99;
+        (Wbf::Static_bf<60, 8>(x)) ^= 0x99;
+
+        return((w[0] == x[0]) && (w[1] == x[1]));
+      }
+  };
+
+Test_narrow_value test_narrow_value;
+
 class Test_field_offset : private Test_base
   {
     template <unsigned Bw>
@@ -694,6 +759,3013 @@ class Test_base_offset : private Test_base
 
 Test_base_offset test_base_offset;
 
+#if __cplusplus >= 201402L
+
+class Test_constexpr_offset : private Test_base
+  {
+    struct Fmt : public Bitfield_format { F<5> c; F<40> data; F<2> e; };
+
+    struct A : public Bitfield_format { F<12> a; };
+
+    struct D : public A, public Fmt { };
+
+    struct Bft2 : public Bitfield_traits_default<uint64_t, uint8_t>
+      {
+        static const bool Fmt_offset_from_start = false;
+        static const bool Fmt_align_at_zero_offset = false;
+      };
+
+    typedef Bitfield<Bitfield_traits_default<uint64_t, uint8_t> > Bf1;
+
+    typedef Bitfield<Bft2> Bf2;
+
+    typedef Bitfield_w_fmt<Bf1, Fmt> Bwf1;
+
+    typedef Bitfield_w_fmt<Bf2, Fmt> Bwf2;
+
+    typedef Bitfield_w_fmt<Bf1, D> Bwd1;
+
+    typedef Bitfield_w_fmt<Bf2, D> Bwd2;
+
+    // Offsets and widths as template arguments.
+    typedef Bf1::Static_bf<Bf1::field_offset(&Fmt::data),
+                           Bf1::field_width(&Fmt::data)> S1;
+
+    typedef Bf2::Static_bf<Bwd2::base_offset<Fmt>(),
+                           Bf2::field_width(&Fmt::c)> S2;
+
+    static constexpr Bf1::Field f1 =
+      Bf1::Field(Bf1::field_offset(&Fmt::e), Bf1::field_width(&Fmt::e));
+
+    virtual bool test()
+      {
+        if ((Bf1::field_offset(&Fmt::data) != BITF_OFFSET(Bwf1, data)) ||
+            (Bf2::field_offset(&Fmt::data) != BITF_OFFSET(Bwf2, data)) ||
+            (Bf2::field_offset(&Fmt::c) != BITF_OFFSET(Bwf2, c)))
+          return(false);
+
+        if ((S1::offset() != 5) || (S1::width() != 40) || (S2::width() != 5))
+          return(false);
+
+        if ((Bwd1::base_offset<Fmt>() != 12) ||
+            (S2::offset() != 5))
+          return(false);
+
+        if ((f1.first_bit != 45) || (f1.field_width != 2))
+          return(false);
+
+        uint8_t base[8];
+
+        for (unsigned i = 0; i < sizeof(base); ++i)
+          base[i] = uint8_t(0x35 * (i + 1));
+
+        if (S1(base).read() != BITF_S(Bwf1, base, data).read())
+          return(false);
+
+        #if __cplusplus >= 201703L
+
+        if (Bf1::f<&Fmt::data>(base).read() !=
+              BITF_S(Bwf1, base, data).read())
+          return(false);
+
+        if (Bf2::f<&Fmt::e>(base).read() != BITF_S(Bwf2, base, e).read())
+          return(false);
+
+        Bf1::f<&Fmt::c>(base) = 0x15;
+
+        if (BITF(Bwf1, base, c) != 0x15)
+          return(false);
+
+        #endif
+
+        return(true);
+      }
+  };
+
+Test_constexpr_offset test_constexpr_offset;
+
+#endif
+
+namespace Test_static
+{
+
+template <typename V_t, typename S_t = V_t>
+struct Bft_ms : public Bitfield_traits_default<V_t, S_t>
+  {
+    static const bool Storage_ls_bit_first = false;
+  };
+
+// Storage to test a field in, filled with a non-repeating byte pattern.
+template <typename Storage_t>
+struct Pattern
+  {
+    static const unsigned Num_s = 4 * sizeof(uint64_t) / sizeof(Storage_t);
+
+    Storage_t s[Num_s];
+
+    Pattern()
+      {
+        uint8_t *p = reinterpret_cast<uint8_t *>(s);
+
+        for (unsigned i = 0; i < sizeof(s); ++i)
+          p[i] = uint8_t(0x3a + (i * 0x5b));
+      }
+
+    bool operator == (const Pattern &p) const
+      { return(memcmp(s, p.s, sizeof(s)) == 0); }
+  };
+
+// Compares each Static_bf operation with the same Bf operation.
+template <class Bf, unsigned Offset, unsigned Width>
+class Test : private Test_base
+  {
+    typedef typename Bf::Storage_t Storage_t;
+
+    typedef typename Bf::Value_t Value_t;
+
+    typedef typename Bf::template Static_bf<Offset, Width> Sbf;
+
+    typedef Pattern<Storage_t> Pat;
+
+    virtual bool test()
+      {
+        const Value_t v = Value_t(saw(Width, Saw3));
+
+        Pat x, y;
+
+        if (Sbf(x.s).read() != Bf::fn(y.s, Offset, Width).read())
+          return(false);
+
+        if (Sbf(x.s).read_sign_extend() !=
+            Bf::fn(y.s, Offset, Width).read_sign_extend())
+          return(false);
+
+        if ((Sbf::offset() != Offset) || (Sbf::width() != Width))
+          return(false);
+
+        #undef X
+        #define X(OP) \
+        x = Pat(); y = Pat(); \
+        if (Sbf(x.s).OP != Bf::fn(y.s, Offset, Width).OP) \
+          return(false); \
+        if (!(x == y)) \
+          return(false);
+
+        X(write(v))
+        X(write_nvc(v))
+        X(zero())
+        X(b_and(v))
+        X(b_or(v))
+        X(b_xor(v))
+        X(b_comp())
+
+        #undef X
+
+        x = Pat();
+        Sbf(x.s) = v;
+        if (Sbf(x.s) != v)
+          return(false);
+
+        if ((Width < Bitfield_impl::Num_bits<Value_t>::Value) &&
+            Sbf(x.s).write(Value_t(~Value_t(0))))
+          return(false);
+
+        return(true);
+      }
+  };
+
+typedef Bitfield<Bitfield_traits_default<uint32_t, uint8_t> > Bf8_ls;
+typedef Bitfield<Bitfield_traits_default<uint32_t, uint16_t> > Bf16_ls;
+typedef Bitfield<Bitfield_traits_default<uint64_t, uint8_t> > Bf8_64_ls;
+typedef Bitfield<Bitfield_traits_default<uint64_t> > Bf64_ls;
+typedef Bitfield<Bft_ms<uint32_t, uint8_t> > Bf8_ms;
+typedef Bitfield<Bft_ms<uint32_t, uint16_t> > Bf16_ms;
+typedef Bitfield<Bft_ms<uint64_t, uint8_t> > Bf8_64_ms;
+typedef Bitfield<Bft_ms<uint64_t> > Bf64_ms;
+
+#undef X
+#define X(BF) \
+Test<BF, 0, 1> t_##BF##_0_1; \
+Test<BF, 5, 3> t_##BF##_5_3; \
+Test<BF, 5, 4> t_##BF##_5_4; \
+Test<BF, 13, 20> t_##BF##_13_20; \
+Test<BF, 3, 32> t_##BF##_3_32; \
+Test<BF, 64, 32> t_##BF##_64_32;
+
+X(Bf8_ls)
+X(Bf16_ls)
+X(Bf8_ms)
+X(Bf16_ms)
+
+#undef X
+#define X(BF) \
+Test<BF, 69, 64> t_##BF##_69_64; \
+Test<BF, 60, 17> t_##BF##_60_17; \
+Test<BF, 64, 64> t_##BF##_64_64; \
+Test<BF, 7, 1> t_##BF##_7_1;
+
+X(Bf8_64_ls)
+X(Bf64_ls)
+X(Bf8_64_ms)
+X(Bf64_ms)
+
+#undef X
+
+} // end namespace Test_static
+
+namespace Test_descriptor
+{
+
+using Test_static::Pattern;
+
+// Compares each Descriptor operation with the same Bf operation, for all
+// offsets in the first two storage locations and all valid widths.
+template <class Bf>
+class Test : private Test_base
+  {
+    typedef typename Bf::Storage_t Storage_t;
+
+    typedef typename Bf::Value_t Value_t;
+
+    typedef typename Bf::Descriptor Desc;
+
+    typedef typename Bf::Field Field;
+
+    typedef Pattern<Storage_t> Pat;
+
+    static const unsigned Value_bits = Bitfield_impl::Num_bits<Value_t>::Value;
+
+    static const unsigned Storage_bits =
+      Bitfield_impl::Num_bits<Storage_t>::Value;
+
+    bool test1(unsigned offset, unsigned width)
+      {
+        const Desc d(Field(offset, width));
+
+        if ((d.first_bit() != offset) || (d.field_width() != width) ||
+            d.is_width_invalid())
+          return(false);
+
+        Pat x, y;
+
+        if (d.read(x.s) != Bf::fn(y.s, offset, width).read())
+          return(false);
+
+        if (d.read_sign_extend(x.s) !=
+            Bf::fn(y.s, offset, width).read_sign_extend())
+          return(false);
+
+        const Value_t v = Value_t(saw(width, Saw3));
+
+        #undef X
+        #define X(OP, BOP) \
+        x = Pat(); y = Pat(); \
+        if (d.OP != Bf::fn(y.s, offset, width).BOP) \
+          return(false); \
+        if (!(x == y)) \
+          return(false);
+
+        X(write(x.s, v), write(v))
+        X(write_nvc(x.s, v), write_nvc(v))
+        X(zero(x.s), zero())
+        X(b_and(x.s, v), b_and(v))
+        X(b_or(x.s, v), b_or(v))
+        X(b_xor(x.s, v), b_xor(v))
+        X(b_comp(x.s), b_comp())
+
+        #undef X
+
+        x = Pat();
+        if (!d.write(x.s, v) || (d.read(x.s) != v))
+          return(false);
+
+        // A value too big for the field must not be written.
+        if (width < Value_bits)
+          {
+            y = x;
+
+            if (d.write(x.s, Value_t(~Value_t(0))) ||
+                d.b_or(x.s, Value_t(~Value_t(0))) || !(x == y))
+              return(false);
+          }
+
+        return(true);
+      }
+
+    virtual bool test()
+      {
+        for (unsigned offset = 0; offset < (2 * Storage_bits); ++offset)
+          for (unsigned width = 1; width <= Value_bits; ++width)
+            if (!test1(offset, width))
+              return(false);
+
+        // Invalid widths.
+        const Desc tab[] = { Desc(), Desc(3, Value_bits + 1) };
+
+        for (unsigned i = 0; i < (sizeof(tab) / sizeof(tab[0])); ++i)
+          {
+            Pat x;
+
+            if (!tab[i].is_width_invalid() ||
+                (tab[i].read(x.s) != Value_t(~Value_t(0))) ||
+                tab[i].write(x.s, 0) || tab[i].b_or(x.s, 1) ||
+                !(x == Pat()))
+              return(false);
+          }
+
+        return(tab[1].first_bit() == 3);
+      }
+  };
+
+Test<Test_static::Bf8_ls> t_8_ls;
+Test<Test_static::Bf16_ls> t_16_ls;
+Test<Test_static::Bf8_64_ls> t_8_64_ls;
+Test<Test_static::Bf64_ls> t_64_ls;
+Test<Test_static::Bf8_ms> t_8_ms;
+Test<Test_static::Bf16_ms> t_16_ms;
+Test<Test_static::Bf8_64_ms> t_8_64_ms;
+Test<Test_static::Bf64_ms> t_64_ms;
+
+// Value types narrower than int.
+Test<Bitfield<Bitfield_traits_default<uint8_t> > > t_8_8_ls;
+Test<Bitfield<Test_static::Bft_ms<uint16_t, uint8_t> > > t_16_8_ms;
+
+} // end namespace Test_descriptor
+
+namespace Test_read_fields
+{
+
+unsigned num_reads[8];
+
+struct Counting_sa_t
+  {
+    typedef uint16_t Storage_t;
+
+    const uint16_t *p;
+
+    unsigned offset;
+
+    Counting_sa_t(const uint16_t *p_) : p(p_), offset(0) { }
+
+    void operator += (unsigned ofs) { offset += ofs; }
+
+    uint16_t read() { ++num_reads[offset]; return(p[offset]); }
+  };
+
+struct Bft : public Bitfield_traits_default<uint32_t, uint16_t>
+  {
+    typedef Counting_sa_t Storage_access_t;
+  };
+
+typedef Bitfield<Bft> Bf;
+
+class Fmt : private Bitfield_format
+  {
+  public:
+
+    F<5> f1;
+    F<15> f2;
+    F<8> f3;
+    F<18> f4;
+    F<22> f5;
+    F<4> f6;
+    F<8> f7;
+  };
+
+typedef Bitfield_w_fmt<Bf, Fmt> Bwf;
+
+class Test : private Test_base
+  {
+    virtual bool test()
+      {
+        const uint16_t s[5] = { 0x1234, 0xfedc, 0x8765, 0x0f1e, 0xa5c3 };
+
+        const Bf::Field f[] =
+          {
+            BITF_FIELD(Bwf, f6), BITF_FIELD(Bwf, f1), BITF_FIELD(Bwf, f2),
+            BITF_FIELD(Bwf, f3), BITF_FIELD(Bwf, f4), BITF_FIELD(Bwf, f5),
+            BITF_FIELD(Bwf, f7)
+          };
+
+        const unsigned Num_f = sizeof(f) / sizeof(f[0]);
+
+        Bf::Value_t v[Num_f], expected[Num_f];
+
+        for (unsigned i = 0; i < Num_f; ++i)
+          expected[i] = Bf::fn(s, f[i].first_bit, f[i].field_width);
+
+        for (unsigned i = 0; i < 8; ++i)
+          num_reads[i] = 0;
+
+        Bwf::read_fields(Counting_sa_t(s), f, Num_f, v);
+
+        for (unsigned i = 0; i < Num_f; ++i)
+          if (v[i] != expected[i])
+            return(false);
+
+        for (unsigned i = 0; i < 8; ++i)
+          if (num_reads[i] != (i < 5 ? 1 : 0))
+            return(false);
+
+        return(true);
+      }
+  };
+
+Test t;
+
+} // end namespace Test_read_fields
+
+namespace Test_write_combine
+{
+
+unsigned num_reads, num_writes;
+
+struct Counting_sa_t
+  {
+    typedef uint16_t Storage_t;
+
+    uint16_t *p;
+
+    Counting_sa_t(uint16_t *p_) : p(p_) { }
+
+    void operator += (unsigned ofs) { p += ofs; }
+
+    uint16_t read() { ++num_reads; return(*p); }
+
+    void write(uint16_t v) { ++num_writes; *p = v; }
+  };
+
+struct Bft : public Bitfield_traits_default<uint32_t, uint16_t>
+  {
+    typedef Counting_sa_t Storage_access_t;
+  };
+
+typedef Bitfield<Bft> Bf;
+
+using Test_read_fields::Fmt;
+
+typedef Bitfield_w_fmt<Bf, Fmt> Bwf;
+
+class Test : private Test_base
+  {
+    virtual bool test()
+      {
+        uint16_t x[5] = { 0x1234, 0xfedc, 0x8765, 0x0f1e, 0xa5c3 };
+        uint16_t y[5];
+
+        memcpy(y, x, sizeof(x));
+
+        BITF(Bwf, y, f2) = 5;
+        BITF(Bwf, y, f3) = 10;
+        BITF(Bwf, y, f1) |= 0x11;
+        BITF(Bwf, y, f4) &= 0x2aaaa;
+        BITF(Bwf, y, f5).zero();
+        BITF(Bwf, y, f6) = 13;
+        BITF(Bwf, y, f7) = 0xa5;
+
+        num_reads = 0;
+        num_writes = 0;
+
+        Bf::Write_combine<Bf::Define<Fmt>::Dimension> wc(x);
+
+        if (!wc.write(BITF_FIELD(Bwf, f2), 5))
+          return(false);
+        if (!wc.write(BITF_FIELD(Bwf, f3), 10))
+          return(false);
+        if (!wc.b_or(BITF_FIELD(Bwf, f1), 0x11))
+          return(false);
+        if (!wc.b_and(BITF_FIELD(Bwf, f4), 0x2aaaa))
+          return(false);
+        if (!wc.zero(BITF_FIELD(Bwf, f5)))
+          return(false);
+        if (!wc.write(BITF_FIELD(Bwf, f6), 13))
+          return(false);
+        if (!wc.write_nvc(BITF_FIELD(Bwf, f7), 0xa5))
+          return(false);
+        if (wc.write(BITF_FIELD(Bwf, f6), 16))
+          return(false);
+
+        if ((num_reads != 0) || (num_writes != 0))
+          return(false);
+
+        wc.commit();
+
+        // Storage locations 3 and 4 are completely overwritten.
+        if ((num_reads != 3) || (num_writes != 5))
+          return(false);
+
+        if (memcmp(x, y, sizeof(x)) != 0)
+          return(false);
+
+        wc.commit();
+
+        if ((num_reads != 3) || (num_writes != 5))
+          return(false);
+
+        return(true);
+      }
+  };
+
+Test t;
+
+// Value type narrower than the storage type.
+class Test_narrow : private Test_base
+  {
+    typedef Bitfield<Bitfield_traits_default<uint32_t, uint64_t> > Nbf;
+
+    virtual bool test()
+      {
+        uint64_t x[2] = { 0, 0x1111111111111111ULL };
+        uint64_t y[2] = { x[0], x[1] };
+
+        Nbf::fn(y, 40, 8) = 0xa5;
+        Nbf::fn(y, 60, 12) = 0xabc;
+        Nbf::fn(y, 48, 8) |= 0x81;
+        Nbf::fn(y, 66, 6) &= 0x15;
+
+        Nbf::Write_combine<2> wc(x);
+
+        if (!wc.write(Nbf::Field(40, 8), 0xa5) ||
+            !wc.write(Nbf::Field(60, 12), 0xabc) ||
+            !wc.b_or(Nbf::Field(48, 8), 0x81) ||
+            !wc.b_and(Nbf::Field(66, 6), 0x15))
+          return(false);
+
+        wc.commit();
+
+        return(
+          (x[0] == y[0]) && (x[1] == y[1]) &&
+          (x[0] == 0xc081a50000000000ULL));
+      }
+  };
+
+Test_narrow t_narrow;
+
+} // end namespace Test_write_combine
+
+namespace Test_bulk
+{
+
+using Test_static::Bft_ms;
+
+// Fills with a pseudo-random pattern.
+template <typename Storage_t>
+void fill(std::vector<Storage_t> &v)
+  {
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+
+    for (std::size_t i = 0; i < v.size(); ++i)
+      {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        v[i] = Storage_t(x);
+      }
+  }
+
+template <class Bf>
+class Test : private Test_base
+  {
+    typedef typename Bf::Storage_t Storage_t;
+    typedef typename Bf::Value_t Value_t;
+
+    typedef Bitfield_bulk<Bf> Bulk;
+
+    bool test1(
+      const std::vector<Storage_t> &s, std::size_t stride, std::size_t count,
+      unsigned first_bit, unsigned field_width, Bitfield_bulk_isa isa)
+      {
+        std::vector<Value_t> v(count + 1, 0);
+
+        Bulk::read(&s[0], stride, count, first_bit, field_width, &v[0], isa);
+
+        for (std::size_t i = 0; i < count; ++i)
+          if (v[i] !=
+                Bf::fn(const_cast<Storage_t *>(&s[i * stride]), first_bit,
+                       field_width).read())
+            return(false);
+
+        // Must not write past the end.
+        return(v[count] == 0);
+      }
+
+    bool test_write(
+      const std::vector<Storage_t> &s, std::size_t stride, std::size_t count,
+      unsigned first_bit, unsigned field_width, Bitfield_bulk_isa isa)
+      {
+        std::vector<Value_t> v(count + 1);
+        std::vector<Storage_t> exp(s), act(s);
+
+        fill(v);
+
+        for (std::size_t i = 0; i < count; ++i)
+          Bf::fn(&exp[i * stride], first_bit, field_width).write_nvc(v[i]);
+
+        if (!Bulk::write_nvc(
+               &act[0], stride, count, first_bit, field_width, &v[0], isa))
+          return(false);
+
+        if (exp != act)
+          return(false);
+
+        Value_t m = Bitfield_impl::mask<Value_t>(field_width);
+
+        for (std::size_t i = 0; i < count; ++i)
+          v[i] &= m;
+
+        act = s;
+
+        if (!Bulk::write(
+               &act[0], stride, count, first_bit, field_width, &v[0], isa))
+          return(false);
+
+        for (std::size_t i = 0; i < count; ++i)
+          if (Bf::fn(&act[i * stride], first_bit, field_width).read() != v[i])
+            return(false);
+
+        if ((count != 0) && (field_width < Bitfield_impl::Num_bits<Value_t>::Value))
+          {
+            // Nothing is written if any value is too big.
+            v[count / 2] = m + 1;
+
+            act = s;
+
+            if (Bulk::write(
+                  &act[0], stride, count, first_bit, field_width, &v[0],
+                  isa))
+              return(false);
+
+            if (act != s)
+              return(false);
+          }
+
+        return(true);
+      }
+
+    bool test_select(
+      const std::vector<Storage_t> &s, std::size_t stride, std::size_t count,
+      unsigned first_bit, unsigned field_width, Bitfield_bulk_isa isa)
+      {
+        typedef typename Bulk::Predicate Pred;
+
+        std::vector<Value_t> v(count);
+
+        for (std::size_t i = 0; i < count; ++i)
+          v[i] =
+            Bf::fn(const_cast<Storage_t *>(&s[i * stride]), first_bit,
+                   field_width).read();
+
+        const Value_t m = Bitfield_impl::mask<Value_t>(field_width);
+
+        const Value_t a = v[count / 2], b = v[count / 3];
+
+        const Pred pred[] =
+          {
+            Pred::eq(a), Pred::eq(m), Pred::eq(m + 1), Pred::ne(a),
+            Pred::lt(a), Pred::lt(0), Pred::lt(m),
+            Pred::range(a < b ? a : b, a < b ? b : a), Pred::range(a, a),
+            Pred::range(1, 0), Pred::range(0, m),
+            Pred::mask_test(Value_t(0x5555555555555555ULL) & m,
+                            Value_t(0x5555555555555555ULL) & a),
+            Pred::mask_test(0, 0)
+          };
+
+        const std::size_t words = (count + 63) / 64;
+
+        std::vector<unsigned long long> bitmap(words + 1);
+        std::vector<std::size_t> idx(count + 1);
+
+        for (unsigned p = 0; p < (sizeof(pred) / sizeof(pred[0])); ++p)
+          {
+            bitmap.assign(words + 1, 0x5a5a5a5a5a5a5a5aULL);
+            idx.assign(count + 1, ~std::size_t(0));
+
+            const std::size_t n =
+              Bulk::select(
+                &s[0], stride, count, first_bit, field_width, pred[p],
+                &bitmap[0], isa);
+
+            const std::size_t ni =
+              Bulk::select_indexes(
+                &s[0], stride, count, first_bit, field_width, pred[p],
+                &idx[0], isa);
+
+            std::size_t e = 0;
+
+            for (std::size_t i = 0; i < (words * 64); ++i)
+              {
+                const bool sel = (i < count) && pred[p](v[i]);
+
+                if (((bitmap[i / 64] >> (i % 64)) & 1) != sel)
+                  return(false);
+
+                if (sel && (idx[e++] != i))
+                  return(false);
+              }
+
+            // Must not write past the end.
+            if ((n != e) || (ni != e) ||
+                (bitmap[words] != 0x5a5a5a5a5a5a5a5aULL) ||
+                (idx[e] != ~std::size_t(0)))
+              return(false);
+          }
+
+        return(true);
+      }
+
+    virtual bool test()
+      {
+        static const unsigned Sb = Bf::Storage_bits;
+        static const unsigned Vb = Bitfield_impl::Num_bits<Value_t>::Value;
+
+        const unsigned first_bit[] =
+          { 0, 1, 3, Sb - 1, Sb - 3, Sb + 5, (2 * Sb) + 2 };
+
+        const unsigned field_width[] = { 1, 3, 7, Vb / 2, Vb - 1, Vb };
+
+        const std::size_t stride[] = { 1, 2, 3, 4, 7 };
+
+        for (unsigned fb = 0; fb < (sizeof(first_bit) / sizeof(unsigned));
+             ++fb)
+          for (unsigned fw = 0;
+               fw < (sizeof(field_width) / sizeof(unsigned)); ++fw)
+            {
+              unsigned words =
+                (first_bit[fb] + field_width[fw] + Sb - 1) / Sb;
+
+              for (unsigned st = 0;
+                   st < (sizeof(stride) / sizeof(std::size_t)); ++st)
+                {
+                  if (stride[st] < words)
+                    continue;
+
+                  for (std::size_t count = 0; count < 40; count += 13)
+                    {
+                      std::vector<Storage_t> s((count + 1) * stride[st]);
+                      fill(s);
+
+                      for (int isa = Bitfield_bulk_scalar;
+                           isa <= Bitfield_bulk_avx2; ++isa)
+                        if (!test1(
+                               s, stride[st], count, first_bit[fb],
+                               field_width[fw], Bitfield_bulk_isa(isa)) ||
+                            !test_write(
+                               s, stride[st], count, first_bit[fb],
+                               field_width[fw], Bitfield_bulk_isa(isa)))
+                          return(false);
+                    }
+
+                  // Enough records for the select kernels.
+                  for (std::size_t count = 1; count < 300; count += 127)
+                    {
+                      std::vector<Storage_t> s((count + 1) * stride[st]);
+                      fill(s);
+
+                      for (int isa = Bitfield_bulk_scalar;
+                           isa <= Bitfield_bulk_avx2; ++isa)
+                        if (!test_select(
+                               s, stride[st], count, first_bit[fb],
+                               field_width[fw], Bitfield_bulk_isa(isa)))
+                          return(false);
+                    }
+                }
+            }
+
+        return(true);
+      }
+  };
+
+Test<Bitfield<Bitfield_traits_default<uint32_t> > > t32_ls;
+Test<Bitfield<Bft_ms<uint32_t> > > t32_ms;
+Test<Bitfield<Bitfield_traits_default<uint64_t> > > t64_ls;
+Test<Bitfield<Bft_ms<uint64_t> > > t64_ms;
+Test<Bitfield<Bitfield_traits_default<uint32_t, uint8_t> > > t8_ls;
+Test<Bitfield<Bft_ms<uint64_t, uint16_t> > > t16_ms;
+
+// Predicates compare values of a signed Value_t as signed.
+class Test_signed : private Test_base
+  {
+    typedef Bitfield<Bitfield_traits_default<int32_t, uint32_t> > Bitf;
+
+    typedef Bitfield_bulk<Bitf> Bulk;
+
+    typedef Bulk::Predicate Pred;
+
+    static const std::size_t Count = 96;
+
+    static std::size_t select(
+      const std::vector<uint32_t> &s, unsigned first_bit,
+      unsigned field_width, const Pred &pred, Bitfield_bulk_isa isa)
+      {
+        unsigned long long bitmap[(Count + 63) / 64];
+
+        return(
+          Bulk::select(
+            &s[0], 1, Count, first_bit, field_width, pred, bitmap, isa));
+      }
+
+    virtual bool test()
+      {
+        std::vector<uint32_t> s(Count);
+
+        for (int isa = Bitfield_bulk_scalar; isa <= Bitfield_bulk_avx2;
+             ++isa)
+          {
+            for (std::size_t i = 0; i < Count; ++i)
+              Bitf::fn(&s[i], 4, 8) = int32_t(i & 7);
+
+            if ((select(s, 4, 8, Pred::range(3, 5), Bitfield_bulk_isa(isa))
+                   != 36) ||
+                (select(s, 4, 8, Pred::lt(3), Bitfield_bulk_isa(isa)) != 36))
+              return(false);
+
+            // Negative values of a field as wide as Value_t.
+            for (std::size_t i = 0; i < Count; ++i)
+              Bitf::fn(&s[i], 0, 32) = int32_t(i) - 48;
+
+            if ((select(s, 0, 32, Pred::range(-3, 2), Bitfield_bulk_isa(isa))
+                   != 6) ||
+                (select(s, 0, 32, Pred::lt(0), Bitfield_bulk_isa(isa))
+                   != 48) ||
+                (select(s, 0, 32, Pred::lt(-48), Bitfield_bulk_isa(isa))
+                   != 0))
+              return(false);
+          }
+
+        return(true);
+      }
+  };
+
+Test_signed t_signed;
+
+} // end namespace Test_bulk
+
+namespace Test_array
+{
+
+using Test_static::Bft_ms;
+
+template <class Traits, unsigned Width>
+class Test : private Test_base
+  {
+    typedef Bitfield_array<Traits, Width> Array;
+
+    typedef typename Array::Value_t Value_t;
+    typedef typename Array::Storage_t Storage_t;
+    typedef typename Array::Bitfield_t Bf;
+
+    static const unsigned Sb = Array::Storage_bits;
+
+    // Checks every element against Bf::fn() on the whole storage.
+    static bool check(Array &a, const std::vector<Value_t> &v)
+      {
+        if ((a.size() != v.size()) ||
+            (a.num_words() != (((v.size() * Width) + Sb - 1) / Sb)))
+          return(false);
+
+        for (std::size_t i = 0; i < v.size(); ++i)
+          if ((a[i] != v[i]) ||
+              (Bf::fn(a.data() + ((i * Width) / Sb), (i * Width) % Sb, Width).
+                 read() != v[i]))
+            return(false);
+
+        return(true);
+      }
+
+    virtual bool test()
+      {
+        const Value_t m = Bitfield_impl::mask<Value_t>(Width);
+
+        std::vector<Value_t> v(150);
+
+        Test_bulk::fill(v);
+
+        for (std::size_t i = 0; i < v.size(); ++i)
+          v[i] &= m;
+
+        Array a;
+
+        for (std::size_t i = 0; i < v.size(); ++i)
+          if (!a.push_back(v[i]))
+            return(false);
+
+        if (!check(a, v))
+          return(false);
+
+        if ((Width < Bitfield_impl::Num_bits<Value_t>::Value) &&
+            a.push_back(m + 1))
+          return(false);
+
+        if (!check(a, v))
+          return(false);
+
+        // Algorithms through iterators.
+        std::vector<Value_t> sv(v);
+        std::sort(sv.begin(), sv.end());
+        std::sort(a.begin(), a.end());
+
+        if (!check(a, sv))
+          return(false);
+
+        std::reverse(a.begin(), a.end());
+        std::reverse(sv.begin(), sv.end());
+
+        if (!check(a, sv))
+          return(false);
+
+        const Array &ca = a;
+
+        if (!std::equal(ca.begin(), ca.end(), sv.begin()) ||
+            (typename Array::const_iterator(a.end()) - ca.begin() !=
+               std::ptrdiff_t(v.size())))
+          return(false);
+
+        std::copy(v.begin(), v.end(), a.begin());
+
+        if (!check(a, v))
+          return(false);
+
+        // Fill of every sub-range start and length up to beyond a period.
+        for (std::size_t first = 0; first < 9; ++first)
+          for (std::size_t last = first; last < v.size(); last += 7)
+            {
+              Array b(a);
+              std::vector<Value_t> bv(v);
+
+              std::fill(bv.begin() + first, bv.begin() + last, m / 3);
+
+              if (!b.fill(first, last, m / 3) || !check(b, bv))
+                return(false);
+            }
+
+        Array c(37, m);
+
+        if (!check(c, std::vector<Value_t>(37, m)))
+          return(false);
+
+        // Borrowed storage, with a guard value after it.
+        std::vector<Storage_t> st(a.num_words() + 1, Storage_t(~Storage_t(0)));
+
+        Array d(&st[0], 0, v.size());
+
+        for (std::size_t i = 0; i < v.size(); ++i)
+          if (!d.push_back(v[i]))
+            return(false);
+
+        if (d.push_back(0) || !check(d, v) ||
+            (st[a.num_words()] != Storage_t(~Storage_t(0))))
+          return(false);
+
+        std::vector<Value_t> cv(v.size() - 10);
+
+        d.copy_to(10, &cv[0], cv.size());
+
+        if (!std::equal(cv.begin(), cv.end(), v.begin() + 10))
+          return(false);
+
+        std::reverse(cv.begin(), cv.end());
+        std::copy(cv.begin(), cv.end(), v.begin() + 10);
+
+        if (!d.assign(10, &cv[0], cv.size()) || !check(d, v))
+          return(false);
+
+        return(true);
+      }
+  };
+
+Test<Bitfield_traits_default<uint32_t, uint8_t>, 3> t3_8;
+Test<Bitfield_traits_default<uint32_t, uint16_t>, 20> t20_16;
+Test<Bft_ms<uint32_t, uint8_t>, 13> t13_8_ms;
+Test<Bitfield_traits_default<uint64_t>, 64> t64_64;
+Test<Bft_ms<uint64_t, uint32_t>, 45> t45_32_ms;
+Test<Bitfield_traits_default<uint32_t>, 1> t1_32;
+
+} // end namespace Test_array
+
+namespace Test_plain_memory
+{
+
+template <typename V_t, typename S_t>
+struct Bft_ms : public Bitfield_traits_plain_memory<V_t, S_t>
+  {
+    static const bool Storage_ls_bit_first = false;
+  };
+
+// Compares the results of Bitfield_traits_plain_memory (Wb) with those of
+// the same bit order with Bitfield_traits_default (Bf).
+template <class Wb, class Bf>
+class Test : private Test_base
+  {
+    typedef typename Bf::Value_t Value_t;
+    typedef typename Bf::Storage_t Storage_t;
+
+    static const unsigned Sb = Bf::Storage_bits;
+    static const unsigned Vb = Bitfield_impl::Num_bits<Value_t>::Value;
+
+    static const unsigned N = (2 * Vb) / Sb + 2;
+
+    Storage_t w[N], b[N];
+
+    bool same() { return(memcmp(w, b, sizeof(w)) == 0); }
+
+    template <unsigned First_bit, unsigned Width>
+    bool test_static()
+      {
+        typename Wb::template Static_bf<First_bit, Width> wf(w);
+        typename Bf::template Static_bf<First_bit, Width> bf(b);
+
+        Value_t m = Bitfield_impl::mask<Value_t>(Width);
+
+        if (wf.read() != bf.read())
+          return(false);
+
+        wf = m / 3; bf = m / 3;
+        wf |= m / 5; bf |= m / 5;
+        wf ^= m / 9; bf ^= m / 9;
+        wf &= m / 7; bf &= m / 7;
+        wf.b_comp(); bf.b_comp();
+
+        if (!same() || (wf.read() != bf.read()))
+          return(false);
+
+        wf.zero(); bf.zero();
+
+        return(same());
+      }
+
+    virtual bool test()
+      {
+        std::vector<Storage_t> init(N);
+
+        Test_bulk::fill(init);
+
+        memcpy(w, &init[0], sizeof(w));
+        memcpy(b, &init[0], sizeof(b));
+
+        for (unsigned first_bit = 0; first_bit < (Sb + 9); ++first_bit)
+          for (unsigned width = 1; width <= Vb; ++width)
+            {
+              typename Wb::Bf wf = Wb::fn(w, first_bit, width);
+              typename Bf::Bf bf = Bf::fn(b, first_bit, width);
+
+              Value_t m = Bitfield_impl::mask<Value_t>(width);
+
+              if (wf.read() != bf.read())
+                return(false);
+
+              wf = m / 3; bf = m / 3;
+
+              if (!same() || (wf.read() != bf.read()))
+                return(false);
+
+              wf |= m / 5; bf |= m / 5;
+              wf &= ~(m / 7) & m; bf &= ~(m / 7) & m;
+              wf ^= m / 9; bf ^= m / 9;
+              wf.b_comp(); bf.b_comp();
+
+              if (!same() || (wf.read() != bf.read()))
+                return(false);
+
+              if (first_bit & 1)
+                {
+                  wf.zero(); bf.zero();
+                }
+              else
+                {
+                  wf = m; bf = m;
+                }
+
+              if (!same())
+                return(false);
+            }
+
+        return(
+          test_static<Sb - 3, 7>() && test_static<Sb + 5, Vb>() &&
+          test_static<7, Vb - 2>() && test_static<1, 3>());
+      }
+  };
+
+Test<Bitfield<Bitfield_traits_plain_memory<uint64_t, uint8_t> >,
+     Bitfield<Bitfield_traits_default<uint64_t, uint8_t> > > t64_8;
+Test<Bitfield<Bft_ms<uint64_t, uint8_t> >,
+     Bitfield<Test_static::Bft_ms<uint64_t, uint8_t> > > t64_8_ms;
+Test<Bitfield<Bitfield_traits_plain_memory<uint32_t, uint16_t> >,
+     Bitfield<Bitfield_traits_default<uint32_t, uint16_t> > > t32_16;
+Test<Bitfield<Bft_ms<uint64_t, uint16_t> >,
+     Bitfield<Test_static::Bft_ms<uint64_t, uint16_t> > > t64_16_ms;
+Test<Bitfield<Bitfield_traits_plain_memory<uint64_t, uint32_t> >,
+     Bitfield<Bitfield_traits_default<uint64_t, uint32_t> > > t64_32;
+
+// The wide path is used for byte storage, with either bit order.
+int not_used[
+  1 / ((Bitfield_impl::Wide<
+          Bitfield_traits_plain_memory<uint64_t, uint8_t> >::Enabled &&
+        Bitfield_impl::Wide<Bft_ms<uint64_t, uint8_t> >::Enabled) ? 1 : 0)];
+
+} // end namespace Test_plain_memory
+
+namespace Test_bit_offset
+{
+
+template <class Base_traits>
+struct Bft_wide : public Base_traits
+  {
+    typedef std::size_t Bit_offset_t;
+  };
+
+// Compares bit fields past bit 65535, with Bit_offset_t std::size_t, to
+// the same bit fields at a small offset from a base at their first
+// storage location.
+template <class Base_traits>
+class Test : private Test_base
+  {
+    typedef Bitfield<Base_traits> Bf;
+
+    typedef Bitfield<Bft_wide<Base_traits> > Wb;
+
+    typedef typename Bf::Value_t Value_t;
+
+    typedef typename Bf::Storage_t Storage_t;
+
+    static const unsigned Storage_bits = Bf::Storage_bits;
+
+    virtual bool test()
+      {
+        if ((sizeof(typename Bf::Bit_offset_t) != sizeof(unsigned short)) ||
+            (sizeof(typename Wb::Bit_offset_t) != sizeof(std::size_t)))
+          return(false);
+
+        const std::size_t Num_bits = 3 * 65536;
+
+        std::vector<Storage_t> a(Num_bits / Storage_bits);
+
+        Test_bulk::fill(a);
+
+        std::vector<Storage_t> b(a);
+
+        const std::size_t Ofs[] =
+          { 65536 + 3, 70000 - 2, 131072 + 61, Num_bits - 64 };
+
+        const unsigned Width[] = { 1, 13, 64 };
+
+        typedef typename Wb::template Static_bf<70000, 5> Sbf;
+
+        if ((Sbf::offset() != 70000) ||
+            (Sbf(&a[0]).read() != Wb::fn(&a[0], 70000, 5).read()))
+          return(false);
+
+        for (unsigned i = 0; i < (sizeof(Ofs) / sizeof(Ofs[0])); ++i)
+          for (unsigned j = 0; j < (sizeof(Width) / sizeof(Width[0])); ++j)
+            {
+              const std::size_t o = Ofs[i];
+
+              const unsigned w = Width[j];
+
+              Storage_t *pa = &a[0], *pb = &b[0] + (o / Storage_bits);
+
+              const unsigned ob = unsigned(o % Storage_bits);
+
+              if (Wb::fn(pa, o, w).offset() != o)
+                return(false);
+
+              const typename Wb::Descriptor d(o, w);
+
+              if ((d.first_bit() != o) ||
+                  (Wb::fn(pa, o, w).read() != Bf::fn(pb, ob, w).read()) ||
+                  (d.read(pa) != Bf::fn(pb, ob, w).read()))
+                return(false);
+
+              const Value_t v = Value_t(0x5a5a5a5a5a5a5a5aULL) & Bf::mask(w);
+
+              Wb::fn(pa, o, w) = v;
+              Bf::fn(pb, ob, w) = v;
+
+              if (a != b)
+                return(false);
+
+              d.b_xor(pa, Bf::mask(w));
+              Bf::fn(pb, ob, w) ^= Bf::mask(w);
+
+              if (a != b)
+                return(false);
+            }
+
+        return(true);
+      }
+  };
+
+Test<Bitfield_traits_default<uint64_t, uint8_t> > t_8;
+Test<Test_static::Bft_ms<uint64_t, uint16_t> > t_16_ms;
+Test<Bitfield_traits_plain_memory<uint64_t, uint8_t> > t_8_p;
+Test<Test_plain_memory::Bft_ms<uint64_t, uint32_t> > t_32_ms_p;
+
+} // end namespace Test_bit_offset
+
+namespace Test_byte_swap
+{
+
+template <typename S_t, Bitfield_byte_order Order>
+struct Bft : public Bitfield_traits_default<uint64_t, S_t>
+  {
+    typedef Bitfield_byte_swap_access<
+        Bitfield_plain_memory_access<S_t>, Order>
+      Storage_access_t;
+  };
+
+class Test : private Test_base
+  {
+    typedef Bitfield<Bft<uint32_t, Bitfield_big_endian> > Bf32_be;
+    typedef Bitfield<Bft<uint32_t, Bitfield_little_endian> > Bf32_le;
+    typedef Bitfield<Bft<uint16_t, Bitfield_big_endian> > Bf16_be;
+    typedef Bitfield<Bft<uint64_t, Bitfield_big_endian> > Bf64_be;
+    typedef Bitfield<Bft<uint64_t, Bitfield_host_order> > Bf64_host;
+    typedef Bitfield<Bft<uint8_t, Bitfield_big_endian> > Bf8_be;
+
+    virtual bool test()
+      {
+        const uint8_t init[8] =
+          { 0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0 };
+
+        uint8_t b[8];
+        uint16_t w16[4];
+        uint32_t w32[2];
+        uint64_t w64;
+
+        memcpy(w32, init, 8);
+
+        if ((Bf32_be::fn(w32, 0, 8) != 0x78) ||
+            (Bf32_be::fn(w32, 24, 8) != 0x12) ||
+            (Bf32_le::fn(w32, 0, 8) != 0x12) ||
+            (Bf32_le::fn(w32, 24, 8) != 0x78) ||
+            (Bf32_be::fn(w32, 28, 8) != 0x01))
+          return(false);
+
+        Bf32_be::fn(w32, 4, 8) = 0xab;
+
+        memcpy(b, w32, 8);
+
+        if ((b[2] != 0x5a) || (b[3] != 0xb8) || (b[1] != 0x34))
+          return(false);
+
+        memcpy(w16, b, 8);
+
+        if (Bf16_be::fn(w16, 0, 32) != 0x5ab81234)
+          return(false);
+
+        memcpy(&w64, b, 8);
+
+        if ((Bf64_be::fn(&w64, 0, 64) != 0x12345ab89abcdef0ULL) ||
+            (Bf64_host::fn(&w64, 0, 64) != w64))
+          return(false);
+
+        return(Bf8_be::fn(b, 0, 16) == 0x3412);
+      }
+  };
+
+Test t;
+
+// Bulk access, which must go through the storage access type.
+template <typename S_t>
+struct Bft_bulk : public Bitfield_traits_default<S_t, S_t>
+  {
+    typedef Bitfield_byte_swap_access<
+        Bitfield_plain_memory_access<S_t>, Bitfield_big_endian>
+      Storage_access_t;
+  };
+
+Test_bulk::Test<Bitfield<Bft_bulk<uint32_t> > > t_bulk32;
+Test_bulk::Test<Bitfield<Bft_bulk<uint64_t> > > t_bulk64;
+
+} // end namespace Test_byte_swap
+
+namespace Test_shadow
+{
+
+// Storage locations of a simulated device, counting reads and writes.
+
+uint16_t dev[6];
+
+unsigned num_reads, num_writes;
+
+struct Dev_access
+  {
+    typedef uint16_t Storage_t;
+
+    Dev_access() : p(dev) { }
+
+    void operator += (unsigned offset) { p += offset; }
+
+    uint16_t read() { ++num_reads; return(*p); }
+
+    void write(uint16_t t) { ++num_writes; *p = t; }
+
+    uint16_t *p;
+  };
+
+template <bool Wb>
+struct Shadow_traits : public Bitfield_shadow_default_traits
+  {
+    static const bool Write_back = Wb;
+
+    static bool is_volatile(unsigned offset) { return(offset == 3); }
+  };
+
+template <bool Wb>
+class Test : private Test_base
+  {
+    typedef Bitfield_shadow_buf<Dev_access, Shadow_traits<Wb> > Buf;
+
+    struct Bft : public Bitfield_traits_default<uint32_t, uint16_t>
+      {
+        typedef Bitfield_shadow_t<Dev_access, Shadow_traits<Wb> >
+          Storage_access_t;
+      };
+
+    typedef Bitfield<Bft> Bf;
+
+    static bool counts(unsigned r, unsigned w)
+      { return((num_reads == r) && (num_writes == w)); }
+
+    virtual bool test()
+      {
+        for (unsigned i = 0; i < 6; ++i)
+          dev[i] = uint16_t(0x1111 * i);
+
+        num_reads = num_writes = 0;
+
+        {
+          // Cache offsets 1 through 4.
+          Buf buf(Dev_access(), 1, 4);
+
+          Bitfield_shadow_t<Dev_access, Shadow_traits<Wb> > sa(buf);
+
+          // Out of order, each cached word read only once.
+          Bf::fn(sa, 36, 8) = 0xab;
+          Bf::fn(sa, 16, 4) = 0xc;
+          Bf::fn(sa, 20, 20) = 0x12345;
+
+          if (!counts(2, Wb ? 0 : 4) || (buf.is_dirty(2) != Wb) ||
+              !buf.is_valid(1))
+            return(false);
+
+          if ((Bf::fn(sa, 16, 24) != 0x12345c) ||
+              (Bf::fn(sa, 40, 4) != 0xa) ||
+              !counts(2, Wb ? 0 : 4))
+            return(false);
+
+          // Volatile and out of range words are not cached.
+          Bf::fn(sa, 48, 4) = 0;
+          Bf::fn(sa, 48, 4) |= 1;
+          // (Writing a whole storage location does not read it.)
+          Bf::fn(sa, 80, 16) = 0xbeef;
+
+          if (!counts(4, Wb ? 3 : 7) || buf.is_valid(3) ||
+              (dev[3] != 0x3331) || (dev[5] != 0xbeef))
+            return(false);
+
+          buf.flush();
+
+          if (!counts(4, Wb ? 5 : 7) || buf.is_dirty(2) ||
+              (dev[1] != 0x345c) || (dev[2] != 0x2a12))
+            return(false);
+
+          // Discard a change.
+          Bf::fn(sa, 64, 16) = 0x5555;
+          buf.invalidate();
+
+          if ((Bf::fn(sa, 16, 16) != 0x345c) || !counts(5, Wb ? 5 : 8))
+            return(false);
+
+          buf.mark_volatile(1);
+
+          if ((Bf::fn(sa, 16, 16) != 0x345c) || !counts(6, Wb ? 5 : 8))
+            return(false);
+
+          Bf::fn(sa, 32, 4) = 0xf;
+        }
+
+        // Flushed on destruction.
+        return(
+          counts(7, Wb ? 6 : 9) && (dev[2] == 0x2a1f) &&
+          (dev[4] == (Wb ? 0x4444 : 0x5555)));
+      }
+  };
+
+Test<true> t_wb;
+Test<false> t_wt;
+
+// Device access with burst transfers.
+
+unsigned num_block_reads, num_block_writes;
+
+struct Dev_block_access : public Dev_access
+  {
+    void read_block(unsigned offset, unsigned count, uint16_t *dst)
+      {
+        ++num_block_reads;
+        memcpy(dst, p + offset, count * sizeof(uint16_t));
+      }
+
+    void write_block(unsigned offset, unsigned count, const uint16_t *src)
+      {
+        ++num_block_writes;
+        memcpy(p + offset, src, count * sizeof(uint16_t));
+      }
+  };
+
+class Fmt : public Bitfield_format
+  {
+  public:
+
+    F<12> a;
+    F<8> b;
+    F<16> c;
+    F<12> d;
+  };
+
+template <class Sa>
+struct Bft_block : public Bitfield_traits_default<uint32_t, uint16_t>
+  {
+    typedef Sa Storage_access_t;
+  };
+
+class Test_block : private Test_base
+  {
+    typedef Bitfield_shadow_buf<Dev_block_access, Shadow_traits<true> > Buf;
+
+    typedef Bitfield_w_fmt<
+        Bitfield<Bft_block<
+          Bitfield_shadow_t<Dev_block_access, Shadow_traits<true> > > >,
+        Fmt>
+      Bwf_shadow;
+
+    typedef Bitfield<Bft_block<Dev_block_access> > Bf_block;
+
+    static const unsigned Dim = Bf_block::Define<Fmt>::Dimension;
+
+    typedef Bitfield_snapshot_buf<Dev_block_access, Dim> Snap;
+
+    typedef Bitfield_w_fmt<
+        Bitfield<Bft_block<Bitfield_snapshot_t<Dev_block_access, Dim> > >,
+        Fmt>
+      Bwf_snap;
+
+    static bool counts(unsigned r, unsigned w, unsigned br, unsigned bw)
+      {
+        return(
+          (num_reads == r) && (num_writes == w) && (num_block_reads == br) &&
+          (num_block_writes == bw));
+      }
+
+    virtual bool test()
+      {
+        if (Bitfield_impl::Block_transfer<Dev_access>::Has_read_block ||
+            Bitfield_impl::Block_transfer<Dev_access>::Has_write_block ||
+            !Bitfield_impl::Block_transfer<Dev_block_access>::Has_read_block ||
+            !Bitfield_impl::Block_transfer<Dev_block_access>::Has_write_block)
+          return(false);
+
+        for (unsigned i = 0; i < 6; ++i)
+          dev[i] = uint16_t(0x1111 * i);
+
+        num_reads = num_writes = num_block_reads = num_block_writes = 0;
+
+        {
+          Snap snap((Dev_block_access()));
+
+          Bitfield_snapshot_t<Dev_block_access, Dim> sa(snap);
+
+          if ((BITF(Bwf_snap, sa, a) != 0x000) ||
+              (BITF(Bwf_snap, sa, b) != 0x10) ||
+              (BITF(Bwf_snap, sa, c) != 0x2111) ||
+              (BITF(Bwf_snap, sa, d) != 0x222) ||
+              !counts(0, 0, 1, 0))
+            return(false);
+        }
+
+        {
+          // Cache offsets 0 through 4, offset 3 is volatile.
+          Buf buf(Dev_block_access(), 0, 5);
+
+          buf.load();
+
+          if (!counts(0, 0, 3, 0) || !buf.is_valid(4) || buf.is_valid(3))
+            return(false);
+
+          Bitfield_shadow_t<Dev_block_access, Shadow_traits<true> > sa(buf);
+
+          BITF(Bwf_shadow, sa, c) = 0xabcd;
+          BITF(Bwf_shadow, sa, a) = 0x123;
+          Bf_block::fn(Dev_block_access(), 64, 16) = 0;
+        }
+
+        if (!counts(0, 1, 3, 1) || (dev[0] != 0x0123) ||
+            (dev[1] != 0xbcd1) || (dev[2] != 0x222a) || (dev[4] != 0))
+          return(false);
+
+        // Write combining uses write_block() for whole storage locations.
+        {
+          Bf_block::Write_combine<Dim> wc((Dev_block_access()));
+
+          wc.write(Bf_block::Field(0, 32), 0x87654321);
+          wc.write(Bf_block::Field(36, 4), 0xf);
+          wc.commit();
+        }
+
+        return(
+          counts(1, 2, 3, 2) && (dev[0] == 0x4321) && (dev[1] == 0x8765) &&
+          (dev[2] == 0x22fa));
+      }
+  };
+
+Test_block t_block;
+
+} // end namespace Test_shadow
+
+class Test_sim : private Test_base
+  {
+    typedef Bitfield<Bitfield_traits_sim<uint32_t, uint16_t> > Bf;
+
+    virtual bool test()
+      {
+        Bitfield_sim_device<uint16_t> d(4, Bitfield_sim_latency(1, 4, 2, 4));
+
+        d[1] = 0x1234;
+
+        Bitfield_sim_access<uint16_t> a(d);
+
+        // Read then write of register 1, selected once.
+        Bf::fn(a, 20, 8) = 0xab;
+
+        if ((d[1] != 0x1ab4) || (d.count.selects != 1) ||
+            (d.count.reads != 1) || (d.count.writes != 1) ||
+            (d.count.cycles != 7))
+          return(false);
+
+        uint16_t b[3];
+
+        a.read_block(1, 3, b);
+
+        if ((b[0] != 0x1ab4) || (d.count.selects != 1) ||
+            (d.count.block_reads != 1) || (d.count.block_words != 3) ||
+            (d.count.cycles != 14) || (d.count.transactions() != 3))
+          return(false);
+
+        d.count.reset();
+
+        Bf::fn(a, 12, 8) = 0;
+
+        return(
+          (d[0] == 0) && (d[1] == 0x1ab0) && (d.count.selects == 2) &&
+          (d.count.cycles == 14));
+      }
+  };
+
+Test_sim test_sim;
+
+namespace Test_stream
+{
+
+template <typename V_t, typename S_t, bool Ls_first>
+struct Bft : public Bitfield_traits_default<V_t, S_t>
+  {
+    static const bool Storage_ls_bit_first = Ls_first;
+  };
+
+// Compares reading and writing a sequence of fields of pseudo-random
+// widths with Bf.
+template <typename V_t, typename S_t, bool Ls_first, typename Accum_t>
+class Test : private Test_base
+  {
+    typedef Bitfield<Bft<V_t, S_t, Ls_first> > Bf;
+
+    typedef Bitfield_stream_reader<Bft<V_t, S_t, Ls_first>, Accum_t> Reader;
+
+    typedef Bitfield_stream_writer<Bft<V_t, S_t, Ls_first>, Accum_t> Writer;
+
+    static const unsigned Value_bits = Bitfield_impl::Num_bits<V_t>::Value;
+
+    static const unsigned N = 64 * 8 / sizeof(S_t);
+
+    virtual bool test()
+      {
+        S_t a[N], b[N];
+
+        for (unsigned i = 0; i < N; ++i)
+          a[i] = S_t(0x9e3779b97f4a7c15ULL * (i + 1));
+
+        const unsigned Start = 5;
+
+        unsigned w[40];
+        V_t v[40];
+        unsigned bit = Start;
+
+        for (unsigned i = 0; i < 40; ++i)
+          {
+            w[i] = ((i * 7) % Value_bits) + 1;
+            v[i] = Bf::fn(a, bit, w[i]);
+            bit += w[i];
+          }
+
+        Reader r(a, Start);
+
+        for (unsigned i = 0; i < 40; ++i)
+          {
+            if ((r.peek(w[i]) != v[i]) || (r.read(w[i]) != v[i]))
+              return(false);
+          }
+
+        if (r.position() != (bit - Start))
+          return(false);
+
+        // Write into a copy with the field values complemented, compare
+        // with writing with Bf.
+        memcpy(b, a, sizeof(a));
+
+        {
+          Writer wr(b, Start);
+
+          for (unsigned i = 0; i < 40; ++i)
+            wr.write(V_t(~v[i]) & Bf::mask(w[i]), w[i]);
+        }
+
+        bit = Start;
+
+        for (unsigned i = 0; i < 40; ++i)
+          {
+            Bf::fn(a, bit, w[i]) = V_t(~v[i]) & Bf::mask(w[i]);
+            bit += w[i];
+          }
+
+        if (memcmp(a, b, sizeof(a)))
+          return(false);
+
+        // skip and align.
+        Reader r2(a);
+
+        r2.skip(Start + w[0]);
+
+        if (r2.read(w[1]) != (V_t(~v[1]) & Bf::mask(w[1])))
+          return(false);
+
+        const unsigned Storage_bits = Bitfield_impl::Num_bits<S_t>::Value;
+
+        r2.align();
+
+        if (r2.position() % Storage_bits)
+          return(false);
+
+        const unsigned p = unsigned(r2.position()) + (3 * Storage_bits) + 1;
+
+        r2.skip(3 * Storage_bits + 1);
+
+        return(r2.read(3) == Bf::fn(a, p, 3));
+      }
+  };
+
+Test<uint32_t, uint8_t, true, unsigned long long> t1;
+Test<uint32_t, uint8_t, false, unsigned long long> t2;
+Test<uint64_t, uint16_t, true, unsigned long long> t3;
+Test<uint64_t, uint16_t, false, unsigned long long> t4;
+Test<uint32_t, uint32_t, true, unsigned long long> t5;
+Test<uint64_t, uint32_t, false, unsigned long long> t6;
+Test<uint64_t, uint64_t, true, unsigned long long> t7;
+Test<uint64_t, uint64_t, false, unsigned long long> t8;
+
+#if defined(__SIZEOF_INT128__)
+
+Test<uint64_t, uint64_t, true, unsigned __int128> t9;
+Test<uint64_t, uint64_t, false, unsigned __int128> t10;
+
+#endif
+
+// Records of a format.
+class Test_record : private Test_base
+  {
+    struct Fmt : public Bitfield_format
+      {
+        F<3> a;
+        F<10> b;
+        F<2> pad;
+        F<9> c;
+      };
+
+    typedef Bitfield_w_fmt<
+        Bitfield<Bitfield_traits_default<uint32_t, uint8_t> >, Fmt>
+      Bwf;
+
+    virtual bool test()
+      {
+        const Bwf::Field f[3] =
+          { BITF_FIELD(Bwf, a), BITF_FIELD(Bwf, b), BITF_FIELD(Bwf, c) };
+
+        uint8_t s[3 * 5];
+        uint32_t v[5][3], u[3];
+
+        memset(s, 0xff, sizeof(s));
+
+        {
+          Bitfield_stream_writer<Bitfield_traits_default<uint32_t, uint8_t> >
+            wr(s);
+
+          for (unsigned i = 0; i < 5; ++i)
+            {
+              v[i][0] = i;
+              v[i][1] = 1000 - i;
+              v[i][2] = 300 + i;
+
+              wr.write_record(f, 3, v[i], sizeof(Fmt));
+            }
+        }
+
+        Bitfield_stream_reader<Bitfield_traits_default<uint32_t, uint8_t> >
+          r(s);
+
+        for (unsigned i = 0; i < 5; ++i)
+          {
+            if ((BITF(Bwf, s + (i * 3), b) != v[i][1]) ||
+                (BITF(Bwf, s + (i * 3), pad) != 0))
+              return(false);
+
+            r.read_record(f, 3, u, sizeof(Fmt));
+
+            if ((u[0] != v[i][0]) || (u[1] != v[i][1]) || (u[2] != v[i][2]))
+              return(false);
+          }
+
+        return(r.position() == (5 * sizeof(Fmt)));
+      }
+  };
+
+Test_record t_record;
+
+} // end namespace Test_stream
+
+namespace Test_schema
+{
+
+using Test_static::Pattern;
+using Test_static::Bft_ms;
+
+const char Layout[] =
+  "# Example from bitfield_schema.h\n"
+  "hdr {\n"
+  "  len 12\n"
+  "  flags 4\n"
+  "}\n"
+  "ent[2] {   # two entries\n"
+  "  addr 20\n"
+  "  - 4\n"
+  "  prio 8 @ 28\n"
+  "}\n";
+
+// Names and offsets, compares decode() and encode() with Bf .
+template <class Traits>
+class Test : private Test_base
+  {
+    typedef Bitfield<Traits> Bf;
+
+    typedef typename Bf::Storage_t Storage_t;
+
+    typedef typename Bf::Value_t Value_t;
+
+    typedef Pattern<Storage_t> Pat;
+
+    virtual bool test()
+      {
+        Bitfield_schema<Traits> sch;
+
+        if (!sch.load_text(Layout) || !sch.error().empty())
+          return(false);
+
+        static const char * const Name[] =
+          {
+            "hdr.len", "hdr.flags", "ent[0].addr", "ent[0].prio",
+            "ent[1].addr", "ent[1].prio"
+          };
+        static const unsigned Offset[] = { 0, 12, 16, 44, 52, 80 };
+        static const unsigned Width[] = { 12, 4, 20, 8, 20, 8 };
+        const unsigned N = sizeof(Offset) / sizeof(Offset[0]);
+
+        if ((sch.size() != N) || (sch.record_bits() != 88) ||
+            (sch.dimension() != ((88 + Bf::Storage_bits - 1) /
+                                 Bf::Storage_bits)))
+          return(false);
+
+        for (unsigned i = 0; i < N; ++i)
+          if ((sch.name(i) != Name[i]) || (sch.find(Name[i]) != int(i)) ||
+              (sch.field(i).first_bit != Offset[i]) ||
+              (sch.field(i).field_width != Width[i]) ||
+              (sch.descriptor(i).first_bit() != Offset[i]))
+            return(false);
+
+        if ((sch.find("ent[2].addr") != -1) || (sch.find("hdr") != -1))
+          return(false);
+
+        Pat x;
+
+        Value_t v[N];
+
+        sch.decode(x.s, v);
+
+        for (unsigned i = 0; i < N; ++i)
+          if ((v[i] != Bf::fn(x.s, Offset[i], Width[i]).read()) ||
+              (v[i] != sch.bf(x.s, i).read()))
+            return(false);
+
+        Pat y;
+
+        for (unsigned i = 0; i < N; ++i)
+          {
+            v[i] = Value_t(saw(Width[i], Saw3 >> i));
+
+            Bf::fn(y.s, Offset[i], Width[i]) = v[i];
+          }
+
+        if (!sch.encode(x.s, v) || !(x == y))
+          return(false);
+
+        // Nothing is written if a value is too big.
+        v[3] = 0x100;
+
+        return(!sch.encode(x.s, v) && (x == y));
+      }
+  };
+
+Test<Bitfield_traits_default<uint32_t, uint8_t> > t8;
+Test<Bitfield_traits_default<uint64_t, uint16_t> > t16;
+Test<Bft_ms<uint32_t, uint8_t> > t8_ms;
+Test<Bft_ms<uint64_t, uint32_t> > t32_ms;
+
+// Storage locations transferred by decode() and encode() .
+class Test_transfer : private Test_base
+  {
+    virtual bool test()
+      {
+        Bitfield_schema<Bitfield_traits_sim<uint32_t, uint16_t> > sch;
+
+        if (!sch.load_text(Layout) || (sch.dimension() != 6))
+          return(false);
+
+        Bitfield_sim_device<uint16_t> d(6);
+
+        for (unsigned i = 0; i < 6; ++i)
+          d[i] = uint16_t(0x1111 * (i + 1));
+
+        Bitfield_sim_access<uint16_t> a(d);
+
+        uint32_t v[6];
+
+        sch.decode(a, v);
+
+        if ((d.count.block_reads != 1) || (d.count.block_words != 6) ||
+            (d.count.transactions() != 1) || (v[0] != 0x111) ||
+            (v[1] != 1) || (v[2] != 0x32222))
+          return(false);
+
+        d.count.reset();
+
+        v[3] = 0;
+
+        // Storage locations 2, 4 and 5 have bits that are not in any
+        // field, so are read first.
+        if (!sch.encode(a, v) || (d.count.block_reads != 2) ||
+            (d.count.block_writes != 1) || (d.count.block_words != 9) ||
+            (d.count.transactions() != 3))
+          return(false);
+
+        return((d[2] == 0x0333) && (d[3] == 0x4440) && (d[5] == 0x6666));
+      }
+  };
+
+Test_transfer test_transfer;
+
+// Errors, with line numbers.
+class Test_error : private Test_base
+  {
+    virtual bool test()
+      {
+        static const char * const Text[][2] =
+          {
+            { "a 3\nb 33\n", "line 2: invalid width" },
+            { "a 3\na 3\n", "line 2: duplicate name" },
+            { "g {\n a 3\n", "line 1: group not ended with }" },
+            { "a 3\n}\n", "line 2: } without group" },
+            { "a 3 @\n", "line 1: expected @ OFFSET" },
+            { "a[0] 3\n", "line 1: count must not be 0" },
+            { "a 3 $\n", "line 1: unexpected character" },
+            { "a\n", "line 1: expected a width or {" },
+            { "a 3 4\n", "line 1: unexpected text at end of line" },
+            { "g 4 {\n}\n", "line 1: a group has no width" },
+            { "a 8 @ 0xfffc\n", "line 1: offset too big" },
+            { "a[0x1000] 17\n", "line 1: offset too big" }
+          };
+
+        Bitfield_schema<Bitfield_traits_default<uint32_t> > sch;
+
+        for (unsigned i = 0; i < (sizeof(Text) / sizeof(Text[0])); ++i)
+          if (sch.load_text(Text[i][0]) || (sch.error() != Text[i][1]) ||
+              (sch.size() != 0))
+            return(false);
+
+        return(
+          sch.load_text("a 0x10 @ 0x20\n") && (sch.field(0).first_bit == 32) &&
+          (sch.field(0).field_width == 16) &&
+          !sch.load_file("/nonexistent/layout") &&
+          (sch.error() == "cannot open /nonexistent/layout"));
+      }
+  };
+
+Test_error test_error;
+
+} // end namespace Test_schema
+
+namespace Test_pack
+{
+
+using Test_static::Pattern;
+using Test_static::Bft_ms;
+
+struct Fmt : public Bitfield_format
+  {
+    F<4> mode;
+    F<12> count;
+    F<20> addr;
+    F<3> pad;
+    F<33> data;
+    F<1> enable;
+    F<7> irq;
+  };
+
+struct Rec
+  {
+    uint8_t mode;
+    uint16_t count;
+    uint32_t addr;
+    uint64_t data;
+    bool enable;
+    int irq;
+  };
+
+// All but pad.
+#define REC_FIELDS(X) \
+  X(mode, mode) \
+  X(count, count) \
+  X(addr, addr) \
+  X(data, data) \
+  X(enable, enable) \
+  X(irq, irq)
+
+template <typename V_t, typename S_t>
+struct Bft_from_end : public Bitfield_traits_default<V_t, S_t>
+  {
+    static const bool Fmt_offset_from_start = false;
+  };
+
+// Compares unpack(), pack() and update() with BITF .  (BITF_PACK cannot
+// be used with a dependent type, so Pack is defined outside.)
+template <class Bwf, class Pack>
+class Test : private Test_base
+  {
+    typedef typename Bwf::Storage_t Storage_t;
+
+    typedef Pattern<Storage_t> Pat;
+
+    virtual bool test()
+      {
+        Pat x;
+
+        Rec r;
+
+        Pack::unpack(x.s, r);
+
+        #undef X
+        #define X(FIELD_SPEC, MEMBER) \
+        if (typename Bwf::Value_t(r.MEMBER) != BITF(Bwf, x.s, FIELD_SPEC)) \
+          return(false);
+
+        REC_FIELDS(X)
+
+        // Values too big are truncated.
+        r.mode = 0x1f;
+        r.data = 0x3fffffffeULL;
+        r.irq = -1;
+
+        Pat y;
+
+        Pack::update(r, x.s);
+
+        #undef X
+        #define X(FIELD_SPEC, MEMBER) \
+        BITF(Bwf, y.s, FIELD_SPEC) = \
+          typename Bwf::Value_t(r.MEMBER) & \
+          Bwf::mask(BITF_WIDTH(Bwf, FIELD_SPEC));
+
+        REC_FIELDS(X)
+
+        if (!(x == y) || (BITF(Bwf, x.s, mode) != 0xf) ||
+            (BITF(Bwf, x.s, irq) != 0x7f))
+          return(false);
+
+        // Bits not in a mapped bit field (pad, and past the end of the
+        // format in the last storage location) are zeroed by pack().
+        // Storage locations past the record are not changed.
+        Pack::pack(r, x.s);
+
+        BITF(Bwf, y.s, pad) = 0;
+
+        const unsigned End = Pack::Dimension * Bwf::Storage_bits;
+
+        for (unsigned b = sizeof(Fmt); b < End; ++b)
+          Bwf::fn(y.s, b, 1) = 0;
+
+        return(x == y);
+      }
+
+    #undef X
+  };
+
+typedef Bitfield_traits_default<uint64_t, uint8_t> Bft_8;
+typedef Bitfield_traits_default<uint64_t, uint16_t> Bft_16;
+typedef Bitfield_traits_default<uint64_t> Bft_64;
+typedef Bft_ms<uint64_t, uint8_t> Bft_8_ms;
+typedef Bft_ms<uint64_t, uint32_t> Bft_32_ms;
+typedef Bft_from_end<uint64_t, uint16_t> Bft_16_from_end;
+
+#undef X
+#define X(NAME) \
+typedef Bitfield_w_fmt<Bitfield<Bft_##NAME>, Fmt> Bwf_##NAME; \
+BITF_PACK(Pack_##NAME, Bwf_##NAME, Rec, REC_FIELDS) \
+Test<Bwf_##NAME, Pack_##NAME> t_##NAME;
+
+X(8)
+X(16)
+X(64)
+X(8_ms)
+X(32_ms)
+X(16_from_end)
+
+#undef X
+
+typedef Bitfield_w_fmt<
+    Bitfield<Bitfield_traits_sim<uint64_t, uint16_t> >, Fmt>
+  Bwf_sim;
+
+BITF_PACK(Pack_sim, Bwf_sim, Rec, REC_FIELDS)
+
+// Storage locations transferred.
+class Test_transfer : private Test_base
+  {
+    typedef Pack_sim Pack;
+
+    virtual bool test()
+      {
+        Bitfield_sim_device<uint16_t> d(Pack::Dimension);
+
+        Bitfield_sim_access<uint16_t> a(d);
+
+        Rec r;
+
+        Pack::unpack(a, r);
+        Pack::pack(r, a);
+        Pack::update(r, a);
+
+        return(
+          (d.count.block_reads == 2) && (d.count.block_writes == 2) &&
+          (d.count.transactions() == 4) &&
+          (d.count.block_words == (4 * Pack::Dimension)));
+      }
+  };
+
+Test_transfer test_transfer;
+
+} // end namespace Test_pack
+
+namespace Test_mmap
+{
+
+// 59-bit records, so most records do not start on a storage boundary.
+struct Fmt : public Bitfield_format
+  {
+    F<5> a;
+    F<40> b;
+    F<1> c;
+    F<13> d;
+  };
+
+// Bit field of a record, with its offset from the start of the record.
+#define FLD(FIELD_SPEC) \
+  typename Bwf::Field( \
+    BITF_OFFSET_UNALIGNED(Bwf, FIELD_SPEC), BITF_WIDTH(Bwf, FIELD_SPEC))
+
+// Writes records through a read-write mapping, checks the file contents
+// against the same records written to a vector, and reads them back
+// through read-only mappings.
+template <typename S_t>
+class Test : private Test_base
+  {
+    typedef Bitfield<Bitfield_traits_mmap<uint64_t, S_t> > Bf;
+
+    typedef Bitfield_w_fmt<Bf, Fmt> Bwf;
+
+    typedef Bitfield_mmap_records<Bwf> Recs;
+
+    typedef typename Recs::Record Record;
+
+    static const std::size_t Num = 1000;
+
+    static const std::size_t Stride = sizeof(Fmt);
+
+    static const std::size_t Bytes = (((Num * Stride) + 63) / 64 + 2) * 8;
+
+    static uint64_t value(std::size_t i, unsigned f)
+      { return((i * 0x9e3779b97f4a7c15ULL) >> (f * 8)); }
+
+    static void put(const Record &r, std::size_t i)
+      {
+        BITF_W_OFS(Bwf, r.base(), a, r.offset()) = value(i, 0) & 0x1f;
+        BITF_W_OFS(Bwf, r.base(), b, r.offset()) =
+          value(i, 1) & Bf::mask(40);
+        r.field(FLD(c)) = value(i, 2) & 1;
+        r.field(FLD(d)) = value(i, 3) & Bf::mask(13);
+      }
+
+    static bool check(const Record &r, std::size_t i)
+      {
+        return(
+          (BITF_W_OFS(Bwf, r.base(), a, r.offset()) == (value(i, 0) & 0x1f)) &&
+          (BITF_W_OFS(Bwf, r.base(), b, r.offset()) ==
+           (value(i, 1) & Bf::mask(40))) &&
+          (r.field(FLD(c)) == (value(i, 2) & 1)) &&
+          (r.field(FLD(d)) == (value(i, 3) & Bf::mask(13))));
+      }
+
+    virtual bool test()
+      {
+        char path[] = "/tmp/testbf_XXXXXX";
+
+        int fd = mkstemp(path);
+
+        if (fd < 0)
+          return(false);
+
+        close(fd);
+
+        bool ok = test(path);
+
+        unlink(path);
+
+        return(ok);
+      }
+
+    bool test(const char *path)
+      {
+        std::vector<S_t> ref(Bytes / sizeof(S_t));
+
+        {
+          Bitfield_mmap_file f;
+
+          if (!f.open(path, Bitfield_mmap_file::Create |
+                            Bitfield_mmap_file::Huge_pages, 0, Bytes) ||
+              (f.size() != Bytes) ||
+              ((reinterpret_cast<std::size_t>(f.data()) %
+                Bitfield_mmap_file::Huge_page_size) != 0) ||
+              !f.advise(Bitfield_mmap_file::Random))
+            return(false);
+
+          Recs recs(f, Stride, 64);
+
+          if (recs.size() != ((((Bytes * 8) - 64 - Stride) / Stride) + 1))
+            return(false);
+
+          for (std::size_t i = 0; i < Num; ++i)
+            {
+              put(recs[i], i);
+
+              const std::size_t bit = 64 + (i * Stride);
+
+              put(Record(&ref[0] + (bit / Bf::Storage_bits),
+                         unsigned(bit % Bf::Storage_bits)), i);
+            }
+
+          if (std::memcmp(f.data(), &ref[0], Bytes) || !f.sync())
+            return(false);
+        }
+
+        std::FILE *fp = std::fopen(path, "rb");
+
+        if (!fp)
+          return(false);
+
+        std::vector<S_t> file(ref.size());
+
+        const std::size_t n = std::fread(&file[0], 1, Bytes, fp);
+
+        std::fclose(fp);
+
+        if ((n != Bytes) || (file != ref))
+          return(false);
+
+        Bitfield_mmap_file f;
+
+        if (!f.open(path) || (f.size() != Bytes) ||
+            !f.advise(Bitfield_mmap_file::Sequential))
+          return(false);
+
+        Recs recs(f, Stride, 64);
+
+        std::size_t i = 0;
+
+        for (typename Recs::iterator r = recs.begin(); i < Num; ++r, ++i)
+          if ((r.index() != i) || !check(*r, i))
+            return(false);
+
+        // The same records, in a region starting at byte 8.
+        Bitfield_mmap_file f8;
+
+        if (!f8.open(path, Bitfield_mmap_file::Read_only, 8) ||
+            (f8.size() != (Bytes - 8)))
+          return(false);
+
+        Recs recs8(f8, Stride);
+
+        if (recs8.size() != recs.size())
+          return(false);
+
+        for (i = 0; i < Num; ++i)
+          if (!check(recs8[i], i))
+            return(false);
+
+        // With strides that do not divide the region, and with records
+        // that overlap, the last record ends in the region and the next
+        // would not.
+        const std::size_t Bits = (Bytes - 8) * 8;
+
+        const std::size_t St[] = { Stride + 5, 64, 8 };
+
+        for (unsigned k = 0; k < (sizeof(St) / sizeof(St[0])); ++k)
+          {
+            const std::size_t n = Recs(f8, St[k], 3).size();
+
+            if ((n == 0) || ((3 + ((n - 1) * St[k]) + Stride) > Bits) ||
+                ((3 + (n * St[k]) + Stride) <= Bits))
+              return(false);
+          }
+
+        if ((Recs(f8, Stride, Bits - Stride).size() != 1) ||
+            (Recs(f8, Stride, Bits - Stride + 1).size() != 0) ||
+            (Recs(f8, Stride, Bits + 1).size() != 0))
+          return(false);
+
+        // Regions past the end of the file.
+        if (f8.open(path, Bitfield_mmap_file::Read_only, 0, Bytes + 1) ||
+            f8.is_open() || f8.error().empty() ||
+            f8.open(path, Bitfield_mmap_file::Read_write, Bytes + 4096, 8) ||
+            !f8.open(path, Bitfield_mmap_file::Read_only, Bytes - 8, 8))
+          return(false);
+
+        return(
+          !f.open("/nonexistent/testbf") && !f.error().empty() &&
+          !f.is_open() && !f.sync());
+      }
+  };
+
+Test<uint8_t> t_8;
+Test<uint32_t> t_32;
+Test<uint64_t> t_64;
+
+#undef FLD
+
+} // end namespace Test_mmap
+
+namespace Test_paged
+{
+
+using Test_bit_offset::Bft_wide;
+
+template <class Base_traits>
+struct Bft_paged : public Base_traits
+  {
+    typedef Bitfield_paged_t<typename Base_traits::Storage_t> Storage_access_t;
+
+    typedef std::size_t Bit_offset_t;
+  };
+
+// Does the same reads and changes of bit fields in a file, through a cache
+// of four pages, and in a vector, then compares the file to the vector.
+template <class Base_traits>
+class Test : private Test_base
+  {
+    typedef Bitfield<Bft_paged<Base_traits> > Pb;
+
+    typedef Bitfield<Bft_wide<Base_traits> > Wb;
+
+    typedef typename Wb::Value_t Value_t;
+
+    typedef typename Wb::Storage_t Storage_t;
+
+    typedef Bitfield_paged_t<Storage_t> Pa;
+
+    static const unsigned Storage_bits = Wb::Storage_bits;
+
+    static const unsigned Value_bits = Bitfield_impl::Num_bits<Value_t>::Value;
+
+    static const std::size_t Num = 1 << 14;
+
+    // Bytes before the storage in the file.
+    static const off_t Base = 512;
+
+    virtual bool test()
+      {
+        char path[] = "/tmp/testbf_XXXXXX";
+
+        int fd = mkstemp(path);
+
+        if (fd < 0)
+          return(false);
+
+        bool ok = test(fd);
+
+        close(fd);
+        unlink(path);
+
+        return(ok);
+      }
+
+    bool test(int fd)
+      {
+        std::vector<Storage_t> a(Num);
+
+        Test_bulk::fill(a);
+
+        const std::vector<char> hdr(Base, 'h');
+
+        if ((pwrite(fd, &hdr[0], Base, 0) != Base) ||
+            (pwrite(fd, &a[0], Num * sizeof(Storage_t), Base) !=
+             ssize_t(Num * sizeof(Storage_t))))
+          return(false);
+
+        // Past the end of the file, which reads as zeros.
+        a.resize(Num + 256, 0);
+
+        {
+          Bitfield_paged_buf<Storage_t> pb(fd, 64, 4, Base);
+
+          unsigned long r = 12345;
+
+          for (unsigned i = 0; i < 3000; ++i)
+            {
+              r = (r * 1103515245) + 12345;
+
+              const std::size_t o =
+                (r >> 4) % ((a.size() * Storage_bits) - Value_bits);
+
+              const unsigned w = 1 + unsigned((r >> 24) % Value_bits);
+
+              const Value_t v =
+                Value_t(0x5a5a5a5a5a5a5a5aULL * (r >> 16)) & Wb::mask(w);
+
+              if (Pb::fn(Pa(pb), o, w).read() != Wb::fn(&a[0], o, w).read())
+                return(false);
+
+              switch (i % 3)
+                {
+                case 0:
+                  Pb::fn(Pa(pb), o, w) = v;
+                  Wb::fn(&a[0], o, w) = v;
+                  break;
+
+                case 1:
+                  Pb::fn(Pa(pb), o, w) ^= v;
+                  Wb::fn(&a[0], o, w) ^= v;
+                  break;
+
+                default:
+                  break;
+                }
+            }
+
+          Storage_t blk[200];
+
+          Bitfield_impl::Block_transfer<Pa>::read(Pa(pb), 100, 200, blk);
+
+          if (!std::equal(blk, blk + 200, &a[100]))
+            return(false);
+
+          for (unsigned i = 0; i < 200; ++i)
+            blk[i] = Storage_t(~blk[i]);
+
+          Bitfield_impl::Block_transfer<Pa>::write(Pa(pb), 100, 200, blk);
+
+          std::copy(blk, blk + 200, &a[100]);
+
+          if (!pb.flush() || (pb.count.misses < 100) ||
+              (pb.count.page_writes < 100) ||
+              (pb.count.page_reads != pb.count.misses))
+            return(false);
+
+          pb.invalidate();
+
+          // Changes that are not flushed are lost.
+          Pb::fn(Pa(pb), 0, 1) ^= 1;
+
+          pb.invalidate();
+        }
+
+        std::vector<char> h(Base);
+
+        std::vector<Storage_t> b(a.size());
+
+        if ((pread(fd, &h[0], Base, 0) != Base) ||
+            (pread(fd, &b[0], b.size() * sizeof(Storage_t), Base) !=
+             ssize_t(b.size() * sizeof(Storage_t))))
+          return(false);
+
+        if ((h != hdr) || (a != b))
+          return(false);
+
+        Bitfield_paged_buf<Storage_t> bad(-1, 64, 1);
+
+        return(
+          (Pb::fn(Pa(bad), 3, 1).read() == 0) && !bad.good() &&
+          !bad.error().empty());
+      }
+  };
+
+Test<Bitfield_traits_default<uint64_t, uint8_t> > t_8;
+Test<Test_static::Bft_ms<uint64_t, uint16_t> > t_16_ms;
+Test<Bitfield_traits_default<uint32_t, uint32_t> > t_32;
+Test<Test_static::Bft_ms<uint64_t, uint64_t> > t_64_ms;
+
+// Read and write errors must not lose the contents of the file, or changes
+// in the cache.
+class Test_errors : private Test_base
+  {
+    typedef Bitfield<Bitfield_traits_paged<uint32_t, uint32_t> > Pb;
+
+    typedef Bitfield_paged_t<uint32_t> Pa;
+
+    static const std::size_t Bytes = 4 * 64 * sizeof(uint32_t);
+
+    virtual bool test()
+      {
+        char path[] = "/tmp/testbf_XXXXXX";
+
+        int fd = mkstemp(path);
+
+        if (fd < 0)
+          return(false);
+
+        close(fd);
+
+        bool ok = test(path);
+
+        unlink(path);
+
+        return(ok);
+      }
+
+    static bool file_is(const char *path, const std::vector<uint32_t> &a)
+      {
+        std::vector<uint32_t> b(a.size());
+
+        int fd = open(path, O_RDONLY);
+
+        const ssize_t n = pread(fd, &b[0], Bytes, 0);
+
+        close(fd);
+
+        return((n == ssize_t(Bytes)) && (a == b));
+      }
+
+    bool test(const char *path)
+      {
+        std::vector<uint32_t> a(Bytes / sizeof(uint32_t));
+
+        for (std::size_t i = 0; i < a.size(); ++i)
+          a[i] = 0x11111111U * uint32_t((i % 15) + 1);
+
+        int fd = open(path, O_RDWR);
+
+        if (pwrite(fd, &a[0], Bytes, 0) != ssize_t(Bytes))
+          return(false);
+
+        close(fd);
+
+        // A page that cannot be read must not be written over the file.
+        fd = open(path, O_WRONLY);
+
+        {
+          Bitfield_paged_buf<uint32_t> pb(fd, 64, 2);
+
+          Pb::fn(Pa(pb), 4, 4) = 5;
+
+          if (pb.good() || pb.error().empty() ||
+              (Pb::fn(Pa(pb), 4, 4).read() != 0) || pb.flush())
+            return(false);
+        }
+
+        close(fd);
+
+        if (!file_is(path, a))
+          return(false);
+
+        // A page that cannot be written stays changed.
+        fd = open(path, O_RDONLY);
+
+        {
+          Bitfield_paged_buf<uint32_t> pb(fd, 64, 2);
+
+          Pb::fn(Pa(pb), 4, 4) = 5;
+
+          a[0] = (a[0] & ~0xf0U) | 0x50;
+
+          if (pb.flush() || pb.good())
+            return(false);
+
+          // Page 0 is least recently used, but cannot be written, so page
+          // 1 is replaced instead.
+          Pb::fn(Pa(pb), 64 * 32, 1).read();
+          Pb::fn(Pa(pb), 128 * 32, 1).read();
+
+          if (Pb::fn(Pa(pb), 4, 4).read() != 5)
+            return(false);
+
+          // With both pages changed, page 3 is not cached, and writes to
+          // it are lost.
+          Pb::fn(Pa(pb), (128 * 32) + 8, 4) = 0xa;
+
+          a[128] = (a[128] & ~0xf00U) | 0xa00;
+
+          const uint32_t Page_3 = a[192] & 0xff;
+
+          if (Pb::fn(Pa(pb), 192 * 32, 8).read() != Page_3)
+            return(false);
+
+          Pb::fn(Pa(pb), 192 * 32, 8) = ~Page_3 & 0xff;
+
+          if ((Pb::fn(Pa(pb), 192 * 32, 8).read() != Page_3) ||
+              (Pb::fn(Pa(pb), 4, 4).read() != 5) ||
+              (Pb::fn(Pa(pb), (128 * 32) + 8, 4).read() != 0xa))
+            return(false);
+
+          // Once the file can be written, so are the changes.
+          int w = open(path, O_RDWR);
+
+          dup2(w, fd);
+          close(w);
+
+          pb.clear_error();
+
+          if (!pb.flush() || (pb.count.page_writes != 2))
+            return(false);
+        }
+
+        close(fd);
+
+        return(file_is(path, a));
+      }
+  };
+
+Test_errors t_errors;
+
+} // end namespace Test_paged
+
+#if __cplusplus >= 201402L
+
+namespace Test_image
+{
+
+using Test_static::Pattern;
+using Test_static::Bft_ms;
+
+struct Base : public Bitfield_format
+  {
+    F<4> mode;
+    F<12> count;
+    F<20> addr;
+    F<5> e[3];
+    F<33> data;
+    F<1> enable;
+    F<7> irq;
+  };
+
+// Not standard layout, only for set() with pointers to members.
+struct Derived : public Base { };
+
+template <typename V_t, typename S_t>
+struct Bft_from_end : public Bitfield_traits_default<V_t, S_t>
+  {
+    static const bool Fmt_offset_from_start = false;
+    static const bool Fmt_align_at_zero_offset = false;
+  };
+
+// Compares apply() and store() with BITF .
+template <class Bf>
+class Test : private Test_base
+  {
+    typedef Bitfield_w_fmt<Bf, Base> Bwf;
+
+    typedef typename Bwf::Storage_t Storage_t;
+
+    typedef Pattern<Storage_t> Pat;
+
+    typedef Bitfield_image<Bwf> Img;
+
+    typedef Bitfield_image<Bitfield_w_fmt<Bf, Derived> > Img_d;
+
+    virtual bool test()
+      {
+        // The second value of mode replaces the first.
+        constexpr Img img =
+          Img().set(&Base::mode, 0x9).set(&Base::addr, 0xabcde).
+            set(BITF_FIELD(Bwf, e[1]), 0x13).set(&Base::data, 0x123456789ULL).
+            set(&Base::irq, 0x7f).set(&Base::mode, 0x5);
+
+        constexpr Img_d img_d =
+          Img_d().set(&Derived::mode, 0x5).set(&Derived::addr, 0xabcde).
+            set(&Derived::data, 0x123456789ULL).set(&Base::irq, 0x7f);
+
+        Pat x, y;
+
+        img.apply(x.s);
+
+        BITF(Bwf, y.s, mode) = 0x5;
+        BITF(Bwf, y.s, addr) = 0xabcde;
+        BITF(Bwf, y.s, e[1]) = 0x13;
+        BITF(Bwf, y.s, data) = 0x123456789ULL;
+        BITF(Bwf, y.s, irq) = 0x7f;
+
+        if (!(x == y))
+          return(false);
+
+        // Bits not in a set bit field are zero.
+        Pat z;
+
+        img.store(z.s);
+
+        for (unsigned i = 0; i < Img::Dimension; ++i)
+          if ((z.s[i] != (y.s[i] & img.mask(i))) ||
+              (img.word(i) != z.s[i]))
+            return(false);
+
+        for (unsigned i = Img::Dimension; i < Pat::Num_s; ++i)
+          if (z.s[i] != Pat().s[i])
+            return(false);
+
+        BITF(Bwf, y.s, e[1]) = 0;
+
+        Pat w;
+
+        img_d.apply(w.s);
+
+        BITF(Bwf, w.s, e[1]) = 0;
+
+        return(w == y);
+      }
+  };
+
+Test<Bitfield<Bitfield_traits_default<uint64_t, uint8_t> > > t_8;
+Test<Bitfield<Bitfield_traits_default<uint64_t, uint16_t> > > t_16;
+Test<Bitfield<Bitfield_traits_default<uint64_t> > > t_64;
+Test<Bitfield<Bft_ms<uint64_t, uint8_t> > > t_8_ms;
+Test<Bitfield<Bft_ms<uint64_t, uint32_t> > > t_32_ms;
+Test<Bitfield<Bft_from_end<uint64_t, uint16_t> > > t_16_from_end;
+
+// Storage locations accessed by apply() .
+class Test_transfer : private Test_base
+  {
+    typedef Bitfield_w_fmt<
+        Bitfield<Bitfield_traits_sim<uint64_t, uint16_t> >, Base>
+      Bwf;
+
+    typedef Bitfield_image<Bwf> Img;
+
+    virtual bool test()
+      {
+        // mode and count fill the first storage location, addr is in the
+        // second and third, and irq in the last.
+        constexpr Img img =
+          Img().set(&Base::mode, 1).set(&Base::count, 2).
+            set(&Base::addr, 3).set(&Base::irq, 4);
+
+        Bitfield_sim_device<uint16_t> d(Img::Dimension);
+
+        Bitfield_sim_access<uint16_t> a(d);
+
+        img.apply(a);
+
+        if ((d.count.reads != 2) || (d.count.writes != 4) ||
+            (d[0] != 0x0021) || (d[1] != 0x0003))
+          return(false);
+
+        d.count.reset();
+
+        img.store(a);
+
+        return(
+          (d.count.transactions() == 1) &&
+          (d.count.block_words == Img::Dimension));
+      }
+  };
+
+Test_transfer test_transfer;
+
+} // end namespace Test_image
+
+#endif
+
+#if __cplusplus >= 201103L
+
+namespace Test_atomic
+{
+
+using Test_static::Bft_ms;
+
+template <class Traits>
+class Test : private Test_base
+  {
+    typedef typename Traits::Value_t Value_t;
+    typedef typename Traits::Storage_t Storage_t;
+
+    typedef Bitfield<Traits> Abf;
+
+    // Plain counterpart.
+    struct Pt : public Traits
+      {
+        typedef typename Bitfield_traits_default<Value_t, Storage_t>::
+          Storage_access_t Storage_access_t;
+      };
+
+    typedef Bitfield<Pt> Pbf;
+
+    static const unsigned N = 16;
+
+    std::atomic<Storage_t> a[N];
+    Storage_t p[N];
+
+    bool same()
+      {
+        for (unsigned i = 0; i < N; ++i)
+          if (a[i].load() != p[i])
+            return(false);
+
+        return(true);
+      }
+
+    bool test_field(unsigned first_bit, unsigned width)
+      {
+        typename Abf::Bf af = Abf::fn(a, first_bit, width);
+        typename Pbf::Bf pf = Pbf::fn(p, first_bit, width);
+
+        Value_t m = Bitfield_impl::mask<Value_t>(width);
+
+        af = m / 3; pf = m / 3;
+
+        if (!same() || (af.read() != pf.read()))
+          return(false);
+
+        af |= m / 5; pf |= m / 5;
+        af &= ~(m / 7) & m; pf &= ~(m / 7) & m;
+        af ^= m / 9; pf ^= m / 9;
+
+        if (!same())
+          return(false);
+
+        af.b_comp(); pf.b_comp();
+
+        if (!same())
+          return(false);
+
+        af.zero(); pf.zero();
+
+        return(same());
+      }
+
+    template <unsigned First_bit, unsigned Width>
+    bool test_static()
+      {
+        typename Abf::template Static_bf<First_bit, Width> af(a);
+        typename Pbf::template Static_bf<First_bit, Width> pf(p);
+
+        Value_t m = Bitfield_impl::mask<Value_t>(Width);
+
+        af = m / 3; pf = m / 3;
+        af |= m / 5; pf |= m / 5;
+        af ^= m / 9; pf ^= m / 9;
+        af &= m / 7; pf &= m / 7;
+        af.b_comp(); pf.b_comp();
+
+        if (!same() || (af.read() != pf.read()))
+          return(false);
+
+        af.zero(); pf.zero();
+
+        return(same());
+      }
+
+    // Changes bit 0 of the first storage location (as another thread
+    // could) between reading and writing it the first time it is called,
+    // forcing the compare-exchange to be retried.
+    struct Interfere
+      {
+        std::atomic<Storage_t> *w;
+
+        unsigned *calls;
+
+        void operator () (
+          typename Traits::Storage_access_t s, unsigned storage_shift,
+          unsigned, unsigned storage_width)
+          {
+            Storage_t v = s.read();
+
+            if ((*calls)++ == 0)
+              w->fetch_or(1);
+
+            s.write(
+              static_cast<Storage_t>(
+                (v &
+                 ~(Bitfield_impl::mask<Storage_t>(storage_width)
+                     << storage_shift)) |
+                (Storage_t(5) << storage_shift)));
+          }
+      };
+
+    virtual bool test()
+      {
+        for (unsigned i = 0; i < N; ++i)
+          {
+            p[i] = Storage_t(0x5a5a5a5a5a5a5a5aULL >> i);
+            a[i] = p[i];
+          }
+
+        static const unsigned Sb = Bitfield_impl::Num_bits<Storage_t>::Value;
+        static const unsigned Vb = Bitfield_impl::Num_bits<Value_t>::Value;
+
+        if (!test_field(3, 1) || !test_field(Sb - 2, 5) ||
+            !test_field(Sb + 1, Vb) || !test_field(0, Sb))
+          return(false);
+
+        if (!test_static<3, 1>() || !test_static<Sb - 2, 5>() ||
+            !test_static<Sb + 1, Vb>() || !test_static<0, Sb>())
+          return(false);
+
+        a[0] = 0;
+
+        unsigned calls = 0;
+
+        Interfere m = { a, &calls };
+
+        Abf::fn(a, 4, 3).modify_nvc(m);
+
+        Storage_t expected = 1;
+        Pbf::fn(&expected, 4, 3) = 5;
+
+        return((calls == 2) && (a[0].load() == expected));
+      }
+  };
+
+Test<Bitfield_traits_atomic<uint32_t, uint8_t> > t8;
+Test<Bitfield_traits_atomic<uint64_t, uint16_t> > t16;
+
+template <typename V_t, typename S_t>
+struct Bft_ms_acq_rel
+  : public Bitfield_traits_atomic<
+      V_t, S_t, std::memory_order_acquire, std::memory_order_acq_rel>
+  {
+    static const bool Storage_ls_bit_first = false;
+  };
+
+Test<Bft_ms_acq_rel<uint32_t, uint32_t> > t32_ms;
+Test<Bft_ms_acq_rel<uint64_t, uint64_t> > t64_ms;
+
+class Test_fields : private Test_base
+  {
+    struct Fmt : public Bitfield_format
+      { F<5> a; F<20> state; F<30> version; F<5> other; F<10> b; F<8> c; };
+
+    typedef Bitfield<Bitfield_traits_atomic<uint64_t> > Abf;
+
+    typedef Bitfield_w_fmt<Abf, Fmt> Bwf;
+
+    typedef Bitfield_atomic_fields<Bwf> Baf;
+
+    virtual bool test()
+      {
+        std::atomic<uint64_t> r[2];
+        r[0] = 0;
+        r[1] = 0;
+
+        BITF(Bwf, r, state) = 3;
+        BITF(Bwf, r, version) = 7;
+        BITF(Bwf, r, other) = 0x15;
+
+        Bwf::Field f[2] = { BITF_FIELD(Bwf, state), BITF_FIELD(Bwf, version) };
+
+        uint64_t expected[2] = { 3, 7 }, desired[2] = { 4, 8 };
+
+        if (!Baf::is_single_unit(f, 2) ||
+            !Baf::compare_exchange(r, f, 2, expected, desired) ||
+            (BITF(Bwf, r, state) != 4) || (BITF(Bwf, r, version) != 8) ||
+            (BITF(Bwf, r, other) != 0x15))
+          return(false);
+
+        // Mismatch.
+        desired[1] = 9;
+
+        if (Baf::compare_exchange(r, f, 2, expected, desired) ||
+            (expected[0] != 4) || (expected[1] != 8) ||
+            (BITF(Bwf, r, version) != 8))
+          return(false);
+
+        // Value too big.
+        desired[0] = 1 << 20;
+
+        if (Baf::compare_exchange(r, f, 2, expected, desired) ||
+            (expected[0] != 4) || (BITF(Bwf, r, state) != 4))
+          return(false);
+
+        // Fields in different storage locations.
+        Bwf::Field g[2] = { BITF_FIELD(Bwf, state), BITF_FIELD(Bwf, c) };
+
+        desired[0] = 5;
+
+        if (Baf::is_single_unit(g, 2) ||
+            Baf::compare_exchange(r, g, 2, expected, desired) ||
+            (BITF(Bwf, r, state) != 4))
+          return(false);
+
+        // Field straddling storage locations.
+        Bwf::Field h[1] = { BITF_FIELD(Bwf, b) };
+
+        return(!Baf::is_single_unit(h, 1));
+      }
+  };
+
+Test_fields test_fields;
+
+// Compiling with -mcx16 (and linking with -latomic) gives cmpxchg16b.
+#ifdef __GCC_HAVE_SYNC_COMPARE_AND_SWAP_16
+
+// Fields of a 128-bit storage location, one straddling its halves.
+class Test_fields_128 : private Test_base
+  {
+    struct Fmt : public Bitfield_format
+      { F<30> a; F<50> state; F<40> version; F<8> other; };
+
+    typedef Bitfield<Bitfield_traits_atomic<uint64_t, unsigned __int128> >
+      Abf;
+
+    typedef Bitfield_w_fmt<Abf, Fmt> Bwf;
+
+    typedef Bitfield_atomic_fields<Bwf> Baf;
+
+    virtual bool test()
+      {
+        std::atomic<unsigned __int128> r[1];
+        r[0] = 0;
+
+        BITF(Bwf, r, state) = 3;
+        BITF(Bwf, r, version) = 7;
+        BITF(Bwf, r, other) = 0x15;
+
+        Bwf::Field f[2] = { BITF_FIELD(Bwf, state), BITF_FIELD(Bwf, version) };
+
+        const uint64_t Big = (1ULL << 49) | 1;
+
+        uint64_t expected[2] = { 3, 7 }, desired[2] = { Big, 8 };
+
+        if (!Baf::is_single_unit(f, 2) ||
+            !Baf::compare_exchange(r, f, 2, expected, desired) ||
+            (BITF(Bwf, r, state) != Big) || (BITF(Bwf, r, version) != 8) ||
+            (BITF(Bwf, r, other) != 0x15))
+          return(false);
+
+        // Mismatch.
+        desired[1] = 9;
+
+        if (Baf::compare_exchange(r, f, 2, expected, desired) ||
+            (expected[0] != Big) || (expected[1] != 8) ||
+            (BITF(Bwf, r, version) != 8))
+          return(false);
+
+        // Value too big.
+        desired[0] = 1ULL << 50;
+
+        return(
+          !Baf::compare_exchange(r, f, 2, expected, desired) &&
+          (expected[0] == Big) && (BITF(Bwf, r, state) == Big));
+      }
+  };
+
+Test_fields_128 test_fields_128;
+
+#endif
+
+} // end namespace Test_atomic
+
+#endif
+
 namespace Test_write_seq
 {
 
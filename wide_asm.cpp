@@ -0,0 +1,73 @@
+/*
+Copyright (c) 2016 Walter William Karas
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "bitfield.h"
+
+#include <stdint.h>
+#include <cstddef>
+
+// This code is for compiling into assembler, to compare the code for bit
+// fields with offsets that are not known at compile time, with the
+// default offsets (unsigned short) and with Bit_offset_t std::size_t
+// (functions with names ending in w).  Computing the storage location
+// and the offset in it should still be a shift and a mask.
+
+template <class Base_traits>
+struct Wide_traits : public Base_traits
+  {
+    typedef std::size_t Bit_offset_t;
+  };
+
+typedef Bitfield_traits_default<uint32_t> Bft1;
+typedef Bitfield<Bft1> Bf1;
+typedef Bitfield<Wide_traits<Bft1> > Bf1w;
+
+typedef Bitfield_traits_plain_memory<uint64_t, uint8_t> Bft2;
+typedef Bitfield<Bft2> Bf2;
+typedef Bitfield<Wide_traits<Bft2> > Bf2w;
+
+Bf1::Value_t r1(Bf1::Storage_t *p, unsigned ofs)
+  { return(Bf1::fn(p, ofs, 7).read()); }
+void w1(Bf1::Storage_t *p, unsigned ofs, Bf1::Value_t v)
+  { Bf1::fn(p, ofs, 7) = v; }
+
+Bf1w::Value_t r1w(Bf1w::Storage_t *p, std::size_t ofs)
+  { return(Bf1w::fn(p, ofs, 7).read()); }
+void w1w(Bf1w::Storage_t *p, std::size_t ofs, Bf1w::Value_t v)
+  { Bf1w::fn(p, ofs, 7) = v; }
+
+Bf2::Value_t r2(Bf2::Storage_t *p, unsigned ofs)
+  { return(Bf2::fn(p, ofs, 40).read()); }
+void w2(Bf2::Storage_t *p, unsigned ofs, Bf2::Value_t v)
+  { Bf2::fn(p, ofs, 40) = v; }
+
+Bf2w::Value_t r2w(Bf2w::Storage_t *p, std::size_t ofs)
+  { return(Bf2w::fn(p, ofs, 40).read()); }
+void w2w(Bf2w::Storage_t *p, std::size_t ofs, Bf2w::Value_t v)
+  { Bf2w::fn(p, ofs, 40) = v; }
+
+Bf1::Value_t r3(Bf1::Storage_t *p, const Bf1::Descriptor &d)
+  { return(d.read(p)); }
+void w3(Bf1::Storage_t *p, const Bf1::Descriptor &d, Bf1::Value_t v)
+  { d.write(p, v); }
+
+Bf1w::Value_t r3w(Bf1w::Storage_t *p, const Bf1w::Descriptor &d)
+  { return(d.read(p)); }
+void w3w(Bf1w::Storage_t *p, const Bf1w::Descriptor &d, Bf1w::Value_t v)
+  { d.write(p, v); }